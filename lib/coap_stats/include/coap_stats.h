@@ -0,0 +1,198 @@
+/**
+ * @file coap_stats.h
+ * @brief Per-destination CoAP round-trip and retransmission statistics.
+ *
+ * Round-trip times are kept in a histogram with log2 buckets of milliseconds:
+ * bucket 0 holds 0 ms, bucket n holds [2^(n-1), 2^n) ms and the last bucket
+ * holds everything above. Only responses to requests that were not
+ * retransmitted produce an RTT sample (Karn's algorithm).
+ */
+
+#ifndef COAP_STATS_H__
+#define COAP_STATS_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COAP_STATS_RTT_BUCKETS     16
+#define COAP_STATS_NAME_LEN        32
+
+/**
+ * @brief Statistics of one CoAP destination.
+ */
+struct coap_stats
+{
+    /** Destination name, usually the host name. */
+    char name[ COAP_STATS_NAME_LEN ];
+    /** Requests sent, not counting retransmissions. */
+    uint32_t requests;
+    /** Retransmitted requests. */
+    uint32_t retransmissions;
+    /** Responses received. */
+    uint32_t responses;
+    /** Requests that were given up without a response. */
+    uint32_t timeouts;
+    /** Bytes sent, including retransmissions. */
+    uint32_t bytes_tx;
+    /** Bytes received. */
+    uint32_t bytes_rx;
+    /** Smallest, largest and summed RTT samples, in milliseconds. */
+    uint32_t rtt_min_ms;
+    uint32_t rtt_max_ms;
+    uint64_t rtt_sum_ms;
+    /** RTT histogram, log2 buckets of milliseconds. */
+    uint32_t rtt_hist[ COAP_STATS_RTT_BUCKETS ];
+    /** Retransmissions answered by an earlier transmission of the same request. */
+    uint32_t spurious_retransmissions;
+    /** Retransmission timeout, 0 until the first sample, in milliseconds. */
+    uint32_t rto_ms;
+    /** Uptime of the last RTO update, used for RTO aging. */
+    int64_t rto_updated_at;
+    /** Strong estimator (unambiguous samples), smoothed RTT and variation in milliseconds. */
+    uint32_t strong_srtt_ms;
+    uint32_t strong_rttvar_ms;
+    /** Weak estimator (samples of retransmitted requests), smoothed RTT and variation in milliseconds. */
+    uint32_t weak_srtt_ms;
+    uint32_t weak_rttvar_ms;
+};
+
+/**
+ * @brief Get the statistics of a destination, creating them on first use.
+ *
+ * @param[in] name Destination name.
+ * @return Statistics, or NULL if all slots are in use.
+ */
+struct coap_stats * coap_stats_get( const char * name );
+
+/**
+ * @brief Record a sent request.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @param[in] bytes Size of the datagram.
+ * @param[in] retransmission Whether the request is a retransmission.
+ */
+void coap_stats_tx( struct coap_stats * stats,
+                    size_t bytes,
+                    bool retransmission );
+
+/**
+ * @brief Record a received response.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @param[in] bytes Size of the datagram.
+ * @param[in] rtt_ms Round-trip time in milliseconds, negative when the request
+ *                   was retransmitted and the sample is ambiguous.
+ */
+void coap_stats_rx( struct coap_stats * stats,
+                    size_t bytes,
+                    int32_t rtt_ms );
+
+/**
+ * @brief Record a response to a request that was retransmitted.
+ *
+ * The response may answer any of the transmissions. It feeds the weak RTO
+ * estimator when the request was retransmitted at most twice. When it arrived
+ * sooner after the last retransmission than the smallest RTT observed so far,
+ * it cannot answer that retransmission, which is then counted as spurious.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @param[in] bytes Size of the datagram.
+ * @param[in] elapsed_ms Time since the first transmission in milliseconds.
+ * @param[in] since_last_ms Time since the last retransmission in milliseconds,
+ *                          0 when the response is known to answer an earlier transmission.
+ * @param[in] retransmissions Number of retransmissions.
+ */
+void coap_stats_rx_retransmitted( struct coap_stats * stats,
+                                  size_t bytes,
+                                  uint32_t elapsed_ms,
+                                  uint32_t since_last_ms,
+                                  int retransmissions );
+
+/**
+ * @brief Get the retransmission timeout of a destination.
+ *
+ * The RTO follows CoCoA (draft-ietf-core-cocoa): strong RTT samples update it
+ * with weight 1/2 (SRTT + 4 * RTTVAR), weak samples with weight 1/4
+ * (SRTT + RTTVAR). Reading it does not age it, see coap_stats_rto_age().
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @return RTO in milliseconds, CONFIG_COAP_INIT_ACK_TIMEOUT_MS without samples.
+ */
+uint32_t coap_stats_rto( const struct coap_stats * stats );
+
+/**
+ * @brief Age the retransmission timeout of a destination.
+ *
+ * An RTO below 1 s doubles after 16 RTOs without update and an RTO above 3 s
+ * moves halfway back to the initial timeout after 4 RTOs. Called by
+ * coap_stats_rto_apply() before every request.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ */
+void coap_stats_rto_age( struct coap_stats * stats );
+
+/**
+ * @brief Apply the RTO of a destination to CoAP transmission parameters.
+ *
+ * Ages the RTO, then sets the initial ACK timeout to it and the backoff to the
+ * CoCoA variable backoff factor: 3 below 1 s, 1.5 above 3 s and 2 in between.
+ * Leaves the parameters untouched when the adaptive RTO is disabled.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @param[in,out] params Transmission parameters of the next request.
+ */
+void coap_stats_rto_apply( struct coap_stats * stats,
+                           struct coap_transmission_parameters * params );
+
+/**
+ * @brief Record a request that was given up without a response.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ */
+void coap_stats_timeout( struct coap_stats * stats );
+
+/**
+ * @brief Record the outcome of a request sent through coap_client.
+ *
+ * coap_client retransmits internally without reporting it. The retransmissions
+ * are inferred from the time to the response, assuming the largest randomized
+ * timeouts so that they are never over-counted, and the earliest possible time
+ * of the last one so that it is never wrongly counted as spurious.
+ *
+ * @param[in] stats Destination statistics, may be NULL.
+ * @param[in] sent_at Uptime in milliseconds when the request was handed to coap_client.
+ * @param[in] params Transmission parameters the request was sent with.
+ * @param[in] code Response code, negative when coap_client gave up.
+ * @param[in] bytes Size of the response payload.
+ * @return Number of inferred retransmissions, 0 when the request failed.
+ */
+int coap_stats_client_response( struct coap_stats * stats,
+                                int64_t sent_at,
+                                const struct coap_transmission_parameters * params,
+                                int16_t code,
+                                size_t bytes );
+
+/**
+ * @brief Estimate an RTT percentile from the histogram.
+ *
+ * @param[in] stats Destination statistics.
+ * @param[in] percent Percentile, [0, 100].
+ * @return Upper bound of the bucket holding the percentile in milliseconds, 0 without samples.
+ */
+uint32_t coap_stats_rtt_percentile( const struct coap_stats * stats,
+                                    int percent );
+
+/**
+ * @brief Clear the statistics of all destinations.
+ */
+void coap_stats_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_STATS_H__ */
@@ -0,0 +1,452 @@
+/******************************************************************************
+ * @file    coap_stats.c
+ * @brief   CoAP round-trip and retransmission statistics
+ * @details Keeps request, retransmission, timeout and byte counters and a log2
+ *          RTT histogram per destination, shown by the "coap_stats" shell
+ *          command.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+#include "coap_stats.h"
+
+static struct coap_stats destinations[ CONFIG_NCE_COAP_STATS_DESTINATIONS ];
+static struct k_spinlock lock;
+
+/* CoCoA estimator weights and limits */
+#define RTO_STRONG_K                   4
+#define RTO_WEAK_K                     1
+#define RTO_WEAK_MAX_RETRANSMISSIONS   2
+#define RTO_SMALL_MS                   1000
+#define RTO_LARGE_MS                   3000
+
+static int prv_rtt_bucket( uint32_t rtt_ms )
+{
+    int bucket = 0;
+
+    while( ( rtt_ms > 0 ) && ( bucket < COAP_STATS_RTT_BUCKETS - 1 ) )
+    {
+        rtt_ms >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static uint32_t prv_rtt_samples( const struct coap_stats * stats )
+{
+    uint32_t samples = 0;
+
+    for(int i = 0; i < COAP_STATS_RTT_BUCKETS; i++)
+    {
+        samples += stats->rtt_hist[ i ];
+    }
+
+    return samples;
+}
+
+/* RFC 6298 smoothing (alpha 1/8, beta 1/4), returns SRTT + k * RTTVAR */
+static uint32_t prv_rto_estimate( uint32_t * srtt_ms,
+                                  uint32_t * rttvar_ms,
+                                  uint32_t rtt_ms,
+                                  int k )
+{
+    rtt_ms = MAX( rtt_ms, 1 );
+
+    if( *srtt_ms == 0 )
+    {
+        *srtt_ms = rtt_ms;
+        *rttvar_ms = rtt_ms / 2;
+    }
+    else
+    {
+        uint32_t delta = ( *srtt_ms > rtt_ms ) ? *srtt_ms - rtt_ms : rtt_ms - *srtt_ms;
+
+        *rttvar_ms = ( 3 * *rttvar_ms + delta ) / 4;
+        *srtt_ms = ( 7 * *srtt_ms + rtt_ms ) / 8;
+    }
+
+    return *srtt_ms + k * *rttvar_ms;
+}
+
+/* Blend a new estimate into the overall RTO, must be called with the lock held */
+static void prv_rto_update( struct coap_stats * stats,
+                            uint32_t estimate_ms,
+                            bool strong )
+{
+    uint32_t rto = ( stats->rto_ms != 0 ) ? stats->rto_ms : CONFIG_COAP_INIT_ACK_TIMEOUT_MS;
+
+    rto = strong ? ( rto + estimate_ms ) / 2 : ( 3 * rto + estimate_ms ) / 4;
+    stats->rto_ms = CLAMP( rto, CONFIG_NCE_COAP_RTO_MIN_MS, CONFIG_NCE_COAP_RTO_MAX_MS );
+    stats->rto_updated_at = k_uptime_get();
+}
+
+struct coap_stats * coap_stats_get( const char * name )
+{
+    struct coap_stats * stats = NULL;
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    for(size_t i = 0; i < ARRAY_SIZE( destinations ); i++)
+    {
+        if( destinations[ i ].name[ 0 ] == '\0' )
+        {
+            strncpy( destinations[ i ].name, name, sizeof( destinations[ i ].name ) - 1 );
+            stats = &destinations[ i ];
+            break;
+        }
+
+        if( strncmp( destinations[ i ].name, name, sizeof( destinations[ i ].name ) - 1 ) == 0 )
+        {
+            stats = &destinations[ i ];
+            break;
+        }
+    }
+
+    k_spin_unlock( &lock, key );
+
+    return stats;
+}
+
+void coap_stats_tx( struct coap_stats * stats,
+                    size_t bytes,
+                    bool retransmission )
+{
+    if( stats == NULL )
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    if( retransmission )
+    {
+        stats->retransmissions++;
+    }
+    else
+    {
+        stats->requests++;
+    }
+
+    stats->bytes_tx += bytes;
+
+    k_spin_unlock( &lock, key );
+}
+
+void coap_stats_rx( struct coap_stats * stats,
+                    size_t bytes,
+                    int32_t rtt_ms )
+{
+    if( stats == NULL )
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    stats->responses++;
+    stats->bytes_rx += bytes;
+
+    if( rtt_ms >= 0 )
+    {
+        if( prv_rtt_samples( stats ) == 0 )
+        {
+            stats->rtt_min_ms = rtt_ms;
+        }
+
+        stats->rtt_min_ms = MIN( stats->rtt_min_ms, ( uint32_t ) rtt_ms );
+        stats->rtt_max_ms = MAX( stats->rtt_max_ms, ( uint32_t ) rtt_ms );
+        stats->rtt_sum_ms += rtt_ms;
+        stats->rtt_hist[ prv_rtt_bucket( rtt_ms ) ]++;
+        prv_rto_update( stats, prv_rto_estimate( &stats->strong_srtt_ms, &stats->strong_rttvar_ms, rtt_ms, RTO_STRONG_K ),
+                        true );
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+void coap_stats_rx_retransmitted( struct coap_stats * stats,
+                                  size_t bytes,
+                                  uint32_t elapsed_ms,
+                                  uint32_t since_last_ms,
+                                  int retransmissions )
+{
+    if( stats == NULL )
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    stats->responses++;
+    stats->bytes_rx += bytes;
+
+    if( ( since_last_ms == 0 ) || ( ( prv_rtt_samples( stats ) > 0 ) && ( since_last_ms < stats->rtt_min_ms ) ) )
+    {
+        stats->spurious_retransmissions++;
+    }
+
+    if( retransmissions <= RTO_WEAK_MAX_RETRANSMISSIONS )
+    {
+        prv_rto_update( stats, prv_rto_estimate( &stats->weak_srtt_ms, &stats->weak_rttvar_ms, elapsed_ms, RTO_WEAK_K ),
+                        false );
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+uint32_t coap_stats_rto( const struct coap_stats * stats )
+{
+    uint32_t rto;
+
+    if( stats == NULL )
+    {
+        return CONFIG_COAP_INIT_ACK_TIMEOUT_MS;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    rto = ( stats->rto_ms != 0 ) ? stats->rto_ms : CONFIG_COAP_INIT_ACK_TIMEOUT_MS;
+    k_spin_unlock( &lock, key );
+
+    return rto;
+}
+
+void coap_stats_rto_age( struct coap_stats * stats )
+{
+    if( stats == NULL )
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+    int64_t idle = k_uptime_get() - stats->rto_updated_at;
+    uint32_t rto = stats->rto_ms;
+
+    /* A small RTO grows and a large one decays while no samples arrive */
+    if( ( rto != 0 ) && ( rto < RTO_SMALL_MS ) && ( idle > 16 * rto ) )
+    {
+        stats->rto_ms = MIN( 2 * rto, CONFIG_NCE_COAP_RTO_MAX_MS );
+        stats->rto_updated_at = k_uptime_get();
+    }
+    else if( ( rto != 0 ) && ( rto > RTO_LARGE_MS ) && ( idle > 4 * rto ) )
+    {
+        stats->rto_ms = MAX( ( rto + CONFIG_COAP_INIT_ACK_TIMEOUT_MS ) / 2, CONFIG_NCE_COAP_RTO_MIN_MS );
+        stats->rto_updated_at = k_uptime_get();
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+void coap_stats_rto_apply( struct coap_stats * stats,
+                           struct coap_transmission_parameters * params )
+{
+    /* The RTO ages when it is about to be used, not when it is read */
+    coap_stats_rto_age( stats );
+
+#if defined( CONFIG_NCE_COAP_ADAPTIVE_RTO )
+    params->ack_timeout = coap_stats_rto( stats );
+
+    if( params->ack_timeout < RTO_SMALL_MS )
+    {
+        params->coap_backoff_percent = 300;
+    }
+    else if( params->ack_timeout > RTO_LARGE_MS )
+    {
+        params->coap_backoff_percent = 150;
+    }
+    else
+    {
+        params->coap_backoff_percent = 200;
+    }
+#endif /* if defined( CONFIG_NCE_COAP_ADAPTIVE_RTO ) */
+}
+
+void coap_stats_timeout( struct coap_stats * stats )
+{
+    if( stats == NULL )
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    stats->timeouts++;
+
+    k_spin_unlock( &lock, key );
+}
+
+int coap_stats_client_response( struct coap_stats * stats,
+                                int64_t sent_at,
+                                const struct coap_transmission_parameters * params,
+                                int16_t code,
+                                size_t bytes )
+{
+    int64_t elapsed = k_uptime_get() - sent_at;
+    int64_t timeout = params->ack_timeout;
+    int64_t latest_expiry = timeout * CONFIG_COAP_ACK_RANDOM_PERCENT / 100;
+    int64_t earliest_last = 0;
+    int retransmissions = 0;
+
+    if( code < 0 )
+    {
+        coap_stats_timeout( stats );
+        return 0;
+    }
+
+    while( ( elapsed > latest_expiry ) && ( retransmissions < params->max_retransmission ) )
+    {
+        coap_stats_tx( stats, 0, true );
+        retransmissions++;
+        earliest_last += timeout;
+        timeout = timeout * params->coap_backoff_percent / 100;
+        latest_expiry += timeout * CONFIG_COAP_ACK_RANDOM_PERCENT / 100;
+    }
+
+    if( retransmissions == 0 )
+    {
+        coap_stats_rx( stats, bytes, ( int32_t ) elapsed );
+    }
+    else
+    {
+        coap_stats_rx_retransmitted( stats, bytes, ( uint32_t ) elapsed, ( uint32_t ) ( elapsed - earliest_last ),
+                                     retransmissions );
+    }
+
+    return retransmissions;
+}
+
+uint32_t coap_stats_rtt_percentile( const struct coap_stats * stats,
+                                    int percent )
+{
+    uint32_t samples = prv_rtt_samples( stats );
+    uint32_t rank = DIV_ROUND_UP( samples * percent, 100 );
+    uint32_t seen = 0;
+
+    if( samples == 0 )
+    {
+        return 0;
+    }
+
+    for(int i = 0; i < COAP_STATS_RTT_BUCKETS; i++)
+    {
+        seen += stats->rtt_hist[ i ];
+
+        if( ( seen >= rank ) && ( seen > 0 ) )
+        {
+            if( i == 0 )
+            {
+                return 0;
+            }
+
+            /* The last bucket is open-ended, the largest sample bounds it */
+            return ( i == COAP_STATS_RTT_BUCKETS - 1 ) ? stats->rtt_max_ms : MIN( BIT( i ) - 1, stats->rtt_max_ms );
+        }
+    }
+
+    return stats->rtt_max_ms;
+}
+
+void coap_stats_reset( void )
+{
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    for(size_t i = 0; i < ARRAY_SIZE( destinations ); i++)
+    {
+        char name[ COAP_STATS_NAME_LEN ];
+
+        memcpy( name, destinations[ i ].name, sizeof( name ) );
+        memset( &destinations[ i ], 0, sizeof( destinations[ i ] ) );
+        memcpy( destinations[ i ].name, name, sizeof( name ) );
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+#if defined( CONFIG_SHELL )
+static int prv_cmd_coap_stats_show( const struct shell * shell,
+                                    size_t argc,
+                                    char ** argv )
+{
+    for(size_t i = 0; i < ARRAY_SIZE( destinations ); i++)
+    {
+        struct coap_stats stats;
+        k_spinlock_key_t key = k_spin_lock( &lock );
+
+        stats = destinations[ i ];
+        k_spin_unlock( &lock, key );
+
+        if( stats.name[ 0 ] == '\0' )
+        {
+            continue;
+        }
+
+        uint32_t samples = prv_rtt_samples( &stats );
+
+        shell_print( shell, "%s", stats.name );
+        shell_print( shell, "  requests %u, retransmissions %u (spurious %u), responses %u, timeouts %u",
+                     stats.requests, stats.retransmissions, stats.spurious_retransmissions, stats.responses,
+                     stats.timeouts );
+        shell_print( shell, "  bytes tx %u, rx %u", stats.bytes_tx, stats.bytes_rx );
+        shell_print( shell, "  rto %u ms (strong %u ms, weak %u ms)", coap_stats_rto( &stats ),
+                     stats.strong_srtt_ms + RTO_STRONG_K * stats.strong_rttvar_ms,
+                     stats.weak_srtt_ms + RTO_WEAK_K * stats.weak_rttvar_ms );
+
+        if( samples == 0 )
+        {
+            continue;
+        }
+
+        shell_print( shell, "  rtt min %u ms, avg %u ms, max %u ms, p50 %u ms, p90 %u ms",
+                     stats.rtt_min_ms, ( uint32_t ) ( stats.rtt_sum_ms / samples ), stats.rtt_max_ms,
+                     coap_stats_rtt_percentile( &stats, 50 ), coap_stats_rtt_percentile( &stats, 90 ) );
+
+        for(int b = 0; b < COAP_STATS_RTT_BUCKETS; b++)
+        {
+            if( stats.rtt_hist[ b ] == 0 )
+            {
+                continue;
+            }
+
+            if( b == COAP_STATS_RTT_BUCKETS - 1 )
+            {
+                shell_print( shell, "  [%6u, ...) ms: %u", ( uint32_t ) BIT( b - 1 ), stats.rtt_hist[ b ] );
+            }
+            else
+            {
+                shell_print( shell, "  [%6u, %6u) ms: %u", ( b == 0 ) ? 0 : ( uint32_t ) BIT( b - 1 ), ( uint32_t ) BIT( b ),
+                             stats.rtt_hist[ b ] );
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int prv_cmd_coap_stats_reset( const struct shell * shell,
+                                     size_t argc,
+                                     char ** argv )
+{
+    coap_stats_reset();
+    shell_print( shell, "CoAP statistics cleared" );
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE( coap_stats_cmds,
+                                SHELL_CMD( show, NULL, "Show CoAP statistics per destination", prv_cmd_coap_stats_show ),
+                                SHELL_CMD( reset, NULL, "Clear CoAP statistics", prv_cmd_coap_stats_reset ),
+                                SHELL_SUBCMD_SET_END
+                                );
+
+SHELL_CMD_REGISTER( coap_stats, &coap_stats_cmds, "CoAP RTT and retransmission statistics", prv_cmd_coap_stats_show );
+#endif /* if defined( CONFIG_SHELL ) */
@@ -0,0 +1,73 @@
+/**
+ * @file nat_keepalive.h
+ * @brief NAT binding keepalive with an auto-tuned interval for the downlink socket.
+ *
+ * The binding lifetime is probed with a delayed echo: the device asks the
+ * echo server (tools/nat_echo_server.py) to answer after T seconds of
+ * silence and T is bisected between the longest idle time the binding
+ * survived and the shortest one it did not. Once converged, keepalives are
+ * sent at a safety fraction of the measured lifetime, early when an uplink
+ * wakes the radio anyway. The learned values survive reboots when
+ * CONFIG_SETTINGS is enabled.
+ *
+ * A datagram only refreshes the binding towards its destination. Behind a
+ * NAT with endpoint-dependent mapping or filtering, keepalives to the echo
+ * server do not keep the path open for downlinks from another host, so they
+ * can be sent to CONFIG_NCE_NAT_KEEPALIVE_TARGET_HOSTNAME instead. The
+ * lifetime is always measured against the echo server.
+ */
+
+#ifndef NAT_KEEPALIVE_H__
+#define NAT_KEEPALIVE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/net/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start probing or keeping alive the binding of a downlink socket.
+ *
+ * Resolves the echo server and the keepalive destination and loads the
+ * persisted binding lifetime. Must be called from the thread that owns the
+ * socket, after it has been bound.
+ *
+ * @param[in] fd Bound downlink socket.
+ * @return 0 on success, negative error code if the echo server cannot be resolved.
+ */
+int nat_keepalive_start( int fd );
+
+/**
+ * @brief Stop sending on the downlink socket, before it is closed.
+ */
+void nat_keepalive_stop( void );
+
+/**
+ * @brief Consume echo replies received on the downlink socket.
+ *
+ * @param[in] from Sender of the datagram.
+ * @param[in] data Datagram.
+ * @param[in] len Length of the datagram.
+ * @return true if the datagram was an echo reply and must not be processed further.
+ */
+bool nat_keepalive_rx( const struct sockaddr * from,
+                       const uint8_t * data,
+                       size_t len );
+
+/**
+ * @brief Tell the keepalive that an uplink woke the radio.
+ *
+ * A keepalive that is due within the next CONFIG_NCE_NAT_KEEPALIVE_COSCHEDULE_PERCENT
+ * of the interval is sent right away, so it shares the radio wakeup.
+ */
+void nat_keepalive_uplink_sent( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NAT_KEEPALIVE_H__ */
@@ -0,0 +1,501 @@
+/******************************************************************************
+ * @file    nat_keepalive.c
+ * @brief   NAT binding keepalive with an auto-tuned interval
+ * @details Probes the NAT binding lifetime of the downlink socket with delayed
+ *          echoes and keeps the binding alive at a safety fraction of it.
+ *          Probes and keepalives are 12-byte datagrams starting with a zero
+ *          byte, so they cannot be mistaken for CoAP or text downlinks:
+ *
+ *            0x00 'N' 'K' type | seq (u32, big endian) | delay s (u32, big endian)
+ *
+ *          The echo server answers a request (type 0x01) with the same
+ *          datagram and type 0x81 after the requested delay. Keepalives go to
+ *          CONFIG_NCE_NAT_KEEPALIVE_TARGET_HOSTNAME if set, so they refresh
+ *          the binding towards the host the downlinks come from. With the
+ *          shell enabled, the state is shown by the "nat_keepalive" command.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#if defined( CONFIG_SETTINGS )
+    #include <zephyr/settings/settings.h>
+#endif /* if defined( CONFIG_SETTINGS ) */
+#include "nat_keepalive.h"
+
+LOG_MODULE_REGISTER( nat_keepalive, CONFIG_NCE_NAT_KEEPALIVE_LOG_LEVEL );
+
+#define NAT_KEEPALIVE_MSG_LEN           12
+#define NAT_KEEPALIVE_TYPE_REQUEST      0x01
+#define NAT_KEEPALIVE_TYPE_REPLY        0x81
+#define NAT_KEEPALIVE_SETTINGS_KEY      "nat_ka/binding"
+
+/* A probe is only counted as failed after this many unanswered attempts */
+#define NAT_KEEPALIVE_PROBE_ATTEMPTS    2
+
+/* The search stops once the bounds are within 1/8 of the lower one */
+#define NAT_KEEPALIVE_RESOLUTION_DIV    8
+
+enum nat_keepalive_state
+{
+    NAT_KEEPALIVE_IDLE,       /**< No downlink socket. */
+    NAT_KEEPALIVE_PROBING,    /**< Next run sends a probe. */
+    NAT_KEEPALIVE_PROBE_WAIT, /**< Waiting for the delayed echo of a probe. */
+    NAT_KEEPALIVE_KEEPALIVE   /**< Converged, sending keepalives. */
+};
+
+/** @brief Learned binding lifetime, persisted across reboots. */
+struct nat_keepalive_binding
+{
+    uint32_t good_s;     /**< Longest idle time the binding survived, 0 if unknown. */
+    uint32_t bad_s;      /**< Shortest idle time the binding did not survive, 0 if unknown. */
+    uint32_t interval_s; /**< Keepalive interval, 0 while still probing. */
+};
+
+static struct nat_keepalive_binding binding;
+static bool binding_loaded;
+static enum nat_keepalive_state state;
+static int keepalive_fd = -1;
+static struct sockaddr_in server_addr;
+static struct sockaddr_in target_addr;
+static uint32_t probe_s;
+static uint32_t probe_seq;
+static int probe_attempts;
+static bool probe_answered;
+static bool validating;
+static int64_t last_sent_at;
+static int64_t validated_at;
+
+static uint32_t probes_sent;
+static uint32_t probes_lost;
+static uint32_t keepalives_sent;
+static uint32_t keepalives_coscheduled;
+static uint32_t echoes_received;
+
+K_MUTEX_DEFINE( keepalive_lock );
+
+static void prv_keepalive_work_fn( struct k_work * work );
+static K_WORK_DELAYABLE_DEFINE( keepalive_work, prv_keepalive_work_fn );
+
+#if defined( CONFIG_SETTINGS )
+static int prv_binding_load_cb( const char * key,
+                                size_t len,
+                                settings_read_cb read_cb,
+                                void * cb_arg,
+                                void * param )
+{
+    ssize_t ret;
+
+    if( len != sizeof( binding ) )
+    {
+        return -EINVAL;
+    }
+
+    ret = read_cb( cb_arg, &binding, sizeof( binding ) );
+
+    return ( ret < 0 ) ? ( int ) ret : 0;
+}
+#endif /* if defined( CONFIG_SETTINGS ) */
+
+static void prv_binding_load( void )
+{
+    #if defined( CONFIG_SETTINGS )
+    int err = settings_subsys_init();
+
+    err = err ? err : settings_load_subtree_direct( NAT_KEEPALIVE_SETTINGS_KEY, prv_binding_load_cb, NULL );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to load the NAT binding lifetime, err %d", err );
+        memset( &binding, 0, sizeof( binding ) );
+    }
+    #endif /* if defined( CONFIG_SETTINGS ) */
+
+    if( binding.interval_s != 0 )
+    {
+        LOG_INF( "NAT binding lifetime %u s loaded, keepalive every %u s", binding.good_s, binding.interval_s );
+    }
+}
+
+static void prv_binding_save( void )
+{
+    #if defined( CONFIG_SETTINGS )
+    int err = settings_save_one( NAT_KEEPALIVE_SETTINGS_KEY, &binding, sizeof( binding ) );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to persist the NAT binding lifetime, err %d", err );
+    }
+    #endif /* if defined( CONFIG_SETTINGS ) */
+}
+
+/* Next idle time to probe, 0 once the bounds are close enough */
+static uint32_t prv_next_probe( void )
+{
+    if( binding.bad_s == 0 )
+    {
+        if( binding.good_s >= CONFIG_NCE_NAT_KEEPALIVE_MAX_SECONDS )
+        {
+            return 0;
+        }
+
+        return ( binding.good_s == 0 ) ? CONFIG_NCE_NAT_KEEPALIVE_INITIAL_SECONDS :
+               MIN( binding.good_s * 2, CONFIG_NCE_NAT_KEEPALIVE_MAX_SECONDS );
+    }
+
+    if( binding.bad_s <= CONFIG_NCE_NAT_KEEPALIVE_MIN_SECONDS )
+    {
+        return 0;
+    }
+
+    if( binding.good_s == 0 )
+    {
+        return MAX( binding.bad_s / 2, CONFIG_NCE_NAT_KEEPALIVE_MIN_SECONDS );
+    }
+
+    if( ( binding.bad_s - binding.good_s ) <= MAX( binding.good_s / NAT_KEEPALIVE_RESOLUTION_DIV, 1 ) )
+    {
+        return 0;
+    }
+
+    return binding.good_s + ( binding.bad_s - binding.good_s ) / 2;
+}
+
+/* Pick the next probe or switch to keepalives, must be called with the lock held */
+static void prv_plan( void )
+{
+    probe_s = prv_next_probe();
+
+    if( probe_s != 0 )
+    {
+        state = NAT_KEEPALIVE_PROBING;
+        return;
+    }
+
+    binding.interval_s = MAX( binding.good_s * CONFIG_NCE_NAT_KEEPALIVE_SAFETY_PERCENT / 100,
+                              CONFIG_NCE_NAT_KEEPALIVE_MIN_SECONDS );
+    state = NAT_KEEPALIVE_KEEPALIVE;
+    validated_at = k_uptime_get();
+    prv_binding_save();
+
+    if( binding.good_s < CONFIG_NCE_NAT_KEEPALIVE_MIN_SECONDS )
+    {
+        LOG_WRN( "NAT binding shorter than %d s, keepalive every %u s may not be enough",
+                 CONFIG_NCE_NAT_KEEPALIVE_MIN_SECONDS, binding.interval_s );
+    }
+    else
+    {
+        LOG_INF( "NAT binding lifetime %u s (fails at %u s), keepalive every %u s",
+                 binding.good_s, binding.bad_s, binding.interval_s );
+    }
+}
+
+/* Evaluate the probe that just completed, must be called with the lock held */
+static void prv_probe_result( void )
+{
+    if( probe_answered )
+    {
+        LOG_INF( "NAT binding survived %u s idle", probe_s );
+        binding.good_s = MAX( binding.good_s, probe_s );
+        probe_attempts = 0;
+    }
+    else if( ++probe_attempts < NAT_KEEPALIVE_PROBE_ATTEMPTS )
+    {
+        /* Retry once before blaming the NAT for a lost datagram */
+        probes_lost++;
+        state = NAT_KEEPALIVE_PROBING;
+        return;
+    }
+    else
+    {
+        LOG_INF( "NAT binding did not survive %u s idle", probe_s );
+        probes_lost++;
+        probe_attempts = 0;
+        binding.bad_s = ( binding.bad_s == 0 ) ? probe_s : MIN( binding.bad_s, probe_s );
+
+        if( binding.good_s >= binding.bad_s )
+        {
+            /* The binding got shorter since it was measured, search again below */
+            binding.good_s = 0;
+        }
+    }
+
+    if( validating && probe_answered )
+    {
+        validating = false;
+        state = NAT_KEEPALIVE_KEEPALIVE;
+        validated_at = k_uptime_get();
+        return;
+    }
+
+    validating = false;
+    binding.interval_s = 0;
+    prv_plan();
+}
+
+static int prv_send( const struct sockaddr_in * to,
+                     uint32_t delay_s )
+{
+    uint8_t msg[ NAT_KEEPALIVE_MSG_LEN ] = { 0x00, 'N', 'K', NAT_KEEPALIVE_TYPE_REQUEST };
+    ssize_t sent;
+
+    sys_put_be32( ++probe_seq, &msg[ 4 ] );
+    sys_put_be32( delay_s, &msg[ 8 ] );
+    sent = zsock_sendto( keepalive_fd, msg, sizeof( msg ), 0, ( const struct sockaddr * ) to, sizeof( *to ) );
+    last_sent_at = k_uptime_get();
+
+    return ( sent < 0 ) ? -errno : 0;
+}
+
+static void prv_keepalive_work_fn( struct k_work * work )
+{
+    k_timeout_t next;
+    int err;
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+
+    if( keepalive_fd < 0 )
+    {
+        k_mutex_unlock( &keepalive_lock );
+        return;
+    }
+
+    if( state == NAT_KEEPALIVE_PROBE_WAIT )
+    {
+        prv_probe_result();
+    }
+
+    if( ( state == NAT_KEEPALIVE_KEEPALIVE ) && ( CONFIG_NCE_NAT_KEEPALIVE_REVALIDATE_HOURS > 0 ) &&
+        ( k_uptime_get() - validated_at >= ( int64_t ) CONFIG_NCE_NAT_KEEPALIVE_REVALIDATE_HOURS * 3600 * MSEC_PER_SEC ) )
+    {
+        /* Check that the binding still lasts as long as it did */
+        probe_s = binding.good_s;
+        validating = true;
+        state = NAT_KEEPALIVE_PROBING;
+    }
+
+    if( state == NAT_KEEPALIVE_PROBING )
+    {
+        probe_answered = false;
+        err = prv_send( &server_addr, probe_s );
+        probes_sent++;
+        state = NAT_KEEPALIVE_PROBE_WAIT;
+        next = K_SECONDS( probe_s + CONFIG_NCE_NAT_KEEPALIVE_ECHO_TIMEOUT_SECONDS );
+    }
+    else
+    {
+        err = prv_send( &target_addr, 0 );
+        keepalives_sent++;
+        next = K_SECONDS( binding.interval_s );
+    }
+
+    if( err )
+    {
+        LOG_WRN( "Failed to send NAT keepalive, err %d", err );
+    }
+
+    k_work_reschedule( &keepalive_work, next );
+    k_mutex_unlock( &keepalive_lock );
+}
+
+/* Resolves an IPv4 host, false if it cannot be */
+static bool prv_resolve( const char * hostname,
+                         uint16_t port,
+                         struct sockaddr_in * addr )
+{
+    struct addrinfo * res;
+    struct addrinfo hints =
+    {
+        .ai_family   = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    int err = zsock_getaddrinfo( hostname, NULL, &hints, &res );
+
+    if( ( err != 0 ) || !res )
+    {
+        LOG_ERR( "Failed to resolve '%s', err %d", hostname, err );
+        return false;
+    }
+
+    memcpy( addr, res->ai_addr, sizeof( *addr ) );
+    addr->sin_port = htons( port );
+    zsock_freeaddrinfo( res );
+
+    return true;
+}
+
+int nat_keepalive_start( int fd )
+{
+    struct sockaddr_in echo_addr;
+    struct sockaddr_in keepalive_addr;
+
+    if( !prv_resolve( CONFIG_NCE_NAT_KEEPALIVE_SERVER_HOSTNAME, CONFIG_NCE_NAT_KEEPALIVE_SERVER_PORT, &echo_addr ) )
+    {
+        return -EHOSTUNREACH;
+    }
+
+    keepalive_addr = echo_addr;
+
+    if( ( sizeof( CONFIG_NCE_NAT_KEEPALIVE_TARGET_HOSTNAME ) > 1 ) &&
+        !prv_resolve( CONFIG_NCE_NAT_KEEPALIVE_TARGET_HOSTNAME, CONFIG_NCE_NAT_KEEPALIVE_TARGET_PORT,
+                      &keepalive_addr ) )
+    {
+        LOG_WRN( "Sending keepalives to the echo server instead" );
+    }
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+    server_addr = echo_addr;
+    target_addr = keepalive_addr;
+
+    if( !binding_loaded )
+    {
+        prv_binding_load();
+        binding_loaded = true;
+    }
+
+    keepalive_fd = fd;
+    probe_attempts = 0;
+    validating = false;
+
+    if( binding.interval_s != 0 )
+    {
+        state = NAT_KEEPALIVE_KEEPALIVE;
+        validated_at = k_uptime_get();
+    }
+    else
+    {
+        prv_plan();
+    }
+
+    k_work_reschedule( &keepalive_work, K_NO_WAIT );
+    k_mutex_unlock( &keepalive_lock );
+
+    return 0;
+}
+
+void nat_keepalive_stop( void )
+{
+    struct k_work_sync sync;
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+    keepalive_fd = -1;
+    state = NAT_KEEPALIVE_IDLE;
+    k_mutex_unlock( &keepalive_lock );
+    k_work_cancel_delayable_sync( &keepalive_work, &sync );
+}
+
+bool nat_keepalive_rx( const struct sockaddr * from,
+                       const uint8_t * data,
+                       size_t len )
+{
+    const struct sockaddr_in * from_in = ( const struct sockaddr_in * ) from;
+
+    if( ( len != NAT_KEEPALIVE_MSG_LEN ) || ( data[ 0 ] != 0x00 ) || ( data[ 1 ] != 'N' ) || ( data[ 2 ] != 'K' ) )
+    {
+        return false;
+    }
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+
+    if( ( data[ 3 ] == NAT_KEEPALIVE_TYPE_REPLY ) && ( from->sa_family == AF_INET ) &&
+        ( from_in->sin_addr.s_addr == server_addr.sin_addr.s_addr ) && ( from_in->sin_port == server_addr.sin_port ) )
+    {
+        echoes_received++;
+
+        if( ( state == NAT_KEEPALIVE_PROBE_WAIT ) && ( sys_get_be32( &data[ 4 ] ) == probe_seq ) )
+        {
+            probe_answered = true;
+            k_work_reschedule( &keepalive_work, K_NO_WAIT );
+        }
+    }
+
+    k_mutex_unlock( &keepalive_lock );
+
+    return true;
+}
+
+void nat_keepalive_uplink_sent( void )
+{
+    int64_t elapsed_ms;
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+    elapsed_ms = k_uptime_get() - last_sent_at;
+
+    if( ( state == NAT_KEEPALIVE_KEEPALIVE ) &&
+        ( elapsed_ms * 100 >= ( int64_t ) binding.interval_s * MSEC_PER_SEC *
+          ( 100 - CONFIG_NCE_NAT_KEEPALIVE_COSCHEDULE_PERCENT ) ) )
+    {
+        keepalives_coscheduled++;
+        k_work_reschedule( &keepalive_work, K_NO_WAIT );
+    }
+
+    k_mutex_unlock( &keepalive_lock );
+}
+
+#if defined( CONFIG_SHELL )
+static int prv_cmd_nat_keepalive_show( const struct shell * shell,
+                                       size_t argc,
+                                       char ** argv )
+{
+    static const char * const state_names[] = { "idle", "probing", "probing", "keepalive" };
+
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+    shell_print( shell, "state %s%s, binding survives %u s, fails at %u s, keepalive every %u s",
+                 state_names[ state ], validating ? " (revalidating)" : "", binding.good_s, binding.bad_s,
+                 binding.interval_s );
+
+    if( state == NAT_KEEPALIVE_PROBE_WAIT )
+    {
+        shell_print( shell, "waiting for the echo of a %u s probe", probe_s );
+    }
+
+    shell_print( shell, "probes %u (lost %u), keepalives %u (with uplink %u), echoes %u",
+                 probes_sent, probes_lost, keepalives_sent, keepalives_coscheduled, echoes_received );
+    k_mutex_unlock( &keepalive_lock );
+
+    return 0;
+}
+
+static int prv_cmd_nat_keepalive_reset( const struct shell * shell,
+                                        size_t argc,
+                                        char ** argv )
+{
+    k_mutex_lock( &keepalive_lock, K_FOREVER );
+    memset( &binding, 0, sizeof( binding ) );
+    prv_binding_save();
+
+    if( keepalive_fd >= 0 )
+    {
+        validating = false;
+        probe_attempts = 0;
+        prv_plan();
+        k_work_reschedule( &keepalive_work, K_NO_WAIT );
+    }
+
+    k_mutex_unlock( &keepalive_lock );
+    shell_print( shell, "NAT binding lifetime cleared, probing again" );
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE( nat_keepalive_cmds,
+                                SHELL_CMD( show, NULL, "Show the learned NAT binding lifetime", prv_cmd_nat_keepalive_show ),
+                                SHELL_CMD( reset, NULL, "Forget the learned lifetime and probe again", prv_cmd_nat_keepalive_reset ),
+                                SHELL_SUBCMD_SET_END
+                                );
+
+SHELL_CMD_REGISTER( nat_keepalive, &nat_keepalive_cmds, "NAT binding keepalive", prv_cmd_nat_keepalive_show );
+#endif /* if defined( CONFIG_SHELL ) */
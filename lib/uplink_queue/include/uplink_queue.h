@@ -0,0 +1,121 @@
+/**
+ * @file uplink_queue.h
+ * @brief Uplink queue with priority classes and per-message time-to-live.
+ *
+ * Messages are handed to the uplink thread highest priority first and in
+ * arrival order within a class. Messages whose time-to-live ran out are
+ * dropped before they are handed out, so stale data never reaches the radio.
+ * When the queue is full, the oldest message of the lowest class at or below
+ * the priority of the new one is dropped to make room.
+ *
+ * Payloads are kept in a pool of CONFIG_NCE_UPLINK_QUEUE_POOL_SIZE bytes shared by
+ * all messages and referenced by length. A payload may use up to the whole pool,
+ * less the allocator overhead; a full pool makes room like a full queue.
+ */
+
+#ifndef UPLINK_QUEUE_H__
+#define UPLINK_QUEUE_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Uplink priority classes, most urgent first.
+ */
+enum uplink_priority
+{
+    UPLINK_PRIORITY_ALARM,  /**< Sent right away, wakes the uplink thread. */
+    UPLINK_PRIORITY_NORMAL, /**< Periodic samples. */
+    UPLINK_PRIORITY_BULK,   /**< Sent when nothing else is waiting. */
+    UPLINK_PRIORITY_COUNT
+};
+
+/**
+ * @brief One queued uplink message.
+ */
+struct uplink_msg
+{
+    enum uplink_priority priority;
+    int64_t enqueued_at; /**< Uptime when the message was queued. */
+    int64_t expires_at;  /**< Uptime after which the message is dropped, 0 for never. */
+    uint16_t format;     /**< CoAP Content-Format of the payload, 0 (text/plain) for raw UDP. */
+    size_t len;
+    uint8_t * data;      /**< Payload in the queue's pool, owned by the holder until released. */
+};
+
+/**
+ * @brief Counters of one priority class.
+ */
+struct uplink_queue_stats
+{
+    uint32_t queued;     /**< Messages accepted. */
+    uint32_t sent;       /**< Messages handed to the uplink. */
+    uint32_t expired;    /**< Messages dropped because their time-to-live ran out. */
+    uint32_t dropped;    /**< Messages dropped because the queue was full. */
+    uint32_t max_age_ms; /**< Longest time a message waited before it was handed out. */
+};
+
+/**
+ * @brief Queue an uplink message.
+ *
+ * @param[in] priority Priority class.
+ * @param[in] ttl_s Time-to-live in seconds, 0 for no limit.
+ * @param[in] format CoAP Content-Format of the payload, ignored by the UDP uplink.
+ * @param[in] data Payload, copied into the queue.
+ * @param[in] len Length of the payload.
+ * @return 0 on success, -EMSGSIZE if the payload is larger than the pool,
+ *         -ENOBUFS if the queue or the pool is full of more urgent messages.
+ */
+int uplink_queue_put( enum uplink_priority priority,
+                      uint32_t ttl_s,
+                      uint16_t format,
+                      const void * data,
+                      size_t len );
+
+/**
+ * @brief Take the most urgent message that has not expired.
+ *
+ * The payload stays in the pool until the message is released with
+ * uplink_queue_release() or returned with uplink_queue_putback().
+ *
+ * @param[out] msg Message.
+ * @param[in] timeout Time to wait for a message.
+ * @return 0 on success, -EAGAIN if no message arrived in time.
+ */
+int uplink_queue_get( struct uplink_msg * msg,
+                      k_timeout_t timeout );
+
+/**
+ * @brief Return a message that could not be sent to the front of its class.
+ *
+ * The message keeps its original deadline. If the queue filled up in the
+ * meantime, the message is dropped and counted.
+ *
+ * @param[in] msg Message taken with uplink_queue_get().
+ */
+void uplink_queue_putback( const struct uplink_msg * msg );
+
+/**
+ * @brief Free the payload of a message that was sent.
+ *
+ * @param[in,out] msg Message taken with uplink_queue_get().
+ */
+void uplink_queue_release( struct uplink_msg * msg );
+
+/**
+ * @brief Get the counters of a priority class.
+ *
+ * @param[in] priority Priority class.
+ * @param[out] stats Counters.
+ */
+void uplink_queue_stats_get( enum uplink_priority priority,
+                             struct uplink_queue_stats * stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_QUEUE_H__ */
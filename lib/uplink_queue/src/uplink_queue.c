@@ -0,0 +1,325 @@
+/******************************************************************************
+ * @file    uplink_queue.c
+ * @brief   Uplink queue with priority classes and per-message deadlines
+ * @details Fixed pool of CONFIG_NCE_UPLINK_QUEUE_DEPTH message slots shared by
+ *          all priority classes. Payloads are copied into a heap of
+ *          CONFIG_NCE_UPLINK_QUEUE_POOL_SIZE bytes and referenced from their
+ *          slot, so a slot does not reserve room for the largest payload.
+ *          Producers queue messages from any thread, the uplink thread of
+ *          the UDP or CoAP demo blocks until a message is ready. Expired messages
+ *          are dropped on every access and counted per class; with the shell
+ *          enabled the counters are shown by the "uplink_queue" command.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#include "uplink_queue.h"
+
+LOG_MODULE_REGISTER( uplink_queue, CONFIG_NCE_UPLINK_QUEUE_LOG_LEVEL );
+
+static struct uplink_msg slots[ CONFIG_NCE_UPLINK_QUEUE_DEPTH ];
+static bool slot_used[ CONFIG_NCE_UPLINK_QUEUE_DEPTH ];
+static struct uplink_queue_stats class_stats[ UPLINK_PRIORITY_COUNT ];
+static const char * const class_names[ UPLINK_PRIORITY_COUNT ] = { "alarm", "normal", "bulk" };
+
+K_HEAP_DEFINE( payload_pool, CONFIG_NCE_UPLINK_QUEUE_POOL_SIZE );
+K_MUTEX_DEFINE( queue_lock );
+K_CONDVAR_DEFINE( queue_ready );
+
+/* Free a queued message and its payload, must be called with the lock held */
+static void prv_free_slot( int slot )
+{
+    k_heap_free( &payload_pool, slots[ slot ].data );
+    slots[ slot ].data = NULL;
+    slot_used[ slot ] = false;
+}
+
+/* Drop expired messages, must be called with the lock held */
+static void prv_purge_expired( void )
+{
+    int64_t now = k_uptime_get();
+
+    for(int i = 0; i < CONFIG_NCE_UPLINK_QUEUE_DEPTH; i++)
+    {
+        if( slot_used[ i ] && ( slots[ i ].expires_at != 0 ) && ( slots[ i ].expires_at <= now ) )
+        {
+            prv_free_slot( i );
+            class_stats[ slots[ i ].priority ].expired++;
+            LOG_WRN( "Dropped %s uplink of %zu bytes, expired after %lld s in the queue",
+                     class_names[ slots[ i ].priority ], slots[ i ].len,
+                     ( now - slots[ i ].enqueued_at ) / MSEC_PER_SEC );
+        }
+    }
+}
+
+/* Oldest message of the most (or least) urgent class, -1 if empty */
+static int prv_find( bool most_urgent )
+{
+    int found = -1;
+
+    for(int i = 0; i < CONFIG_NCE_UPLINK_QUEUE_DEPTH; i++)
+    {
+        if( !slot_used[ i ] )
+        {
+            continue;
+        }
+
+        if( found < 0 )
+        {
+            found = i;
+        }
+        else if( slots[ i ].priority != slots[ found ].priority )
+        {
+            if( ( slots[ i ].priority < slots[ found ].priority ) == most_urgent )
+            {
+                found = i;
+            }
+        }
+        else if( slots[ i ].enqueued_at < slots[ found ].enqueued_at )
+        {
+            found = i;
+        }
+    }
+
+    return found;
+}
+
+/* Free slot for a message of the given class, evicting a less or equally urgent one, -1 if none */
+static int prv_claim_slot( enum uplink_priority priority )
+{
+    int victim;
+
+    for(int i = 0; i < CONFIG_NCE_UPLINK_QUEUE_DEPTH; i++)
+    {
+        if( !slot_used[ i ] )
+        {
+            return i;
+        }
+    }
+
+    victim = prv_find( false );
+
+    if( slots[ victim ].priority < priority )
+    {
+        return -1;
+    }
+
+    class_stats[ slots[ victim ].priority ].dropped++;
+    LOG_WRN( "Uplink queue full, dropped the oldest %s message", class_names[ slots[ victim ].priority ] );
+    prv_free_slot( victim );
+
+    return victim;
+}
+
+/* Pool memory for a payload, dropping less or equally urgent messages until it fits, NULL if it does not */
+static uint8_t * prv_alloc_payload( enum uplink_priority priority,
+                                    size_t len )
+{
+    uint8_t * data;
+    int victim;
+
+    while( ( data = k_heap_alloc( &payload_pool, MAX( len, 1 ), K_NO_WAIT ) ) == NULL )
+    {
+        victim = prv_find( false );
+
+        if( ( victim < 0 ) || ( slots[ victim ].priority < priority ) )
+        {
+            return NULL;
+        }
+
+        class_stats[ slots[ victim ].priority ].dropped++;
+        LOG_WRN( "Uplink payload pool full, dropped the oldest %s message", class_names[ slots[ victim ].priority ] );
+        prv_free_slot( victim );
+    }
+
+    return data;
+}
+
+int uplink_queue_put( enum uplink_priority priority,
+                      uint32_t ttl_s,
+                      uint16_t format,
+                      const void * data,
+                      size_t len )
+{
+    int slot;
+    uint8_t * payload;
+
+    if( ( priority >= UPLINK_PRIORITY_COUNT ) || ( len > CONFIG_NCE_UPLINK_QUEUE_POOL_SIZE ) )
+    {
+        return -EMSGSIZE;
+    }
+
+    k_mutex_lock( &queue_lock, K_FOREVER );
+    prv_purge_expired();
+    payload = prv_alloc_payload( priority, len );
+    slot = ( payload != NULL ) ? prv_claim_slot( priority ) : -1;
+
+    if( slot < 0 )
+    {
+        k_heap_free( &payload_pool, payload );
+        class_stats[ priority ].dropped++;
+        k_mutex_unlock( &queue_lock );
+        return -ENOBUFS;
+    }
+
+    slots[ slot ].priority = priority;
+    slots[ slot ].enqueued_at = k_uptime_get();
+    slots[ slot ].expires_at = ( ttl_s != 0 ) ? slots[ slot ].enqueued_at + ttl_s * MSEC_PER_SEC : 0;
+    slots[ slot ].format = format;
+    slots[ slot ].len = len;
+    slots[ slot ].data = payload;
+    memcpy( payload, data, len );
+    slot_used[ slot ] = true;
+    class_stats[ priority ].queued++;
+
+    k_condvar_signal( &queue_ready );
+    k_mutex_unlock( &queue_lock );
+
+    return 0;
+}
+
+int uplink_queue_get( struct uplink_msg * msg,
+                      k_timeout_t timeout )
+{
+    int slot;
+    uint32_t age_ms;
+
+    k_mutex_lock( &queue_lock, K_FOREVER );
+
+    while( 1 )
+    {
+        prv_purge_expired();
+        slot = prv_find( true );
+
+        if( slot >= 0 )
+        {
+            break;
+        }
+
+        /* Spurious wakeups restart the full timeout, which is fine for K_FOREVER callers */
+        if( k_condvar_wait( &queue_ready, &queue_lock, timeout ) != 0 )
+        {
+            k_mutex_unlock( &queue_lock );
+            return -EAGAIN;
+        }
+    }
+
+    *msg = slots[ slot ];
+    slot_used[ slot ] = false;
+    age_ms = ( uint32_t ) ( k_uptime_get() - msg->enqueued_at );
+    class_stats[ msg->priority ].sent++;
+    class_stats[ msg->priority ].max_age_ms = MAX( class_stats[ msg->priority ].max_age_ms, age_ms );
+
+    k_mutex_unlock( &queue_lock );
+
+    return 0;
+}
+
+void uplink_queue_putback( const struct uplink_msg * msg )
+{
+    int slot;
+
+    k_mutex_lock( &queue_lock, K_FOREVER );
+    class_stats[ msg->priority ].sent--;
+    prv_purge_expired();
+    slot = prv_claim_slot( msg->priority );
+
+    if( slot < 0 )
+    {
+        class_stats[ msg->priority ].dropped++;
+        k_heap_free( &payload_pool, msg->data );
+    }
+    else
+    {
+        /* The original enqueue time keeps it ahead of newer messages of its class */
+        slots[ slot ] = *msg;
+        slot_used[ slot ] = true;
+        k_condvar_signal( &queue_ready );
+    }
+
+    k_mutex_unlock( &queue_lock );
+}
+
+void uplink_queue_release( struct uplink_msg * msg )
+{
+    k_heap_free( &payload_pool, msg->data );
+    msg->data = NULL;
+}
+
+void uplink_queue_stats_get( enum uplink_priority priority,
+                             struct uplink_queue_stats * stats )
+{
+    k_mutex_lock( &queue_lock, K_FOREVER );
+    *stats = class_stats[ priority ];
+    k_mutex_unlock( &queue_lock );
+}
+
+#if defined( CONFIG_SHELL )
+static int prv_cmd_uplink_queue_show( const struct shell * shell,
+                                      size_t argc,
+                                      char ** argv )
+{
+    int pending[ UPLINK_PRIORITY_COUNT ] = { 0 };
+
+    k_mutex_lock( &queue_lock, K_FOREVER );
+    prv_purge_expired();
+
+    for(int i = 0; i < CONFIG_NCE_UPLINK_QUEUE_DEPTH; i++)
+    {
+        if( slot_used[ i ] )
+        {
+            pending[ slots[ i ].priority ]++;
+        }
+    }
+
+    k_mutex_unlock( &queue_lock );
+
+    for(int p = 0; p < UPLINK_PRIORITY_COUNT; p++)
+    {
+        struct uplink_queue_stats stats;
+
+        uplink_queue_stats_get( p, &stats );
+        shell_print( shell, "%-6s pending %d, queued %u, sent %u, expired %u, dropped %u, max age %u ms",
+                     class_names[ p ], pending[ p ], stats.queued, stats.sent, stats.expired, stats.dropped,
+                     stats.max_age_ms );
+    }
+
+    return 0;
+}
+
+static int prv_cmd_uplink_queue_alarm( const struct shell * shell,
+                                       size_t argc,
+                                       char ** argv )
+{
+    int err = uplink_queue_put( UPLINK_PRIORITY_ALARM, CONFIG_NCE_UPLINK_ALARM_TTL_SECONDS,
+                                COAP_CONTENT_FORMAT_TEXT_PLAIN, argv[ 1 ], strlen( argv[ 1 ] ) );
+
+    if( err )
+    {
+        shell_error( shell, "Failed to queue alarm, err %d", err );
+    }
+
+    return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE( uplink_queue_cmds,
+                                SHELL_CMD( show, NULL, "Show uplink queue counters per priority class", prv_cmd_uplink_queue_show ),
+                                SHELL_CMD_ARG( alarm, NULL, "Queue an alarm uplink <text>", prv_cmd_uplink_queue_alarm, 2, 0 ),
+                                SHELL_SUBCMD_SET_END
+                                );
+
+SHELL_CMD_REGISTER( uplink_queue, &uplink_queue_cmds, "Uplink priority queue", prv_cmd_uplink_queue_show );
+#endif /* if defined( CONFIG_SHELL ) */
@@ -0,0 +1,118 @@
+/**
+ * @file write_back.h
+ * @brief RAM write-back buffer for persisted keys.
+ *
+ * Saves are held in RAM, a later save of the same key replaces the pending
+ * one. The first pending save opens a window of
+ * CONFIG_NCE_WRITE_BACK_WINDOW_MS, after which all pending keys are written
+ * from the system workqueue through the write function given to
+ * write_back_init(). The buffer does not know the storage behind it: the
+ * LwM2M demo writes with the settings subsystem, the Mender demo to NVS.
+ *
+ * Only for state that can be lost on an unexpected reset. Flush before a
+ * planned reboot.
+ */
+
+#ifndef WRITE_BACK_H__
+#define WRITE_BACK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Write one key to flash.
+ *
+ * @param[in] name Key.
+ * @param[in] value Value.
+ * @param[in] len Length of the value, 0 deletes the key.
+ * @return 0 on success, negative error code otherwise.
+ */
+typedef int (* write_back_write_t)( const char * name,
+                                    const void * value,
+                                    size_t len );
+
+/**
+ * @brief Called for every pending key by write_back_foreach().
+ *
+ * Runs with the buffer locked and must not save, discard or flush.
+ *
+ * @return 0 to continue, anything else stops the iteration and is returned.
+ */
+typedef int (* write_back_entry_cb_t)( const char * name,
+                                       const void * value,
+                                       size_t len,
+                                       void * arg );
+
+/**
+ * @brief Set the function that writes keys to flash.
+ *
+ * @param[in] write Write function, called from the system workqueue or from
+ *                  the thread that calls write_back_flush().
+ * @return 0 on success, -EINVAL without a write function.
+ */
+int write_back_init( write_back_write_t write );
+
+/**
+ * @brief Save a key through the buffer.
+ *
+ * Values larger than CONFIG_NCE_WRITE_BACK_VALUE_SIZE, names longer than
+ * CONFIG_NCE_WRITE_BACK_NAME_LEN and new keys while the buffer is full are
+ * written right away.
+ *
+ * @param[in] name Key.
+ * @param[in] value Value, copied.
+ * @param[in] len Length of the value, 0 deletes the key.
+ * @return 0 on success, negative error code of a write-through otherwise.
+ */
+int write_back_save( const char * name,
+                     const void * value,
+                     size_t len );
+
+/**
+ * @brief Drop pending keys without writing them.
+ *
+ * For keys the storage owner is about to delete or rewrite itself, so a
+ * later flush does not bring back an outdated value.
+ *
+ * @param[in] prefix Keys starting with this prefix are dropped.
+ * @return Number of keys dropped.
+ */
+int write_back_discard( const char * prefix );
+
+/**
+ * @brief Visit every pending key, e.g. to serve loads before the flush.
+ *
+ * @param[in] cb Called for every pending key.
+ * @param[in] arg Passed to the callback.
+ * @return 0, or the first non-zero value returned by the callback.
+ */
+int write_back_foreach( write_back_entry_cb_t cb,
+                        void * arg );
+
+/**
+ * @brief Write all pending keys now.
+ *
+ * Blocks for the flash writes. A pending key stays visible to
+ * write_back_foreach() until its write has finished.
+ *
+ * @return 0 on success, negative error code of the last failed write otherwise.
+ */
+int write_back_flush( void );
+
+/**
+ * @brief Close the window now and flush from the system workqueue.
+ *
+ * Safe to call from callbacks that must not block.
+ */
+void write_back_flush_async( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WRITE_BACK_H__ */
@@ -0,0 +1,272 @@
+/******************************************************************************
+ * @file    write_back.c
+ * @brief   RAM write-back buffer for persisted keys
+ * @details Holds the latest value of every saved key and writes them through
+ *          the application's write function when the window closes or on a
+ *          flush. A flushed key is copied out under the lock and written
+ *          without it, so saves and loads never wait for flash. It is only
+ *          dropped from the buffer if no newer save arrived during its write.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#include "write_back.h"
+
+LOG_MODULE_REGISTER( write_back, CONFIG_NCE_WRITE_BACK_LOG_LEVEL );
+
+#define WB_NAME_LEN      CONFIG_NCE_WRITE_BACK_NAME_LEN
+#define WB_VALUE_SIZE    CONFIG_NCE_WRITE_BACK_VALUE_SIZE
+
+struct wb_entry
+{
+    char name[ WB_NAME_LEN + 1 ];
+    uint8_t value[ WB_VALUE_SIZE ];
+    size_t len;   /* 0 deletes the key */
+    uint32_t seq; /* Changes with every save, a flushed entry is only dropped if it did not */
+};
+
+static write_back_write_t backend_write;
+static struct wb_entry entries[ CONFIG_NCE_WRITE_BACK_ENTRIES ];
+static size_t entry_count;
+static uint32_t save_seq;
+
+/* Counters since boot */
+static uint32_t total_saves;
+static uint32_t total_coalesced;
+static uint32_t total_writes;
+static uint64_t total_blocked_us;
+static uint32_t max_blocked_us;
+
+static K_MUTEX_DEFINE( wb_lock );
+static K_MUTEX_DEFINE( flush_lock );
+
+static void prv_flush_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( flush_work, prv_flush_work_handler );
+
+/* Must be called with wb_lock held */
+static struct wb_entry * prv_find( const char * name )
+{
+    for(size_t i = 0; i < entry_count; i++)
+    {
+        if( strcmp( entries[ i ].name, name ) == 0 )
+        {
+            return &entries[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+/* Must be called with wb_lock held */
+static void prv_remove( struct wb_entry * entry )
+{
+    *entry = entries[ --entry_count ];
+}
+
+static int prv_write( const char * name,
+                      const void * value,
+                      size_t len )
+{
+    uint32_t start = k_cycle_get_32();
+    int ret = backend_write( name, value, len );
+    uint32_t blocked_us = k_cyc_to_us_floor32( k_cycle_get_32() - start );
+
+    k_mutex_lock( &wb_lock, K_FOREVER );
+    total_writes++;
+    total_blocked_us += blocked_us;
+    max_blocked_us = MAX( max_blocked_us, blocked_us );
+    k_mutex_unlock( &wb_lock );
+
+    return ret;
+}
+
+int write_back_init( write_back_write_t write )
+{
+    if( write == NULL )
+    {
+        return -EINVAL;
+    }
+
+    backend_write = write;
+
+    return 0;
+}
+
+int write_back_save( const char * name,
+                     const void * value,
+                     size_t len )
+{
+    struct wb_entry * entry;
+
+    if( backend_write == NULL )
+    {
+        return -EAGAIN;
+    }
+
+    k_mutex_lock( &wb_lock, K_FOREVER );
+    total_saves++;
+    entry = prv_find( name );
+
+    if( ( len > WB_VALUE_SIZE ) || ( ( entry == NULL ) &&
+                                     ( ( strlen( name ) > WB_NAME_LEN ) ||
+                                       ( entry_count == ARRAY_SIZE( entries ) ) ) ) )
+    {
+        if( entry != NULL )
+        {
+            /* The pending value is outdated by this one */
+            prv_remove( entry );
+        }
+
+        k_mutex_unlock( &wb_lock );
+        LOG_DBG( "Writing %s (%zu bytes) through", name, len );
+
+        return prv_write( name, value, len );
+    }
+
+    if( entry == NULL )
+    {
+        entry = &entries[ entry_count++ ];
+        strcpy( entry->name, name );
+    }
+    else
+    {
+        total_coalesced++;
+    }
+
+    if( len > 0 )
+    {
+        memcpy( entry->value, value, len );
+    }
+
+    entry->len = len;
+    entry->seq = ++save_seq;
+    k_mutex_unlock( &wb_lock );
+
+    /* Does not move a window that is already open */
+    k_work_schedule( &flush_work, K_MSEC( CONFIG_NCE_WRITE_BACK_WINDOW_MS ) );
+
+    return 0;
+}
+
+int write_back_discard( const char * prefix )
+{
+    size_t prefix_len = strlen( prefix );
+    int dropped = 0;
+
+    k_mutex_lock( &wb_lock, K_FOREVER );
+
+    for(size_t i = entry_count; i > 0; i--)
+    {
+        if( strncmp( entries[ i - 1 ].name, prefix, prefix_len ) == 0 )
+        {
+            prv_remove( &entries[ i - 1 ] );
+            dropped++;
+        }
+    }
+
+    k_mutex_unlock( &wb_lock );
+
+    return dropped;
+}
+
+int write_back_foreach( write_back_entry_cb_t cb,
+                        void * arg )
+{
+    int ret = 0;
+
+    k_mutex_lock( &wb_lock, K_FOREVER );
+
+    for(size_t i = 0; ( i < entry_count ) && ( ret == 0 ); i++)
+    {
+        ret = cb( entries[ i ].name, entries[ i ].value, entries[ i ].len, arg );
+    }
+
+    k_mutex_unlock( &wb_lock );
+
+    return ret;
+}
+
+int write_back_flush( void )
+{
+    /* Protected by flush_lock */
+    static struct wb_entry entry;
+    uint32_t flushed = 0;
+    int err = 0;
+
+    k_mutex_lock( &flush_lock, K_FOREVER );
+
+    while( true )
+    {
+        struct wb_entry * pending;
+        int ret;
+
+        k_mutex_lock( &wb_lock, K_FOREVER );
+
+        if( entry_count == 0 )
+        {
+            k_mutex_unlock( &wb_lock );
+            break;
+        }
+
+        entry = entries[ 0 ];
+        k_mutex_unlock( &wb_lock );
+
+        ret = prv_write( entry.name, entry.value, entry.len );
+
+        if( ret )
+        {
+            LOG_ERR( "Failed to write %s (%d)", entry.name, ret );
+            err = ret;
+        }
+
+        /* Loads keep seeing the pending value until it is in flash, a newer one is written next */
+        k_mutex_lock( &wb_lock, K_FOREVER );
+        pending = prv_find( entry.name );
+
+        if( ( pending != NULL ) && ( pending->seq == entry.seq ) )
+        {
+            prv_remove( pending );
+        }
+
+        k_mutex_unlock( &wb_lock );
+        flushed++;
+    }
+
+    k_mutex_unlock( &flush_lock );
+
+    if( flushed > 0 )
+    {
+        k_mutex_lock( &wb_lock, K_FOREVER );
+        LOG_INF( "Flushed %u keys, %u of %u saves coalesced, %u flash writes, "
+                 "%u ms blocked (max %u ms) since boot",
+                 flushed, total_coalesced, total_saves, total_writes,
+                 ( uint32_t ) ( total_blocked_us / USEC_PER_MSEC ), max_blocked_us / USEC_PER_MSEC );
+        k_mutex_unlock( &wb_lock );
+    }
+
+    return err;
+}
+
+void write_back_flush_async( void )
+{
+    k_work_reschedule( &flush_work, K_NO_WAIT );
+}
+
+static void prv_flush_work_handler( struct k_work * work )
+{
+    ARG_UNUSED( work );
+
+    write_back_flush();
+}
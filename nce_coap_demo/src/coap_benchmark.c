@@ -0,0 +1,161 @@
+/******************************************************************************
+ * @file    coap_benchmark.c
+ * @brief   CoAP uplink load benchmark
+ * @details Sends a fixed number of confirmable requests back to back through
+ *          coap_client and reports messages per second, p50/p99 latency,
+ *          timeouts and retransmissions. Meant to run against the host-side
+ *          server stand-in in tools/ on native_sim.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdlib.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "coap_benchmark.h"
+
+LOG_MODULE_DECLARE( NCE_COAP_DEMO, CONFIG_COAP_CLIENT_SAMPLE_LOG_LEVEL );
+
+/* Time to wait for coap_client to free a request slot after a response */
+#define BENCHMARK_SLOT_WAIT_MS    10
+
+static K_SEM_DEFINE( benchmark_response, 0, 1 );
+static uint32_t benchmark_latency_ms[ CONFIG_NCE_COAP_BENCHMARK_REQUESTS ];
+static struct coap_stats * benchmark_stats;
+static int64_t benchmark_sent_at;
+static struct coap_transmission_parameters benchmark_params;
+static int16_t benchmark_code;
+static int benchmark_retransmissions;
+
+static void prv_benchmark_response( int16_t code,
+                                    size_t offset,
+                                    const uint8_t * payload,
+                                    size_t len,
+                                    bool last_block,
+                                    void * user_data )
+{
+    if( offset == 0 )
+    {
+        benchmark_code = code;
+        benchmark_retransmissions = coap_stats_client_response( benchmark_stats, benchmark_sent_at, &benchmark_params, code,
+                                                                len );
+    }
+
+    if( last_block || ( code < 0 ) )
+    {
+        k_sem_give( &benchmark_response );
+    }
+}
+
+static int prv_compare_u32( const void * a,
+                            const void * b )
+{
+    uint32_t x = *( const uint32_t * ) a;
+    uint32_t y = *( const uint32_t * ) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+static uint32_t prv_percentile( const uint32_t * sorted,
+                                size_t count,
+                                int percent )
+{
+    size_t rank = DIV_ROUND_UP( count * percent, 100 );
+
+    return sorted[ MAX( rank, 1 ) - 1 ];
+}
+
+int coap_benchmark_run( struct coap_client * client,
+                        int fd,
+                        const struct coap_client_request * req,
+                        struct coap_stats * stats )
+{
+    struct coap_client_request bench_req = *req;
+    size_t completed = 0;
+    uint32_t timeouts = 0;
+    uint32_t errors = 0;
+    uint32_t retransmissions = 0;
+    int64_t started;
+    int64_t duration;
+    int err = 0;
+
+    bench_req.cb = prv_benchmark_response;
+    bench_req.user_data = NULL;
+    benchmark_stats = stats;
+
+    LOG_INF( "CoAP benchmark: %d requests of %zu bytes", CONFIG_NCE_COAP_BENCHMARK_REQUESTS, req->len );
+    started = k_uptime_get();
+
+    for(int i = 0; i < CONFIG_NCE_COAP_BENCHMARK_REQUESTS; i++)
+    {
+        k_sem_reset( &benchmark_response );
+        benchmark_params = coap_get_transmission_parameters();
+        coap_stats_rto_apply( stats, &benchmark_params );
+        benchmark_sent_at = k_uptime_get();
+        coap_stats_tx( stats, req->len, false );
+
+        /* The slot of the previous request is released after its callback returned */
+        do
+        {
+            err = coap_client_req( client, fd, NULL, &bench_req, &benchmark_params );
+
+            if( err == -EAGAIN )
+            {
+                k_sleep( K_MSEC( BENCHMARK_SLOT_WAIT_MS ) );
+            }
+        } while( err == -EAGAIN );
+
+        if( err )
+        {
+            LOG_ERR( "CoAP benchmark: request %d failed, err %d", i, err );
+            break;
+        }
+
+        if( k_sem_take( &benchmark_response, K_SECONDS( CONFIG_NCE_COAP_BENCHMARK_TIMEOUT_SECONDS ) ) != 0 )
+        {
+            LOG_ERR( "CoAP benchmark: no answer to request %d from coap_client", i );
+            coap_client_cancel_requests( client );
+            err = -ETIMEDOUT;
+            break;
+        }
+
+        if( benchmark_code < 0 )
+        {
+            timeouts++;
+            continue;
+        }
+
+        if( ( benchmark_code >> 5 ) != 2 )
+        {
+            errors++;
+        }
+
+        retransmissions += benchmark_retransmissions;
+        benchmark_latency_ms[ completed++ ] = ( uint32_t ) ( k_uptime_get() - benchmark_sent_at );
+    }
+
+    duration = MAX( k_uptime_get() - started, 1 );
+
+    LOG_INF( "CoAP benchmark: %zu responses, %u error responses, %u timeouts in %lld ms",
+             completed, errors, timeouts, duration );
+    LOG_INF( "CoAP benchmark: %lld.%02lld msg/s, %u retransmissions (inferred), RTO now %u ms",
+             completed * 1000LL / duration, ( completed * 100000LL / duration ) % 100, retransmissions,
+             coap_stats_rto( stats ) );
+
+    if( completed > 0 )
+    {
+        qsort( benchmark_latency_ms, completed, sizeof( benchmark_latency_ms[ 0 ] ), prv_compare_u32 );
+        LOG_INF( "CoAP benchmark: latency min %u ms, p50 %u ms, p99 %u ms, max %u ms",
+                 benchmark_latency_ms[ 0 ], prv_percentile( benchmark_latency_ms, completed, 50 ),
+                 prv_percentile( benchmark_latency_ms, completed, 99 ), benchmark_latency_ms[ completed - 1 ] );
+    }
+
+    return err;
+}
@@ -0,0 +1,326 @@
+/******************************************************************************
+ * @file    coap_block1.c
+ * @brief   Block-wise CoAP uplink (RFC 7959 Block1)
+ * @details Splits a request body into Block1 requests sent as confirmable POSTs
+ *          through coap_client, which owns the socket, retransmits and
+ *          reports every response to a callback. The block size starts at
+ *          CONFIG_NCE_BLOCK1_SIZE and shrinks when the server answers 4.13.
+ *          When the server acknowledges intermediate blocks with a final
+ *          success code (non-atomic handling), up to CONFIG_NCE_BLOCK1_WINDOW
+ *          blocks are kept in flight, bounded by the coap_client request
+ *          slots. Transient failures, 5.xx responses included, resume from
+ *          the last block acknowledged by the server. coap_client does not
+ *          pass response options to its callback, so the Block1 size a server
+ *          may suggest in a 2.31 Continue response is not followed.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#include "coap_block1.h"
+
+LOG_MODULE_DECLARE( NCE_COAP_DEMO, CONFIG_COAP_CLIENT_SAMPLE_LOG_LEVEL );
+
+BUILD_ASSERT( IS_POWER_OF_TWO( CONFIG_NCE_BLOCK1_SIZE ), "CONFIG_NCE_BLOCK1_SIZE must be a power of two" );
+
+#define BLOCK1_MORE_FLAG        0x08
+#define BLOCK1_WINDOW           MIN( CONFIG_NCE_BLOCK1_WINDOW, CONFIG_COAP_CLIENT_MAX_REQUESTS )
+
+/* Time to wait for coap_client to free a request slot */
+#define BLOCK1_SLOT_WAIT_MS     100
+
+/** @brief One block handed to coap_client. */
+struct block1_request
+{
+    struct coap_client_request req;
+    struct coap_client_option options[ 2 ];           /* Block1 and, with the first block, Size1 */
+    struct coap_transmission_parameters params;
+    struct coap_block1_transfer * xfer;
+    size_t offset;
+    int64_t sent_at;
+    int16_t code;                                     /* Response code, negative when coap_client gave up */
+};
+
+static struct block1_request requests[ BLOCK1_WINDOW ];
+static K_SEM_DEFINE( block1_response, 0, BLOCK1_WINDOW );
+
+/* Largest block size that does not exceed the given number of bytes */
+static enum coap_block_size prv_block_size_from_bytes( size_t bytes )
+{
+    enum coap_block_size szx = COAP_BLOCK_16;
+
+    while( ( szx < COAP_BLOCK_1024 ) && ( coap_block_size_to_bytes( szx + 1 ) <= bytes ) )
+    {
+        szx++;
+    }
+
+    return szx;
+}
+
+/* Encode an unsigned integer option value in as few bytes as possible */
+static void prv_option_int( struct coap_client_option * option,
+                            uint16_t code,
+                            uint32_t value )
+{
+    uint8_t bytes[ sizeof( value ) ];
+
+    sys_put_be32( value, bytes );
+    option->code = code;
+    option->len = 0;
+
+    for(size_t i = 0; i < sizeof( bytes ); i++)
+    {
+        if( ( option->len > 0 ) || ( bytes[ i ] != 0 ) )
+        {
+            option->value[ option->len++ ] = bytes[ i ];
+        }
+    }
+}
+
+/* Called by coap_client for the response or the timeout of a block */
+static void prv_block1_response( int16_t code,
+                                 size_t offset,
+                                 const uint8_t * payload,
+                                 size_t len,
+                                 bool last_block,
+                                 void * user_data )
+{
+    struct block1_request * request = user_data;
+
+    if( offset == 0 )
+    {
+        request->code = code;
+        #if defined( CONFIG_NCE_COAP_STATS )
+        coap_stats_client_response( request->xfer->stats, request->sent_at, &request->params, code, len );
+        #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+    }
+
+    if( last_block || ( code < 0 ) )
+    {
+        k_sem_give( &block1_response );
+    }
+}
+
+/* Hand the block starting at the given offset to coap_client */
+static int prv_send_block( struct coap_client * client,
+                           int fd,
+                           struct coap_block1_transfer * xfer,
+                           struct block1_request * request,
+                           size_t offset )
+{
+    int err;
+    size_t block_len = coap_block_size_to_bytes( xfer->block_size );
+    size_t chunk = MIN( block_len, xfer->len - offset );
+    bool more = ( offset + chunk ) < xfer->len;
+    uint32_t block1 = ( ( offset / block_len ) << 4 ) | ( more ? BLOCK1_MORE_FLAG : 0 ) | xfer->block_size;
+
+    memset( request, 0, sizeof( *request ) );
+    request->xfer = xfer;
+    request->offset = offset;
+    request->req.method = COAP_METHOD_POST;
+    request->req.confirmable = true;
+    request->req.path = xfer->path;
+    request->req.fmt = xfer->fmt;
+    request->req.payload = xfer->payload + offset;
+    request->req.len = chunk;
+    request->req.cb = prv_block1_response;
+    request->req.user_data = request;
+    request->req.options = request->options;
+
+    prv_option_int( &request->options[ request->req.num_options++ ], COAP_OPTION_BLOCK1, block1 );
+
+    if( offset == 0 )
+    {
+        /* Announce the total size with the first block */
+        prv_option_int( &request->options[ request->req.num_options++ ], COAP_OPTION_SIZE1, xfer->len );
+    }
+
+    request->params = coap_get_transmission_parameters();
+    #if defined( CONFIG_NCE_COAP_STATS )
+    coap_stats_rto_apply( xfer->stats, &request->params );
+    #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+    request->sent_at = k_uptime_get();
+
+    err = coap_client_req( client, fd, NULL, &request->req, &request->params );
+
+    if( err )
+    {
+        return err;
+    }
+
+    #if defined( CONFIG_NCE_COAP_STATS )
+    coap_stats_tx( xfer->stats, chunk, offset < xfer->sent );
+    #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+    xfer->sent = MAX( xfer->sent, offset + chunk );
+    xfer->blocks_sent++;
+    LOG_DBG( "Block1 %u sent (%zu bytes, more: %d)", ( uint32_t ) ( offset / block_len ), chunk, more );
+
+    return 0;
+}
+
+/*
+ * Send up to one window of blocks from the last acknowledged offset and wait until
+ * coap_client reported all of them. Returns 0 when the window made progress or the
+ * block size changed.
+ */
+static int prv_send_window( struct coap_client * client,
+                            int fd,
+                            struct coap_block1_transfer * xfer )
+{
+    int err = 0;
+    size_t block_len = coap_block_size_to_bytes( xfer->block_size );
+    int window = xfer->pipelining ? BLOCK1_WINDOW : 1;
+    int in_flight = 0;
+
+    k_sem_reset( &block1_response );
+
+    for(size_t offset = xfer->acked; ( offset < xfer->len ) && ( in_flight < window ); offset += block_len)
+    {
+        err = prv_send_block( client, fd, xfer, &requests[ in_flight ], offset );
+
+        if( err )
+        {
+            break;
+        }
+
+        in_flight++;
+    }
+
+    if( ( in_flight == 0 ) && ( err == -EAGAIN ) )
+    {
+        /* All coap_client request slots are busy, try again once one is free */
+        k_sleep( K_MSEC( BLOCK1_SLOT_WAIT_MS ) );
+        return 0;
+    }
+
+    if( in_flight == 0 )
+    {
+        return err;
+    }
+
+    /* coap_client retransmits the blocks itself and reports each of them, a timeout included */
+    for(int i = 0; i < in_flight; i++)
+    {
+        if( k_sem_take( &block1_response, K_SECONDS( CONFIG_NCE_UPLINK_RESPONSE_TIMEOUT_SECONDS ) ) != 0 )
+        {
+            LOG_ERR( "No outcome of Block1 requests from coap_client" );
+            coap_client_cancel_requests( client );
+            return -ETIMEDOUT;
+        }
+    }
+
+    for(int i = 0; i < in_flight; i++)
+    {
+        struct block1_request * request = &requests[ i ];
+        int16_t code = request->code;
+
+        if( code < 0 )
+        {
+            return code;
+        }
+
+        if( ( code >> 5 ) == 2 )
+        {
+            if( ( code != COAP_RESPONSE_CODE_CONTINUE ) && !xfer->pipelining &&
+                ( request->offset + block_len < xfer->len ) )
+            {
+                LOG_INF( "Server handles blocks non-atomically, pipelining up to %d blocks", BLOCK1_WINDOW );
+                xfer->pipelining = true;
+            }
+        }
+        else if( code == COAP_RESPONSE_CODE_REQUEST_TOO_LARGE )
+        {
+            if( xfer->block_size == COAP_BLOCK_16 )
+            {
+                LOG_ERR( "Server rejected the smallest Block1 size" );
+                return -EBADMSG;
+            }
+
+            /* The acknowledged offset stays aligned to the smaller block size */
+            xfer->block_size--;
+            LOG_INF( "Server rejected the block size, continuing with %d bytes",
+                     coap_block_size_to_bytes( xfer->block_size ) );
+            return 0;
+        }
+        else if( code == COAP_RESPONSE_CODE_INCOMPLETE )
+        {
+            /* Server lost the transfer state, the body has to be sent again */
+            xfer->acked = 0;
+            return -EAGAIN;
+        }
+        else if( ( code >> 5 ) == 5 )
+        {
+            /* Server side failure, the blocks it acknowledged so far stay valid */
+            LOG_WRN( "Block1 request failed with code %d.%02d", code >> 5, code & 0x1f );
+            return -EIO;
+        }
+        else
+        {
+            LOG_ERR( "Block1 request rejected with code %d.%02d", code >> 5, code & 0x1f );
+            return -EBADMSG;
+        }
+
+        xfer->acked = MIN( request->offset + block_len, xfer->len );
+    }
+
+    return 0;
+}
+
+void coap_block1_init( struct coap_block1_transfer * xfer,
+                       const char * path,
+                       enum coap_content_format fmt,
+                       const uint8_t * payload,
+                       size_t len )
+{
+    memset( xfer, 0, sizeof( *xfer ) );
+    xfer->path = path;
+    xfer->fmt = fmt;
+    xfer->payload = payload;
+    xfer->len = len;
+    xfer->block_size = prv_block_size_from_bytes( CONFIG_NCE_BLOCK1_SIZE );
+}
+
+int coap_block1_send( struct coap_client * client,
+                      int fd,
+                      struct coap_block1_transfer * xfer )
+{
+    int err;
+
+    while( xfer->acked < xfer->len )
+    {
+        err = prv_send_window( client, fd, xfer );
+
+        if( err == 0 )
+        {
+            continue;
+        }
+
+        if( ( err == -EBADMSG ) || ( xfer->resumes >= CONFIG_NCE_BLOCK1_MAX_RESUMES ) )
+        {
+            LOG_ERR( "Block1 transfer failed at offset %zu/%zu, err %d", xfer->acked, xfer->len, err );
+            return err;
+        }
+
+        xfer->resumes++;
+        LOG_WRN( "Block1 transfer interrupted (err %d), resuming at offset %zu (%u/%d)",
+                 err, xfer->acked, xfer->resumes, CONFIG_NCE_BLOCK1_MAX_RESUMES );
+        k_sleep( K_SECONDS( 1 << xfer->resumes ) );
+    }
+
+    LOG_INF( "Block1 transfer of %zu bytes complete: %u blocks sent, %u resumes",
+             xfer->len, xfer->blocks_sent, xfer->resumes );
+
+    return 0;
+}
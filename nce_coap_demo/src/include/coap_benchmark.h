@@ -0,0 +1,39 @@
+/**
+ * @file coap_benchmark.h
+ * @brief Closed-loop load benchmark of the CoAP uplink path.
+ */
+
+#ifndef COAP_BENCHMARK_H__
+#define COAP_BENCHMARK_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap_client.h>
+#include "coap_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Send CONFIG_NCE_COAP_BENCHMARK_REQUESTS copies of a request back to back.
+ *
+ * Each request is sent as soon as the previous one completed. Throughput,
+ * p50/p99/max latency, timeouts and inferred retransmissions are logged when
+ * the run ends and recorded in the CoAP statistics of the destination.
+ *
+ * @param[in] client CoAP client the uplink uses.
+ * @param[in] fd Connected uplink socket.
+ * @param[in] req Request to repeat, its callback is not called during the run.
+ * @param[in] stats Statistics of the destination, may be NULL.
+ * @return 0 when the run completed, negative errno when a request could not be sent.
+ */
+int coap_benchmark_run( struct coap_client * client,
+                        int fd,
+                        const struct coap_client_request * req,
+                        struct coap_stats * stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_BENCHMARK_H__ */
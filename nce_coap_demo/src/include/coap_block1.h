@@ -0,0 +1,78 @@
+/**
+ * @file coap_block1.h
+ * @brief Block-wise CoAP uplink (RFC 7959 Block1) for payloads larger than one datagram.
+ */
+
+#ifndef COAP_BLOCK1_H__
+#define COAP_BLOCK1_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/coap_client.h>
+
+#if defined( CONFIG_NCE_COAP_STATS )
+    #include "coap_stats.h"
+#endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief State of one Block1 transfer.
+ *
+ * The transfer keeps the number of bytes confirmed by the server, so a transient
+ * failure resumes from the last acknowledged block instead of the start of the body.
+ */
+struct coap_block1_transfer
+{
+    const char * path;                 /**< Uri-Path and Uri-Query, e.g. "/?t=test". */
+    enum coap_content_format fmt;      /**< Content-Format of the body. */
+    const uint8_t * payload;           /**< Full request body. */
+    size_t len;                        /**< Length of the body. */
+    size_t acked;                      /**< Bytes acknowledged by the server. */
+    size_t sent;                       /**< Bytes sent at least once, sending them again is a retransmission. */
+    enum coap_block_size block_size;   /**< Block size currently in use (may shrink during negotiation). */
+    bool pipelining;                   /**< Server handles blocks non-atomically, several may be in flight. */
+    uint32_t blocks_sent;
+    uint32_t resumes;
+    #if defined( CONFIG_NCE_COAP_STATS )
+    struct coap_stats * stats;         /**< Destination statistics, NULL to not record any. */
+    #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+};
+
+/**
+ * @brief Prepare a Block1 transfer.
+ *
+ * @param[out] xfer Transfer to initialize.
+ * @param[in] path Uri-Path and Uri-Query of the target resource.
+ * @param[in] fmt Content-Format of the body.
+ * @param[in] payload Request body, must stay valid until the transfer ends.
+ * @param[in] len Length of the body.
+ */
+void coap_block1_init( struct coap_block1_transfer * xfer,
+                       const char * path,
+                       enum coap_content_format fmt,
+                       const uint8_t * payload,
+                       size_t len );
+
+/**
+ * @brief Send a Block1 transfer as confirmable POST requests through coap_client.
+ *
+ * Every block is a coap_client request, so responses are taken from the
+ * coap_client receive thread and never read from the socket directly.
+ *
+ * @param[in] client CoAP client that owns the socket.
+ * @param[in] fd Connected UDP or DTLS socket.
+ * @param[in,out] xfer Transfer to send.
+ * @return 0 when the server confirmed the whole body, negative error code otherwise.
+ */
+int coap_block1_send( struct coap_client * client,
+                      int fd,
+                      struct coap_block1_transfer * xfer );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAP_BLOCK1_H__ */
@@ -0,0 +1,102 @@
+/**
+ * @file senml_cbor.h
+ * @brief Streaming SenML-CBOR (RFC 8428) encoder for the CoAP uplink.
+ */
+
+#ifndef SENML_CBOR_H__
+#define SENML_CBOR_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief CoAP Content-Format of application/senml+cbor. */
+#define SENML_CBOR_CONTENT_FORMAT    112
+
+/**
+ * @brief SenML-CBOR writer state.
+ *
+ * Records are written straight into the caller's buffer. The base name and base time
+ * are only carried by the first record, later records hold their name and their time
+ * relative to the base time.
+ */
+struct senml_cbor_writer
+{
+    uint8_t * buf;
+    size_t size;
+    size_t offset;
+    uint16_t records;
+    const char * base_name;
+    int32_t base_time;
+    size_t json_len; /**< Size the same pack would have as SenML-JSON. */
+};
+
+/**
+ * @brief Start a SenML pack.
+ *
+ * @param[out] writer Writer to initialize.
+ * @param[in] buf Output buffer.
+ * @param[in] size Size of the output buffer.
+ * @param[in] base_name Base name prepended to all record names, NULL for none.
+ * @param[in] base_time Base time in seconds, values below 2^28 are relative to now.
+ * @return 0 on success, negative error code on failure.
+ */
+int senml_cbor_begin( struct senml_cbor_writer * writer,
+                      uint8_t * buf,
+                      size_t size,
+                      const char * base_name,
+                      int32_t base_time );
+
+/**
+ * @brief Append a record with a numeric value.
+ *
+ * @param[in,out] writer Writer.
+ * @param[in] name Record name, appended to the base name.
+ * @param[in] unit SenML unit, NULL for none.
+ * @param[in] value Value.
+ * @param[in] time Record time in the same reference as the base time.
+ * @return 0 on success, -ENOMEM if the buffer is full.
+ */
+int senml_cbor_put_int( struct senml_cbor_writer * writer,
+                        const char * name,
+                        const char * unit,
+                        int32_t value,
+                        int32_t time );
+
+/**
+ * @brief Append a record with a boolean value.
+ *
+ * @return 0 on success, -ENOMEM if the buffer is full.
+ */
+int senml_cbor_put_bool( struct senml_cbor_writer * writer,
+                         const char * name,
+                         bool value,
+                         int32_t time );
+
+/**
+ * @brief Append a record with a string value.
+ *
+ * @return 0 on success, -ENOMEM if the buffer is full.
+ */
+int senml_cbor_put_string( struct senml_cbor_writer * writer,
+                           const char * name,
+                           const char * value,
+                           int32_t time );
+
+/**
+ * @brief Finish the pack.
+ *
+ * @param[in,out] writer Writer.
+ * @param[out] len Encoded length of the pack.
+ * @return 0 on success, negative error code on failure.
+ */
+int senml_cbor_end( struct senml_cbor_writer * writer,
+                    size_t * len );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENML_CBOR_H__ */
@@ -34,6 +34,7 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/sys/reboot.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/net/coap.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/net/conn_mgr_connectivity.h>
@@ -46,6 +47,23 @@
 #include <modem/nrf_modem_lib.h>
 #include "nce_iot_c_sdk.h"
 #include <network_interface_zephyr.h>
+#if defined( CONFIG_NCE_BLOCK1_UPLINK )
+    #include "coap_block1.h"
+#endif /* if defined( CONFIG_NCE_BLOCK1_UPLINK ) */
+#if defined( CONFIG_NCE_SENML_CBOR )
+    #include "senml_cbor.h"
+#endif /* if defined( CONFIG_NCE_SENML_CBOR ) */
+
+#include "uplink_queue.h"
+#if defined( CONFIG_NCE_NAT_KEEPALIVE )
+    #include "nat_keepalive.h"
+#endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
+#if defined( CONFIG_NCE_COAP_STATS )
+    #include "coap_stats.h"
+#endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+#if defined( CONFIG_NCE_COAP_BENCHMARK )
+    #include "coap_benchmark.h"
+#endif /* if defined( CONFIG_NCE_COAP_BENCHMARK ) */
 
 LOG_MODULE_REGISTER( NCE_COAP_DEMO, CONFIG_COAP_CLIENT_SAMPLE_LOG_LEVEL );
 
@@ -53,6 +71,7 @@ LOG_MODULE_REGISTER( NCE_COAP_DEMO, CONFIG_COAP_CLIENT_SAMPLE_LOG_LEVEL );
     #include <modem/modem_key_mgmt.h>
     #include <nrf_modem_at.h>
     #include <zephyr/net/tls_credentials.h>
+    #include <zephyr/settings/settings.h>
 #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
 #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
     #include <zephyr/drivers/gpio.h>
@@ -77,6 +96,8 @@ static struct gpio_dt_spec ledBlue = GPIO_DT_SPEC_GET_OR( DT_ALIAS( led2 ), gpio
 
 /** @brief Kernel stack and threading configurations */
 #define UPLINK_STACK_SIZE    4096
+/** @brief Time to wait for coap_client to free a request slot. */
+#define UPLINK_SLOT_WAIT_MS    100
 K_THREAD_STACK_DEFINE( uplink_thread_stack, UPLINK_STACK_SIZE );
 struct k_thread uplink_thread;
 static int uplink_fd = -1;
@@ -87,12 +108,48 @@ struct coap_client coap_client = { 0 };
 
 
 #if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER )
-    #define DOWNLINK_STACK_SIZE    3072
+    #define DOWNLINK_STACK_SIZE             3072
+    #define DOWNLINK_WORKER_STACK_SIZE      2048
+    #define DOWNLINK_WORKER_PRIORITY        ( THREAD_PRIORITY + 1 )
 K_THREAD_STACK_DEFINE( downlink_thread_stack, DOWNLINK_STACK_SIZE );
 struct k_thread downlink_thread;
+K_THREAD_STACK_DEFINE( downlink_worker_stack, DOWNLINK_WORKER_STACK_SIZE );
+struct k_thread downlink_worker;
 static int downlink_fd = -1;
     #define COAP_CODE_CLASS_SIZE       32
     #define COAP_SUCCESS_CODE_CLASS    2
+    #define COAP_HEADER_LEN            4
+    #define COAP_ACK_MAX_LEN           ( COAP_HEADER_LEN + COAP_TOKEN_MAX_LEN )
+
+/** @brief Acknowledged downlink message waiting for the worker. */
+struct downlink_msg
+{
+    int64_t received_at;
+    uint32_t ack_latency_us;
+    uint16_t len;
+    uint8_t data[ CONFIG_NCE_RECEIVE_BUFFER_SIZE ];
+};
+
+K_MSGQ_DEFINE( downlink_queue, sizeof( struct downlink_msg ), CONFIG_NCE_DOWNLINK_QUEUE_DEPTH, 4 );
+static uint32_t downlink_dropped_count;  /**< Messages dropped because the queue was full. */
+static uint32_t downlink_overflow_count; /**< Messages that filled the receive buffer and may be truncated. */
+    #if defined( CONFIG_NCE_DOWNLINK_DEDUP )
+
+/** @brief Recently handled downlink message and the ACK it was answered with. */
+struct downlink_dedup_entry
+{
+    struct sockaddr_in sender;
+    uint16_t id;
+    uint8_t token_len;
+    uint8_t token[ COAP_TOKEN_MAX_LEN ];
+    int64_t expires_at;
+    uint8_t ack_len;
+    uint8_t ack[ COAP_ACK_MAX_LEN ];
+};
+
+static struct downlink_dedup_entry downlink_dedup_cache[ CONFIG_NCE_DOWNLINK_DEDUP_CACHE_SIZE ];
+static uint32_t downlink_duplicate_count;
+    #endif /* if defined( CONFIG_NCE_DOWNLINK_DEDUP ) */
 #endif
 /** @brief Macro for handling fatal errors by rebooting the device. */
 #define FATAL_ERROR()                                    \
@@ -104,6 +161,10 @@ static int downlink_fd = -1;
 static struct net_mgmt_event_callback l4_cb;
 static struct net_mgmt_event_callback conn_cb;
 static bool is_connected; /**< Indicates if network is connected. */
+static bool network_lost;        /**< Connectivity was lost since the last successful uplink. */
+static int64_t network_restored_at;
+static uint32_t network_recovery_count;
+static int64_t network_recovery_total_ms;
 
 /** @brief Mutex and conditional variable for network connectivity signaling. */
 K_MUTEX_DEFINE( network_connected_lock );
@@ -117,7 +178,22 @@ const sec_tag_t tls_sec_tag[] =
 };
 DtlsKey_t nceKey = { 0 };
 int connection_failure_count = 0;
-extern void sys_arch_reboot( int type );
+
+/** @brief Onboarding progress, persisted so an interrupted credential update is redone on the next boot. */
+#define ONBOARDING_SETTINGS_KEY       "nce/onboarding"
+/** @brief Attempts to bring LTE back to normal mode after storing credentials. */
+#define ONBOARDING_LTE_NORMAL_TRIES    3
+enum onboarding_state
+{
+    ONBOARDING_STATE_IDLE = 0,
+    ONBOARDING_STATE_IN_PROGRESS,
+    ONBOARDING_STATE_DONE,
+};
+static uint8_t onboarding_state = ONBOARDING_STATE_IDLE;
+
+/** @brief Number of uplink DTLS handshakes, split by full and resumed (cached session). */
+static uint32_t dtls_full_handshake_count;
+static uint32_t dtls_resumed_handshake_count;
 #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
 
 #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
@@ -195,6 +271,10 @@ static void wait_for_network( void )
     if( !is_connected )
     {
         LOG_INF( "Waiting for network connectivity" );
+    }
+
+    while( !is_connected )
+    {
         k_condvar_wait( &network_connected, &network_connected_lock, K_FOREVER );
     }
 
@@ -212,6 +292,87 @@ static void wait_for_network( void )
     k_mutex_unlock( &network_connected_lock );
 }
 
+static bool prv_network_is_connected( void )
+{
+    bool connected;
+
+    k_mutex_lock( &network_connected_lock, K_FOREVER );
+    connected = is_connected;
+    k_mutex_unlock( &network_connected_lock );
+
+    return connected;
+}
+
+/* Report the time from connectivity returning to the first uplink the server answered with 2.xx */
+static void prv_uplink_recovery_report( void )
+{
+    int64_t elapsed = -1;
+
+    k_mutex_lock( &network_connected_lock, K_FOREVER );
+
+    if( network_restored_at > 0 )
+    {
+        elapsed = k_uptime_get() - network_restored_at;
+        network_restored_at = 0;
+        network_recovery_count++;
+        network_recovery_total_ms += elapsed;
+    }
+
+    k_mutex_unlock( &network_connected_lock );
+
+    if( elapsed >= 0 )
+    {
+        LOG_INF( "First acknowledged uplink %lld ms after connectivity returned (mean %lld ms over %u recoveries)",
+                 elapsed, network_recovery_total_ms / network_recovery_count, network_recovery_count );
+    }
+}
+
+#if defined( CONFIG_NCE_COAP_STATS )
+static struct coap_stats * uplink_stats;
+static int64_t uplink_sent_at;
+static struct coap_transmission_parameters uplink_params;
+
+static void prv_uplink_stats_response( int16_t code,
+                                       size_t offset,
+                                       size_t len )
+{
+    if( offset > 0 )
+    {
+        /* Later blocks of a Block2 response belong to their own exchanges */
+        return;
+    }
+
+    coap_stats_client_response( uplink_stats, uplink_sent_at, &uplink_params, code, len );
+}
+#endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+/** @brief Given when coap_client reported the outcome of the pending uplink request. */
+static K_SEM_DEFINE( uplink_response, 0, 1 );
+/** @brief Response code of the pending uplink request, negative when coap_client gave up. */
+static int16_t uplink_response_code;
+
+/* Map the outcome of an uplink request to 0 for 2.xx, -EBADMSG for a rejection and a transient error otherwise */
+static int prv_uplink_response_err( int16_t code )
+{
+    if( code < 0 )
+    {
+        return code;
+    }
+
+    switch( code >> 5 )
+    {
+        case 2:
+            return 0;
+
+        case 5:
+            /* Server side failure, the same message may be accepted later */
+            return -EIO;
+
+        default:
+            return -EBADMSG;
+    }
+}
+
 static void response_cb( int16_t code,
                          size_t offset,
                          const uint8_t * payload,
@@ -219,6 +380,16 @@ static void response_cb( int16_t code,
                          bool last_block,
                          void * user_data )
 {
+    #if defined( CONFIG_NCE_COAP_STATS )
+    prv_uplink_stats_response( code, offset, len );
+    #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+    if( ( offset == 0 ) || ( code < 0 ) )
+    {
+        /* Later blocks of a Block2 response carry the code of the first one */
+        uplink_response_code = code;
+    }
+
     if( code >= 0 )
     {
         LOG_INF( "CoAP response: code: 0x%x", code );
@@ -227,6 +398,11 @@ static void response_cb( int16_t code,
     {
         LOG_INF( "Response received with error code: %d", code );
     }
+
+    if( last_block || ( code < 0 ) )
+    {
+        k_sem_give( &uplink_response );
+    }
 }
 #if defined( CONFIG_NCE_ENABLE_DTLS )
 /* Store DTLS Credentials in the modem */
@@ -257,9 +433,51 @@ int store_credentials( void )
     return err;
 }
 
+/* Settings loader for the persisted onboarding state */
+static int prv_onboarding_state_load_cb( const char * key,
+                                         size_t len,
+                                         settings_read_cb read_cb,
+                                         void * cb_arg,
+                                         void * param )
+{
+    ssize_t ret;
+
+    if( len != sizeof( onboarding_state ) )
+    {
+        return -EINVAL;
+    }
+
+    ret = read_cb( cb_arg, &onboarding_state, sizeof( onboarding_state ) );
+
+    return ( ret < 0 ) ? ( int ) ret : 0;
+}
+
+/* Load the persisted onboarding state, defaults to idle when nothing is stored */
+static int prv_onboarding_state_load( void )
+{
+    return settings_load_subtree_direct( ONBOARDING_SETTINGS_KEY, prv_onboarding_state_load_cb, NULL );
+}
+
+/* Persist the onboarding state */
+static void prv_onboarding_state_save( enum onboarding_state state )
+{
+    int err;
+
+    onboarding_state = state;
+    err = settings_save_one( ONBOARDING_SETTINGS_KEY, &onboarding_state, sizeof( onboarding_state ) );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to persist onboarding state %d, err %d", state, err );
+    }
+}
+
 /**
  * @brief Onboard the device by managing DTLS credentials.
  *
+ * Credentials are written while the modem is offline, then the modem is set back to normal
+ * mode and the function waits for connectivity, so no reboot is needed.
+ *
  * @param[in] overwrite Whether to overwrite existing credentials, should be set to true when DTLS connecting is failing.
  * @return 0 on success, negative error code on failure.
  */
@@ -269,9 +487,16 @@ static int prv_onboard_device( bool overwrite )
     /* Unless "overwrite" is true,  */
     int err;
     bool exists;
+    int64_t onboarding_start = k_uptime_get();
 
     err = modem_key_mgmt_exists( CONFIG_NCE_DTLS_SECURITY_TAG, MODEM_KEY_MGMT_CRED_TYPE_PSK, &exists );
 
+    if( ( prv_onboarding_state_load() == 0 ) && ( onboarding_state == ONBOARDING_STATE_IN_PROGRESS ) )
+    {
+        LOG_WRN( "Previous onboarding was interrupted, onboarding again" );
+        overwrite = true;
+    }
+
     if( overwrite || !exists )
     {
         struct OSNetwork OSNetwork = { .os_socket = 0 };
@@ -283,6 +508,9 @@ static int prv_onboard_device( bool overwrite )
             .nce_os_udp_recv       = nce_os_recv,
             .nce_os_udp_disconnect = nce_os_disconnect
         };
+
+        prv_onboarding_state_save( ONBOARDING_STATE_IN_PROGRESS );
+
         err = os_auth( &osNetwork, &nceKey );
 
         if( err )
@@ -301,17 +529,48 @@ static int prv_onboard_device( bool overwrite )
             return err;
         }
 
+        /* The L4 disconnect event may arrive late, do not rely on the stale flag */
+        k_mutex_lock( &network_connected_lock, K_FOREVER );
+        is_connected = false;
+        k_mutex_unlock( &network_connected_lock );
+
         err = store_credentials();
 
         if( err )
         {
             LOG_ERR( "Failed to store credentials, err %d\n", errno );
+        }
+
+        /* Go back online even if storing failed, the persisted state retries onboarding later */
+        for(int attempt = 1; ; attempt++)
+        {
+            int lte_err = lte_lc_normal();
+
+            if( lte_err == 0 )
+            {
+                break;
+            }
+
+            if( attempt == ONBOARDING_LTE_NORMAL_TRIES )
+            {
+                LOG_ERR( "Failed to reconnect to the LTE network, err %d\n", lte_err );
+                return lte_err;
+            }
+
+            LOG_WRN( "Failed to reconnect to the LTE network, err %d, retrying (%d/%d)",
+                     lte_err, attempt, ONBOARDING_LTE_NORMAL_TRIES );
+            k_sleep( K_SECONDS( attempt ) );
+        }
+
+        if( err )
+        {
             return err;
         }
 
-        LOG_INF( "Rebooting to ensure changes take effect after saving credentials.." );
+        wait_for_network();
+        prv_onboarding_state_save( ONBOARDING_STATE_DONE );
 
-        sys_arch_reboot( 0 );
+        LOG_INF( "Onboarding completed in %lld ms without reboot", k_uptime_get() - onboarding_start );
     }
     else
     {
@@ -373,6 +632,30 @@ static int dtls_setup( int fd )
         LOG_WRN( "[WRN] Failed to setup DTLS HandTimout, err %d\n", errno );
     }
 
+    #if defined( CONFIG_NCE_DTLS_CID )
+    /* Advertise Connection ID support, the server's CID keeps the session valid after NAT rebinding */
+    int cid = TLS_DTLS_CID_SUPPORTED;
+
+    err = zsock_setsockopt( fd, SOL_TLS, TLS_DTLS_CID, &cid, sizeof( cid ) );
+
+    if( err )
+    {
+        LOG_WRN( "[WRN] Failed to setup DTLS Connection ID, err %d\n", errno );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_CID ) */
+
+    #if defined( CONFIG_NCE_DTLS_SESSION_CACHE )
+    /* Allow the modem to resume a cached session instead of running a full handshake */
+    int session_cache = TLS_SESSION_CACHE_ENABLED;
+
+    err = zsock_setsockopt( fd, SOL_TLS, TLS_SESSION_CACHE, &session_cache, sizeof( session_cache ) );
+
+    if( err )
+    {
+        LOG_WRN( "[WRN] Failed to enable DTLS session cache, err %d\n", errno );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_SESSION_CACHE ) */
+
     /* Associate the socket with the security tag */
     err = zsock_setsockopt( fd, SOL_TLS, TLS_SEC_TAG_LIST, tls_sec_tag,
                             sizeof( tls_sec_tag ) );
@@ -385,6 +668,62 @@ static int dtls_setup( int fd )
 
     return 0;
 }
+
+/**
+ * @brief Record whether the handshake on a connected DTLS socket was full or resumed.
+ *
+ * Reported as unknown when the modem library cannot tell.
+ *
+ * @param[in] fd Connected DTLS socket.
+ */
+static void prv_dtls_session_report( int fd )
+{
+    const char * handshake = "unknown";
+
+    #if defined( TLS_DTLS_HANDSHAKE_STATUS )
+    int err;
+    int handshake_status;
+    socklen_t len = sizeof( handshake_status );
+
+    err = zsock_getsockopt( fd, SOL_TLS, TLS_DTLS_HANDSHAKE_STATUS, &handshake_status, &len );
+
+    if( err )
+    {
+        LOG_WRN( "[WRN] Failed to read DTLS handshake status, err %d\n", errno );
+    }
+    else if( handshake_status == TLS_DTLS_HANDSHAKE_STATUS_CACHED )
+    {
+        handshake = "resumed";
+        dtls_resumed_handshake_count++;
+    }
+    else
+    {
+        handshake = "full";
+        dtls_full_handshake_count++;
+    }
+    #endif /* if defined( TLS_DTLS_HANDSHAKE_STATUS ) */
+
+    #if defined( CONFIG_NCE_DTLS_CID )
+    int ret;
+    int cid_status;
+    socklen_t cid_len = sizeof( cid_status );
+
+    ret = zsock_getsockopt( fd, SOL_TLS, TLS_DTLS_CID_STATUS, &cid_status, &cid_len );
+
+    if( ret )
+    {
+        LOG_WRN( "[WRN] Failed to read DTLS Connection ID status, err %d\n", errno );
+    }
+    else
+    {
+        LOG_INF( "DTLS Connection ID %s", ( cid_status == TLS_DTLS_CID_STATUS_DISABLED ) ? "not negotiated" : "negotiated" );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_CID ) */
+
+    LOG_INF( "DTLS handshake: %s (full: %u, resumed: %u)", handshake,
+             dtls_full_handshake_count, dtls_resumed_handshake_count );
+}
+
 /* Handles DTLS failure by onboarding the device with overwriting enabled  */
 static int prv_handle_dtls_failure( void )
 {
@@ -402,14 +741,113 @@ static int prv_handle_dtls_failure( void )
 }
 #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
 
+/* Periodic sample, queued with a time-to-live so stale samples never reach the radio */
+static void prv_uplink_sample_work_fn( struct k_work * work )
+{
+    const void * payload;
+    size_t len;
+    uint16_t format = COAP_CONTENT_FORMAT_TEXT_PLAIN;
+    int ret;
+
+    k_work_reschedule( k_work_delayable_from_work( work ), K_SECONDS( CONFIG_COAP_SAMPLE_REQUEST_INTERVAL_SECONDS ) );
+
+    #if defined( CONFIG_NCE_ENERGY_SAVER )
+    int converted_bytes = 0;
+    char buffer[ CONFIG_NCE_PAYLOAD_DATA_SIZE ];
+
+    LOG_INF( "\nCoAP client POST (Binary Payload)\n" );
+
+    Element2byte_gen_t battery_level =
+    {
+        .type            = E_INTEGER,
+        .value.i         = 99,
+        .template_length = 1
+    };
+    Element2byte_gen_t signal_strength =
+    {
+        .type            = E_INTEGER,
+        .value.i         = 84,
+        .template_length = 1
+    };
+    Element2byte_gen_t software_version =
+    {
+        .type            = E_STRING,
+        .value.s         = "2.2.1",
+        .template_length = 5
+    };
+
+    converted_bytes = os_energy_save( buffer, 1, 3,
+                                      battery_level,
+                                      signal_strength,
+                                      software_version );
+
+    if( converted_bytes < 0 )
+    {
+        LOG_ERR( "Failed to save energy, %d", errno );
+        return;
+    }
+
+    payload = buffer;
+    len = converted_bytes;
+    LOG_HEXDUMP_INF( buffer, sizeof( buffer ), "Payload (binary):" );
+    #elif defined( CONFIG_NCE_SENML_CBOR )
+    static uint8_t senml_buf[ CONFIG_NCE_SENML_BUFFER_SIZE ];
+    struct senml_cbor_writer senml;
+    size_t senml_len;
+    int err;
+
+    senml_cbor_begin( &senml, senml_buf, sizeof( senml_buf ), CONFIG_NCE_SENML_BASE_NAME, 0 );
+    err = senml_cbor_put_int( &senml, "battery", "%EL", 99, 0 );
+    err = err ? err : senml_cbor_put_int( &senml, "signal", NULL, 84, 0 );
+    err = err ? err : senml_cbor_put_string( &senml, "version", "2.2.1", 0 );
+    #if defined( CONFIG_NCE_COAP_STATS_TELEMETRY )
+    if( uplink_stats != NULL )
+    {
+        err = err ? err : senml_cbor_put_int( &senml, "rtt_p50", "ms", coap_stats_rtt_percentile( uplink_stats, 50 ), 0 );
+        err = err ? err : senml_cbor_put_int( &senml, "rtt_p90", "ms", coap_stats_rtt_percentile( uplink_stats, 90 ), 0 );
+        err = err ? err : senml_cbor_put_int( &senml, "retransmissions", NULL, uplink_stats->retransmissions, 0 );
+        err = err ? err : senml_cbor_put_int( &senml, "timeouts", NULL, uplink_stats->timeouts, 0 );
+        err = err ? err : senml_cbor_put_int( &senml, "spurious", NULL, uplink_stats->spurious_retransmissions, 0 );
+        err = err ? err : senml_cbor_put_int( &senml, "rto", "ms", coap_stats_rto( uplink_stats ), 0 );
+    }
+    #endif /* if defined( CONFIG_NCE_COAP_STATS_TELEMETRY ) */
+    err = err ? err : senml_cbor_end( &senml, &senml_len );
+
+    if( err )
+    {
+        LOG_ERR( "Failed to encode SenML-CBOR payload, err %d", err );
+        return;
+    }
+
+    payload = senml_buf;
+    len = senml_len;
+    format = SENML_CBOR_CONTENT_FORMAT;
+    LOG_HEXDUMP_INF( senml_buf, senml_len, "Payload (SenML-CBOR):" );
+    LOG_INF( "SenML-CBOR payload: %zu bytes (SenML-JSON: %zu bytes, %d%% smaller)", senml_len, senml.json_len,
+             ( int ) ( 100 - ( senml_len * 100 ) / senml.json_len ) );
+    #else /* if defined( CONFIG_NCE_ENERGY_SAVER ) */
+    payload = CONFIG_PAYLOAD;
+    len = strlen( CONFIG_PAYLOAD );
+    LOG_INF( "Payload: %s", CONFIG_PAYLOAD );
+    #endif /* if defined( CONFIG_NCE_ENERGY_SAVER ) */
+
+    ret = uplink_queue_put( UPLINK_PRIORITY_NORMAL, CONFIG_NCE_UPLINK_SAMPLE_TTL_SECONDS, format, payload, len );
+
+    if( ret )
+    {
+        LOG_ERR( "Failed to queue uplink sample, err %d", ret );
+    }
+}
+
+static K_WORK_DELAYABLE_DEFINE( uplink_sample_work, prv_uplink_sample_work_fn );
+
 /** @brief Starts the uplink item. */
 void uplink_thread_fn( void * p1,
                        void * p2,
                        void * p3 )
 {
     int err;
-    int retry_count = 0;
-    const int MAX_RETRIES = CONFIG_NCE_UPLINK_MAX_RETRIES;
+    int backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
     struct addrinfo * resolved_info = NULL;
     struct coap_client_request req =
     {
@@ -420,23 +858,26 @@ void uplink_thread_fn( void * p1,
         .path        = CONFIG_URI_PATH,
     };
 
-    LOG_INF( "Uplink thread started..." );
+    /* The payload stays in the queue's pool until the message is released or put back */
+    static struct uplink_msg msg;
 
-connect_retry:
-    retry_count++;
+    #if defined( CONFIG_NCE_BLOCK1_UPLINK )
+    static struct coap_block1_transfer block1_xfer;
+    /* Enqueue time of the message block1_xfer belongs to, it survives a reconnect */
+    static int64_t block1_enqueued_at;
+    #endif /* if defined( CONFIG_NCE_BLOCK1_UPLINK ) */
 
-    if( retry_count > MAX_RETRIES )
-    {
-        LOG_ERR( "Max uplink retries reached. Stopping uplink thread." );
+    LOG_INF( "Uplink thread started..." );
 
-        if( uplink_fd > 0 )
-        {
-            zsock_close( uplink_fd );
-            uplink_fd = -1;
-        }
+    #if defined( CONFIG_NCE_COAP_STATS )
+    uplink_stats = coap_stats_get( CONFIG_COAP_SAMPLE_SERVER_HOSTNAME );
+    #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
 
-        return;
-    }
+    /* Samples are taken on schedule even while the uplink is down */
+    k_work_schedule( &uplink_sample_work, K_NO_WAIT );
+
+connect_retry:
+    wait_for_network();
 
     /* DNS Resolution */
     {
@@ -495,64 +936,131 @@ connect_retry:
     }
 
     LOG_INF( "Connected to Uplink CoAP server %s:%d", CONFIG_COAP_SAMPLE_SERVER_HOSTNAME, CONFIG_COAP_SAMPLE_SERVER_PORT );
+    #if defined( CONFIG_NCE_ENABLE_DTLS )
+    prv_dtls_session_report( uplink_fd );
+    #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
 
     while( 1 )
     {
-        #if defined( CONFIG_NCE_ENERGY_SAVER )
-        int converted_bytes = 0;
-        char buffer[ CONFIG_NCE_PAYLOAD_DATA_SIZE ];
+        /* Pause sending while the network is down */
+        wait_for_network();
 
-        LOG_INF( "\nCoAP client POST (Binary Payload)\n" );
+        /* Wait for the next sample or an alarm, whichever comes first */
+        uplink_queue_get( &msg, K_FOREVER );
 
-        Element2byte_gen_t battery_level =
+        if( !prv_network_is_connected() )
         {
-            .type            = E_INTEGER,
-            .value.i         = 99,
-            .template_length = 1
-        };
-        Element2byte_gen_t signal_strength =
+            /* Keep the message until connectivity returns or it expires */
+            uplink_queue_putback( &msg );
+            continue;
+        }
+
+        req.payload = msg.data;
+        req.len = msg.len;
+        req.fmt = ( enum coap_content_format ) msg.format;
+        LOG_INF( "Sending %s uplink of %zu bytes, queued %lld ms ago",
+                 ( msg.priority == UPLINK_PRIORITY_ALARM ) ? "alarm" : "periodic", msg.len,
+                 k_uptime_get() - msg.enqueued_at );
+        #if defined( CONFIG_NCE_BLOCK1_UPLINK )
+        if( req.len > CONFIG_NCE_BLOCK1_SIZE )
         {
-            .type            = E_INTEGER,
-            .value.i         = 84,
-            .template_length = 1
-        };
-        Element2byte_gen_t software_version =
+            /* Payload does not fit into one block, send it block-wise */
+            if( ( block1_xfer.payload == msg.data ) && ( block1_enqueued_at == msg.enqueued_at ) )
+            {
+                /* Same message put back after an interrupted transfer, keep what the server acknowledged */
+                block1_xfer.resumes = 0;
+                LOG_INF( "Resuming Block1 transfer at offset %zu/%zu", block1_xfer.acked, block1_xfer.len );
+            }
+            else
+            {
+                coap_block1_init( &block1_xfer, req.path, req.fmt, req.payload, req.len );
+                block1_enqueued_at = msg.enqueued_at;
+            }
+
+            #if defined( CONFIG_NCE_COAP_STATS )
+            block1_xfer.stats = uplink_stats;
+            #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+            err = coap_block1_send( &coap_client, uplink_fd, &block1_xfer );
+        }
+        else
+        #endif /* if defined( CONFIG_NCE_BLOCK1_UPLINK ) */
         {
-            .type            = E_STRING,
-            .value.s         = "2.2.1",
-            .template_length = 5
-        };
+            #if defined( CONFIG_NCE_COAP_BENCHMARK )
+            static bool benchmark_done;
 
-        converted_bytes = os_energy_save( buffer, 1, 3,
-                                          battery_level,
-                                          signal_strength,
-                                          software_version );
+            if( !benchmark_done )
+            {
+                /* Run once on the first connection, the regular uplink follows */
+                benchmark_done = true;
+                coap_benchmark_run( &coap_client, uplink_fd, &req, uplink_stats );
+            }
+            #endif /* if defined( CONFIG_NCE_COAP_BENCHMARK ) */
+
+            /* Send request */
+            k_sem_reset( &uplink_response );
+            uplink_response_code = -ETIMEDOUT;
+            #if defined( CONFIG_NCE_COAP_STATS )
+            uplink_params = coap_get_transmission_parameters();
+            coap_stats_rto_apply( uplink_stats, &uplink_params );
+            uplink_sent_at = k_uptime_get();
+            err = coap_client_req( &coap_client, uplink_fd, NULL, &req, &uplink_params );
+            #else
+            err = coap_client_req( &coap_client, uplink_fd, NULL, &req, NULL );
+            #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+            if( err == -EAGAIN )
+            {
+                /* All coap_client request slots are busy, keep the socket and try again shortly */
+                uplink_queue_putback( &msg );
+                k_sleep( K_MSEC( UPLINK_SLOT_WAIT_MS ) );
+                continue;
+            }
 
-        if( converted_bytes < 0 )
-        {
-            LOG_ERR( "Failed to save energy, %d", errno );
-            goto close_and_retry;
+            #if defined( CONFIG_NCE_COAP_STATS )
+            if( err == 0 )
+            {
+                coap_stats_tx( uplink_stats, req.len, false );
+            }
+            #endif /* if defined( CONFIG_NCE_COAP_STATS ) */
+
+            /* One request at a time, the next message waits for the response or the timeout of this one */
+            if( ( err == 0 ) &&
+                ( k_sem_take( &uplink_response, K_SECONDS( CONFIG_NCE_UPLINK_RESPONSE_TIMEOUT_SECONDS ) ) != 0 ) )
+            {
+                LOG_ERR( "No outcome of the uplink request from coap_client" );
+                coap_client_cancel_requests( &coap_client );
+                err = -ETIMEDOUT;
+            }
+            else if( err == 0 )
+            {
+                err = prv_uplink_response_err( uplink_response_code );
+            }
         }
 
-        req.payload = buffer;
-        req.len = converted_bytes;
-        LOG_HEXDUMP_INF( buffer, sizeof( buffer ), "Payload (binary):" );
-        #else /* if defined( CONFIG_NCE_ENERGY_SAVER ) */
-        req.payload = CONFIG_PAYLOAD;
-        req.len = strlen( CONFIG_PAYLOAD );
-        LOG_INF( "Payload: %s", CONFIG_PAYLOAD );
-        #endif /* if defined( CONFIG_NCE_ENERGY_SAVER ) */
-        /* Send request */
-        err = coap_client_req( &coap_client, uplink_fd, NULL, &req, NULL );
+        if( err == -EBADMSG )
+        {
+            /* The server refused the message itself, sending it again would be refused again */
+            LOG_ERR( "Uplink rejected by the server, message dropped" );
+            uplink_queue_release( &msg );
+            continue;
+        }
 
         if( err )
         {
+            /* Timeouts and 5.xx keep the message for the next connection */
             LOG_ERR( "Failed to send request : %d", err );
+            uplink_queue_putback( &msg );
             goto close_and_retry;
         }
 
-        LOG_INF( "CoAP POST request sent to %s, resource: %s",
+        LOG_INF( "CoAP POST request to %s acknowledged, resource: %s",
                  CONFIG_COAP_SAMPLE_SERVER_HOSTNAME, req.path );
+        uplink_queue_release( &msg );
+        backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
+        prv_uplink_recovery_report();
+        #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+        nat_keepalive_uplink_sent();
+        #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
 
         #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
         if( ledBlue.port )
@@ -565,7 +1073,6 @@ connect_retry:
             gpio_pin_set_dt( &ledGreen, 100 ); /* turn on green LED even if not acknowledged (NON CON) */
         }
         #endif
-        k_sleep( K_SECONDS( CONFIG_COAP_SAMPLE_REQUEST_INTERVAL_SECONDS ) );
     }
 
 close_and_retry:
@@ -593,13 +1100,116 @@ close_and_retry:
 
 wait_and_retry:
 
-    LOG_WRN( "Retrying uplink (%d/%d)...", retry_count, MAX_RETRIES );
-    k_sleep( K_SECONDS( 5 ) );
+    if( !prv_network_is_connected() )
+    {
+        /* Resume as soon as connectivity returns, no backoff needed */
+        LOG_WRN( "Network down, uplink paused" );
+        backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
+        goto connect_retry;
+    }
+
+    LOG_WRN( "Retrying uplink in %d s", backoff_s );
+    k_sleep( K_MSEC( backoff_s * MSEC_PER_SEC + sys_rand32_get() % MSEC_PER_SEC ) );
+    backoff_s = MIN( backoff_s * 2, CONFIG_NCE_UPLINK_BACKOFF_MAX_SECONDS );
     goto connect_retry;
 }
 
 
 #if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER )
+#if defined( CONFIG_NCE_DOWNLINK_DEDUP )
+static bool prv_dedup_sender_equal( const struct sockaddr_in * a,
+                                    const struct sockaddr * b )
+{
+    const struct sockaddr_in * b_in = ( const struct sockaddr_in * ) b;
+
+    return ( b->sa_family == AF_INET ) &&
+           ( a->sin_port == b_in->sin_port ) &&
+           ( a->sin_addr.s_addr == b_in->sin_addr.s_addr );
+}
+
+/*
+ * Look up a received datagram by sender, message ID and token, reading them straight
+ * from the CoAP header so duplicates are never parsed. A duplicate is answered with
+ * the stored ACK. Returns true if the datagram was a duplicate.
+ */
+static bool prv_dedup_replay( int sock,
+                              const uint8_t * data,
+                              size_t len,
+                              const struct sockaddr * addr,
+                              socklen_t addr_len )
+{
+    uint8_t token_len;
+    uint16_t id;
+    int64_t now = k_uptime_get();
+
+    if( len < COAP_HEADER_LEN )
+    {
+        return false;
+    }
+
+    token_len = data[ 0 ] & 0x0f;
+    id = sys_get_be16( &data[ 2 ] );
+
+    if( ( token_len > COAP_TOKEN_MAX_LEN ) || ( len < COAP_HEADER_LEN + token_len ) )
+    {
+        return false;
+    }
+
+    for(int i = 0; i < ARRAY_SIZE( downlink_dedup_cache ); i++)
+    {
+        struct downlink_dedup_entry * entry = &downlink_dedup_cache[ i ];
+
+        if( ( entry->expires_at <= now ) || ( entry->id != id ) ||
+            ( entry->token_len != token_len ) ||
+            ( memcmp( entry->token, &data[ COAP_HEADER_LEN ], token_len ) != 0 ) ||
+            !prv_dedup_sender_equal( &entry->sender, addr ) )
+        {
+            continue;
+        }
+
+        downlink_duplicate_count++;
+        LOG_INF( "Duplicate downlink (msg ID: %u), replaying ACK (%u duplicates so far)", id, downlink_duplicate_count );
+
+        if( zsock_sendto( sock, entry->ack, entry->ack_len, 0, addr, addr_len ) < 0 )
+        {
+            LOG_ERR( "Failed to replay CoAP ACK (msg ID: %u, errno: %d)", id, errno );
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/* Remember a handled downlink message, replacing an expired or the oldest entry */
+static void prv_dedup_remember( struct coap_packet * packet,
+                                const struct sockaddr * addr,
+                                const struct coap_packet * ack )
+{
+    struct downlink_dedup_entry * entry = &downlink_dedup_cache[ 0 ];
+
+    if( ( addr->sa_family != AF_INET ) || ( ack->offset > COAP_ACK_MAX_LEN ) )
+    {
+        return;
+    }
+
+    for(int i = 1; i < ARRAY_SIZE( downlink_dedup_cache ); i++)
+    {
+        if( downlink_dedup_cache[ i ].expires_at < entry->expires_at )
+        {
+            entry = &downlink_dedup_cache[ i ];
+        }
+    }
+
+    memcpy( &entry->sender, addr, sizeof( entry->sender ) );
+    entry->id = coap_header_get_id( packet );
+    entry->token_len = coap_header_get_token( packet, entry->token );
+    entry->expires_at = k_uptime_get() + ( int64_t ) CONFIG_NCE_DOWNLINK_DEDUP_LIFETIME_SECONDS * MSEC_PER_SEC;
+    entry->ack_len = ack->offset;
+    memcpy( entry->ack, ack->data, ack->offset );
+}
+#endif /* if defined( CONFIG_NCE_DOWNLINK_DEDUP ) */
+
 /** @brief Initialize and send a CoAP acknowledgment. */
 static int send_coap_ack( int sock,
                           struct coap_packet * packet,
@@ -608,34 +1218,30 @@ static int send_coap_ack( int sock,
 {
     int err;
     struct coap_packet ack;
-    uint8_t * data;
-
-    data = ( uint8_t * ) k_malloc( MAX_COAP_MSG_LEN );
-
-    if( !data )
-    {
-        return -ENOMEM;
-    }
+    uint8_t data[ COAP_ACK_MAX_LEN ];
 
-    err = coap_ack_init( &ack, packet, data, MAX_COAP_MSG_LEN, COAP_RESPONSE_CODE_CHANGED );
+    err = coap_ack_init( &ack, packet, data, sizeof( data ), COAP_RESPONSE_CODE_CHANGED );
 
     if( err < 0 )
     {
         LOG_ERR( "Failed to init CoAP ACK \n" );
-        goto end;
+        return err;
     }
 
-    LOG_HEXDUMP_INF( ack.data, ack.offset, "sent ack:" );
     err = zsock_sendto( sock, ack.data, ack.offset, 0, addr, addr_len );
 
     if( err < 0 )
     {
         LOG_ERR( "Failed to init CoAP ACK (msg ID: %u, errno: %d)", coap_header_get_id( packet ), errno );
-        goto end;
+        return err;
     }
 
-end:
-    k_free( data );
+    LOG_HEXDUMP_DBG( ack.data, ack.offset, "sent ack:" );
+
+    #if defined( CONFIG_NCE_DOWNLINK_DEDUP )
+    prv_dedup_remember( packet, addr, &ack );
+    #endif /* if defined( CONFIG_NCE_DOWNLINK_DEDUP ) */
+
     return err;
 }
 /** @brief Print CoAP message details. */
@@ -797,8 +1403,7 @@ void downlink_thread_fn( void * p1,
     const int MAX_RETRIES = CONFIG_NCE_DOWNLINK_MAX_RETRIES;
     int retry_count = 0;
     struct coap_packet response;
-    char buffer[ CONFIG_NCE_RECEIVE_BUFFER_SIZE ];
-    /* struct coap_packet response; */
+    static struct downlink_msg msg;
     struct sockaddr_in my_addr =
     {
         .sin_family      = AF_INET,
@@ -845,10 +1450,20 @@ retry_downlink:
 
     retry_count = 0;
 
+    #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+    err = nat_keepalive_start( downlink_fd );
+
+    if( err )
+    {
+        LOG_WRN( "NAT keepalive not started, err %d", err );
+    }
+    #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
+
     while( 1 )
     {
-        ssize_t received_bytes = zsock_recvfrom( downlink_fd, buffer, sizeof( buffer ) - 1, 0,
+        ssize_t received_bytes = zsock_recvfrom( downlink_fd, msg.data, sizeof( msg.data ) - 1, 0,
                                                  ( struct sockaddr * ) &sender_addr, &sender_addr_len );
+        uint32_t received_cycles = k_cycle_get_32();
 
         if( received_bytes < 0 )
         {
@@ -861,18 +1476,30 @@ retry_downlink:
             else
             {
                 LOG_ERR( "recvfrom() failed, errno: %d", errno );
+                #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+                nat_keepalive_stop();
+                #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
                 zsock_close( downlink_fd );
                 downlink_fd = -1;
                 goto wait_and_retry;
             }
         }
 
-        buffer[ received_bytes ] = '\0';
-        LOG_INF( "Received %d bytes from server", received_bytes );
-        LOG_HEXDUMP_INF( buffer, received_bytes, "Received raw data:" );
+        #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+        if( nat_keepalive_rx( &sender_addr, msg.data, received_bytes ) )
+        {
+            continue;
+        }
+        #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
 
-        /* Parse CoAP message */
-        err = coap_packet_parse( &response, buffer, received_bytes, NULL, 0 );
+        #if defined( CONFIG_NCE_DOWNLINK_DEDUP )
+        if( prv_dedup_replay( downlink_fd, msg.data, received_bytes, &sender_addr, sender_addr_len ) )
+        {
+            continue;
+        }
+        #endif /* if defined( CONFIG_NCE_DOWNLINK_DEDUP ) */
+
+        err = coap_packet_parse( &response, msg.data, received_bytes, NULL, 0 );
 
         if( err < 0 )
         {
@@ -880,18 +1507,29 @@ retry_downlink:
             continue;
         }
 
-        print_coap_message( &response );
-
-        /* Reply with CoAP ACK */
+        /* Reply with CoAP ACK before any processing, so its latency does not depend on the handler */
         err = send_coap_ack( downlink_fd, &response, &sender_addr, sender_addr_len );
 
         if( err < 0 )
         {
             LOG_ERR( "send_coap_ack() failed: %d\n", err );
         }
-        else
+
+        if( received_bytes == sizeof( msg.data ) - 1 )
+        {
+            downlink_overflow_count++;
+            LOG_WRN( "Downlink message fills the receive buffer, it may be truncated (%u so far)",
+                     downlink_overflow_count );
+        }
+
+        msg.len = received_bytes;
+        msg.received_at = k_uptime_get();
+        msg.ack_latency_us = k_cyc_to_us_floor32( k_cycle_get_32() - received_cycles );
+
+        if( k_msgq_put( &downlink_queue, &msg, K_NO_WAIT ) != 0 )
         {
-            LOG_INF( "CoAP ACK sent successfully" );
+            downlink_dropped_count++;
+            LOG_WRN( "Downlink queue full, message dropped (%u so far)", downlink_dropped_count );
         }
     }
 
@@ -917,6 +1555,31 @@ wait_and_retry:
         return;
     }
 }
+
+/** @brief Downlink worker: Handles the acknowledged CoAP messages */
+void downlink_worker_fn( void * p1,
+                         void * p2,
+                         void * p3 )
+{
+    static struct downlink_msg msg;
+    struct coap_packet packet;
+
+    while( 1 )
+    {
+        k_msgq_get( &downlink_queue, &msg, K_FOREVER );
+
+        LOG_INF( "Received %d bytes from server (ACK after %u us, queued %lld ms)",
+                 msg.len, msg.ack_latency_us, k_uptime_get() - msg.received_at );
+        LOG_HEXDUMP_INF( msg.data, msg.len, "Received raw data:" );
+
+        if( coap_packet_parse( &packet, msg.data, msg.len, NULL, 0 ) < 0 )
+        {
+            continue;
+        }
+
+        print_coap_message( &packet );
+    }
+}
 #endif /* if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER ) */
 
 static void l4_event_handler( struct net_mgmt_event_callback * cb,
@@ -929,7 +1592,14 @@ static void l4_event_handler( struct net_mgmt_event_callback * cb,
             LOG_INF( "Network connectivity established" );
             k_mutex_lock( &network_connected_lock, K_FOREVER );
             is_connected = true;
-            k_condvar_signal( &network_connected );
+
+            if( network_lost )
+            {
+                network_lost = false;
+                network_restored_at = k_uptime_get();
+            }
+
+            k_condvar_broadcast( &network_connected );
             k_mutex_unlock( &network_connected_lock );
             break;
 
@@ -937,6 +1607,7 @@ static void l4_event_handler( struct net_mgmt_event_callback * cb,
             LOG_INF( "Network connectivity lost" );
             k_mutex_lock( &network_connected_lock, K_FOREVER );
             is_connected = false;
+            network_lost = true;
             k_mutex_unlock( &network_connected_lock );
             break;
 
@@ -990,6 +1661,14 @@ int main( void )
         return err;
     }
 
+    /* Let the connection manager re-establish connectivity after coverage loss */
+    err = conn_mgr_if_set_flag( net_if_get_default(), CONN_MGR_IF_PERSISTENT, true );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to make the network interface persistent, error: %d", err );
+    }
+
     err = conn_mgr_all_if_connect( true );
 
     if( err )
@@ -1013,6 +1692,14 @@ int main( void )
     wait_for_network();
 
     #if defined( CONFIG_NCE_ENABLE_DTLS )
+    /* Once per boot, the onboarding state is loaded and saved from here on */
+    err = settings_subsys_init();
+
+    if( err )
+    {
+        LOG_ERR( "Failed to initialize settings, err %d", err );
+    }
+
     /* Check for existing PSK on device */
     err = prv_onboard_device( false );
 
@@ -1047,6 +1734,12 @@ int main( void )
                                             NULL, NULL, NULL,
                                             THREAD_PRIORITY, 0, K_NO_WAIT );
     k_thread_name_set( downlink_tid, "downlink_thread" );
+    k_tid_t worker_tid = k_thread_create( &downlink_worker, downlink_worker_stack,
+                                          K_THREAD_STACK_SIZEOF( downlink_worker_stack ),
+                                          downlink_worker_fn,
+                                          NULL, NULL, NULL,
+                                          DOWNLINK_WORKER_PRIORITY, 0, K_NO_WAIT );
+    k_thread_name_set( worker_tid, "downlink_worker" );
     #endif
 
     /* Delay or wait for the threads to complete */
@@ -0,0 +1,385 @@
+/******************************************************************************
+ * @file    senml_cbor.c
+ * @brief   Streaming SenML-CBOR (RFC 8428) encoder
+ * @details Writes SenML records as CBOR maps with integer labels directly into
+ *          the request buffer. The array header is reserved up front and
+ *          shrunk to its shortest form once the record count is known. While
+ *          encoding, the size of the equivalent SenML-JSON pack is tracked so
+ *          the saving can be reported.
+ *
+ * @copyright
+ *     Copyright (c) 2025 1NCE GmbH
+ ******************************************************************************/
+
+// SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+/******************************************************************************
+* Includes
+******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include "senml_cbor.h"
+
+/* CBOR major types */
+#define CBOR_UINT            0
+#define CBOR_NINT            1
+#define CBOR_TEXT            3
+#define CBOR_ARRAY           4
+#define CBOR_MAP             5
+#define CBOR_FALSE           0xf4
+#define CBOR_TRUE            0xf5
+
+/* SenML CBOR labels (RFC 8428, Table 6) */
+#define SENML_BASE_NAME      -2
+#define SENML_BASE_TIME      -3
+#define SENML_NAME           0
+#define SENML_UNIT           1
+#define SENML_VALUE          2
+#define SENML_STRING_VALUE   3
+#define SENML_BOOL_VALUE     4
+#define SENML_TIME           6
+
+/* Space reserved for the array header, enough for 65535 records */
+#define ARRAY_HEADER_SIZE    3
+
+enum senml_value_type
+{
+    SENML_TYPE_INT,
+    SENML_TYPE_BOOL,
+    SENML_TYPE_STRING,
+};
+
+struct senml_record
+{
+    const char * name;
+    const char * unit;
+    enum senml_value_type type;
+    union
+    {
+        int32_t i;
+        bool b;
+        const char * s;
+    } value;
+    int32_t time;
+};
+
+static int prv_put_byte( struct senml_cbor_writer * writer,
+                         uint8_t byte )
+{
+    if( writer->offset >= writer->size )
+    {
+        return -ENOMEM;
+    }
+
+    writer->buf[ writer->offset++ ] = byte;
+    return 0;
+}
+
+/* Encode a CBOR initial byte and argument in its shortest form */
+static int prv_put_head( struct senml_cbor_writer * writer,
+                         uint8_t major,
+                         uint32_t val )
+{
+    int bytes;
+    int err;
+
+    if( val < 24 )
+    {
+        return prv_put_byte( writer, ( major << 5 ) | val );
+    }
+    else if( val <= UINT8_MAX )
+    {
+        bytes = 1;
+        err = prv_put_byte( writer, ( major << 5 ) | 24 );
+    }
+    else if( val <= UINT16_MAX )
+    {
+        bytes = 2;
+        err = prv_put_byte( writer, ( major << 5 ) | 25 );
+    }
+    else
+    {
+        bytes = 4;
+        err = prv_put_byte( writer, ( major << 5 ) | 26 );
+    }
+
+    while( ( err == 0 ) && ( bytes-- > 0 ) )
+    {
+        err = prv_put_byte( writer, ( uint8_t ) ( val >> ( bytes * 8 ) ) );
+    }
+
+    return err;
+}
+
+static int prv_put_int( struct senml_cbor_writer * writer,
+                        int32_t val )
+{
+    if( val >= 0 )
+    {
+        return prv_put_head( writer, CBOR_UINT, ( uint32_t ) val );
+    }
+
+    return prv_put_head( writer, CBOR_NINT, ( uint32_t ) ( -1 - val ) );
+}
+
+static int prv_put_text( struct senml_cbor_writer * writer,
+                         const char * str )
+{
+    size_t len = strlen( str );
+    int err = prv_put_head( writer, CBOR_TEXT, len );
+
+    if( err )
+    {
+        return err;
+    }
+
+    if( writer->offset + len > writer->size )
+    {
+        return -ENOMEM;
+    }
+
+    memcpy( &writer->buf[ writer->offset ], str, len );
+    writer->offset += len;
+    return 0;
+}
+
+/* Size of the same record in SenML-JSON, including the separating comma */
+static size_t prv_json_record_len( const struct senml_cbor_writer * writer,
+                                   const struct senml_record * record,
+                                   int32_t time )
+{
+    size_t len = ( writer->records > 0 ) ? 1 : 0;
+
+    len += 2; /* {} */
+
+    if( writer->records == 0 )
+    {
+        if( writer->base_name != NULL )
+        {
+            len += snprintf( NULL, 0, "\"bn\":\"%s\",", writer->base_name );
+        }
+
+        if( writer->base_time != 0 )
+        {
+            len += snprintf( NULL, 0, "\"bt\":%d,", ( int ) writer->base_time );
+        }
+    }
+
+    len += snprintf( NULL, 0, "\"n\":\"%s\"", record->name );
+
+    if( record->unit != NULL )
+    {
+        len += snprintf( NULL, 0, ",\"u\":\"%s\"", record->unit );
+    }
+
+    switch( record->type )
+    {
+        case SENML_TYPE_INT:
+            len += snprintf( NULL, 0, ",\"v\":%d", ( int ) record->value.i );
+            break;
+
+        case SENML_TYPE_BOOL:
+            len += record->value.b ? sizeof( ",\"vb\":true" ) - 1 : sizeof( ",\"vb\":false" ) - 1;
+            break;
+
+        case SENML_TYPE_STRING:
+            len += snprintf( NULL, 0, ",\"vs\":\"%s\"", record->value.s );
+            break;
+    }
+
+    if( time != 0 )
+    {
+        len += snprintf( NULL, 0, ",\"t\":%d", ( int ) time );
+    }
+
+    return len;
+}
+
+static int prv_put_record( struct senml_cbor_writer * writer,
+                           const struct senml_record * record )
+{
+    int err;
+    size_t start = writer->offset;
+    bool first = ( writer->records == 0 );
+    bool base_name = first && ( writer->base_name != NULL );
+    bool base_time = first && ( writer->base_time != 0 );
+    int32_t time = record->time - writer->base_time;
+    uint32_t pairs = 2 + base_name + base_time + ( record->unit != NULL ) + ( time != 0 );
+
+    if( writer->records == UINT16_MAX )
+    {
+        return -ENOMEM;
+    }
+
+    err = prv_put_head( writer, CBOR_MAP, pairs );
+
+    if( ( err == 0 ) && base_name )
+    {
+        err = prv_put_int( writer, SENML_BASE_NAME );
+        err = err ? err : prv_put_text( writer, writer->base_name );
+    }
+
+    if( ( err == 0 ) && base_time )
+    {
+        err = prv_put_int( writer, SENML_BASE_TIME );
+        err = err ? err : prv_put_int( writer, writer->base_time );
+    }
+
+    if( err == 0 )
+    {
+        err = prv_put_int( writer, SENML_NAME );
+        err = err ? err : prv_put_text( writer, record->name );
+    }
+
+    if( ( err == 0 ) && ( record->unit != NULL ) )
+    {
+        err = prv_put_int( writer, SENML_UNIT );
+        err = err ? err : prv_put_text( writer, record->unit );
+    }
+
+    if( err == 0 )
+    {
+        switch( record->type )
+        {
+            case SENML_TYPE_INT:
+                err = prv_put_int( writer, SENML_VALUE );
+                err = err ? err : prv_put_int( writer, record->value.i );
+                break;
+
+            case SENML_TYPE_BOOL:
+                err = prv_put_int( writer, SENML_BOOL_VALUE );
+                err = err ? err : prv_put_byte( writer, record->value.b ? CBOR_TRUE : CBOR_FALSE );
+                break;
+
+            case SENML_TYPE_STRING:
+                err = prv_put_int( writer, SENML_STRING_VALUE );
+                err = err ? err : prv_put_text( writer, record->value.s );
+                break;
+        }
+    }
+
+    if( ( err == 0 ) && ( time != 0 ) )
+    {
+        err = prv_put_int( writer, SENML_TIME );
+        err = err ? err : prv_put_int( writer, time );
+    }
+
+    if( err )
+    {
+        /* Drop the partial record, the pack stays valid */
+        writer->offset = start;
+        return err;
+    }
+
+    writer->json_len += prv_json_record_len( writer, record, time );
+    writer->records++;
+
+    return 0;
+}
+
+int senml_cbor_begin( struct senml_cbor_writer * writer,
+                      uint8_t * buf,
+                      size_t size,
+                      const char * base_name,
+                      int32_t base_time )
+{
+    if( size < ARRAY_HEADER_SIZE )
+    {
+        return -ENOMEM;
+    }
+
+    memset( writer, 0, sizeof( *writer ) );
+    writer->buf = buf;
+    writer->size = size;
+    writer->offset = ARRAY_HEADER_SIZE;
+    writer->base_name = base_name;
+    writer->base_time = base_time;
+    writer->json_len = 2; /* [] */
+
+    return 0;
+}
+
+int senml_cbor_put_int( struct senml_cbor_writer * writer,
+                        const char * name,
+                        const char * unit,
+                        int32_t value,
+                        int32_t time )
+{
+    struct senml_record record =
+    {
+        .name    = name,
+        .unit    = unit,
+        .type    = SENML_TYPE_INT,
+        .value.i = value,
+        .time    = time,
+    };
+
+    return prv_put_record( writer, &record );
+}
+
+int senml_cbor_put_bool( struct senml_cbor_writer * writer,
+                         const char * name,
+                         bool value,
+                         int32_t time )
+{
+    struct senml_record record =
+    {
+        .name    = name,
+        .type    = SENML_TYPE_BOOL,
+        .value.b = value,
+        .time    = time,
+    };
+
+    return prv_put_record( writer, &record );
+}
+
+int senml_cbor_put_string( struct senml_cbor_writer * writer,
+                           const char * name,
+                           const char * value,
+                           int32_t time )
+{
+    struct senml_record record =
+    {
+        .name    = name,
+        .type    = SENML_TYPE_STRING,
+        .value.s = value,
+        .time    = time,
+    };
+
+    return prv_put_record( writer, &record );
+}
+
+int senml_cbor_end( struct senml_cbor_writer * writer,
+                    size_t * len )
+{
+    size_t header_len;
+    size_t body_len = writer->offset - ARRAY_HEADER_SIZE;
+    uint16_t count = writer->records;
+
+    /* Write the array header in its shortest form and move the records behind it */
+    if( count < 24 )
+    {
+        header_len = 1;
+        writer->buf[ 0 ] = ( CBOR_ARRAY << 5 ) | count;
+    }
+    else if( count <= UINT8_MAX )
+    {
+        header_len = 2;
+        writer->buf[ 0 ] = ( CBOR_ARRAY << 5 ) | 24;
+        writer->buf[ 1 ] = count;
+    }
+    else
+    {
+        header_len = 3;
+        writer->buf[ 0 ] = ( CBOR_ARRAY << 5 ) | 25;
+        writer->buf[ 1 ] = count >> 8;
+        writer->buf[ 2 ] = count & 0xff;
+    }
+
+    memmove( &writer->buf[ header_len ], &writer->buf[ ARRAY_HEADER_SIZE ], body_len );
+    writer->offset = header_len + body_len;
+    *len = writer->offset;
+
+    return 0;
+}
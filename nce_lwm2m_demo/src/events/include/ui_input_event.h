@@ -28,6 +28,7 @@ struct ui_input_event
     enum ui_input_type type;
     uint8_t device_number;
     bool state;
+    int64_t timestamp; /* Uptime of the edge [ms], taken in the GPIO interrupt */
 };
 
 APP_EVENT_TYPE_DECLARE( ui_input_event );
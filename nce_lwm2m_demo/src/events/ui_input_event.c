@@ -25,8 +25,9 @@ static void log_ui_input_event( const struct app_event_header * aeh )
 {
     struct ui_input_event * event = cast_ui_input_event( aeh );
 
-    APP_EVENT_MANAGER_LOG( aeh, "%s event: device number = %d, state = %d",
-                           ui_input_type_to_string( event->type ), event->device_number, event->type );
+    APP_EVENT_MANAGER_LOG( aeh, "%s event: device number = %d, state = %d, %lld ms after the edge",
+                           ui_input_type_to_string( event->type ), event->device_number, event->state,
+                           k_uptime_get() - event->timestamp );
 }
 
 APP_EVENT_TYPE_DEFINE( ui_input_event,
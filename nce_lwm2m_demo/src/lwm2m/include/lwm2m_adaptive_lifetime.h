@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_ADAPTIVE_LIFETIME_H__
+#define LWM2M_ADAPTIVE_LIFETIME_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME )
+
+/**
+ * @brief Start the adaptive lifetime policy.
+ *
+ * The lifetime starts at CONFIG_LWM2M_ENGINE_DEFAULT_LIFETIME within the
+ * configured bounds. It doubles after every
+ * CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME_QUIET_CYCLES registration cycles
+ * without a server operation and drops to the minimum on the next one.
+ * With PSM requested, the PSM active time, in which the server can reach
+ * the device after an update, is halved and reset along with it.
+ *
+ * @param update_lifetime Called from the system workqueue to write
+ *                        lwm2m_adaptive_lifetime_get() to the server object.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_adaptive_lifetime_init( void ( * update_lifetime )( void ) );
+
+/**
+ * @brief Current lifetime of the policy in seconds.
+ */
+uint32_t lwm2m_adaptive_lifetime_get( void );
+
+/**
+ * @brief Account a registration client event.
+ *
+ * Closes a registration cycle on every completed registration and update,
+ * and logs the updates per day and the mean sleep time. Safe to call from
+ * the LwM2M engine callback.
+ *
+ * @param event Registration client event.
+ */
+void lwm2m_adaptive_lifetime_event( enum lwm2m_rd_client_event event );
+
+/**
+ * @brief Record a server operation on the device.
+ *
+ * The engine has no hook for every request it receives, so this is called
+ * from the callbacks of the operations a server performs: observations
+ * added or cancelled, writes to light control, buzzer, the Firmware Update
+ * Package URI and the Server Mute Send resource, and the Firmware Update
+ * Update, Device Reboot and Factory Reset executes. Reads are not counted,
+ * because read callbacks also run for the device's own reads. Shortens the
+ * lifetime right away if it is above the minimum. Safe to call from the
+ * LwM2M engine callbacks.
+ */
+void lwm2m_adaptive_lifetime_downlink( void );
+
+#else /* if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME ) */
+
+static inline void lwm2m_adaptive_lifetime_downlink( void )
+{
+}
+
+#endif /* if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME ) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_ADAPTIVE_LIFETIME_H__ */
@@ -16,17 +16,36 @@
     #define LWM2M_OBJECT_SERVER_ID      1
 
     #define LWM2M_OBJECT_DEVICE_ID      3
+    #define LWM2M_OBJECT_CONNECTIVITY_MONITORING_ID    4
+    #define LWM2M_OBJECT_FIRMWARE_ID    5
+    #define LWM2M_OBJECT_LOCATION_ID    6
 
 /* IPSO Object IDs */
     #define IPSO_OBJECT_COLOUR_ID       3335
 
+/* Security RIDs */
+    #define SECURITY_SERVER_URI_RID     0
+    #define SECURITY_BOOTSTRAP_FLAG_RID    1
+    #define SECURITY_MODE_RID           2
+    #define SECURITY_CLIENT_IDENTITY_RID    3
+    #define SECURITY_SERVER_PUBLIC_KEY_RID    4
+    #define SECURITY_SECRET_KEY_RID     5
+    #define SECURITY_SHORT_SERVER_ID_RID    10
+
 /* Server RIDs */
+    #define SHORT_SERVER_ID_RID         0
     #define LIFETIME_RID                1
+    #define DEFAULT_MIN_PERIOD_RID      2
+    #define DEFAULT_MAX_PERIOD_RID      3
+    #define DISABLE_TIMEOUT_RID         5
+    #define NOTIFICATION_STORING_RID    6
+    #define BINDING_RID                 7
 
 /* Device RIDs */
     #define MANUFACTURER_RID            0
     #define MODEL_NUMBER_RID            1
     #define SERIAL_NUMBER_RID           2
+    #define REBOOT_RID                  4
     #define FACTORY_RESET_RID           5
     #define POWER_SOURCE_RID            6
     #define POWER_SOURCE_VOLTAGE_RID    7
@@ -41,6 +60,17 @@
     #define BATTERY_STATUS_RID          20
     #define MEMORY_TOTAL_RID            21
 
+/* Firmware update RIDs */
+    #define FIRMWARE_PACKAGE_URI_RID    1
+    #define FIRMWARE_UPDATE_RID         2
+    #define FIRMWARE_STATE_RID          3
+    #define FIRMWARE_UPDATE_RESULT_RID  5
+    #define FIRMWARE_DELIVERY_METHOD_RID    9
+
+/* Connectivity monitoring RIDs */
+    #define RADIO_SIGNAL_STRENGTH_RID   2
+    #define CELL_ID_RID                 8
+
 /* Location RIDs */
     #define LATITUDE_RID                0
     #define LONGITUDE_RID               1
@@ -59,13 +89,34 @@
 extern "C" {
     #endif
 
+/* Duration statistics of an LwM2M engine callback */
+struct lwm2m_cb_timing
+{
+    const char * name;
+    uint32_t calls;
+    uint32_t max_us;    /* Longest run so far */
+    int max_event;      /* Event or resource of the longest run */
+};
+
+    #define LWM2M_CB_TIMING_INIT( _name )    { .name = ( _name ) }
+
 /* Set timestamp resource */
 void set_ipso_obj_timestamp( int ipso_obj_id,
                              unsigned int obj_inst_id );
 
+/* Set timestamp resource to the time of an earlier uptime, as returned by k_uptime_get() */
+void set_ipso_obj_timestamp_at( int ipso_obj_id,
+                                unsigned int obj_inst_id,
+                                int64_t uptime_ms );
+
 /* Check whether notification read callback or regular read callback */
 bool is_regular_read_cb( int64_t read_timestamp );
 
+/* Record one callback run that started at start_cycles, as returned by k_cycle_get_32() */
+void lwm2m_cb_timing_record( struct lwm2m_cb_timing * timing,
+                             int event,
+                             uint32_t start_cycles );
+
     #ifdef __cplusplus
 }
     #endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_BENCHMARK_H__
+#define LWM2M_BENCHMARK_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mark the start of the registration client.
+ *
+ * Starts the registration latency measurement, call right before
+ * lwm2m_rd_client_start().
+ */
+void lwm2m_benchmark_client_start( void );
+
+/**
+ * @brief Account a registration client event.
+ *
+ * On a completed registration the latency since
+ * lwm2m_benchmark_client_start() is recorded, on every completed
+ * registration update the network bytes of the cycle since the previous
+ * one. The report with the peak heap and stack use is logged from the
+ * system workqueue. Safe to call from the LwM2M engine callback.
+ *
+ * @param event Registration client event.
+ */
+void lwm2m_benchmark_event( enum lwm2m_rd_client_event event );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_BENCHMARK_H__ */
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_DTLS_STATS_H__
+#define LWM2M_DTLS_STATS_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Count and time the DTLS handshakes of the LwM2M client.
+ *
+ * Hooks the socket option callback of the client context, which the engine
+ * calls for every new socket right before the DTLS handshake, and the
+ * socket state callback, which it calls before every send and so first
+ * once the handshake has completed. The handshake status of the socket
+ * tells full and resumed handshakes apart. Must be called after
+ * lwm2m_init_security().
+ *
+ * @param ctx LwM2M client context.
+ */
+void lwm2m_dtls_stats_init( struct lwm2m_ctx * ctx );
+
+/**
+ * @brief Feed a registration client event, counts updates without handshake.
+ *
+ * Does not block, may be called from the LwM2M engine callback.
+ *
+ * @param client_event Event reported by the registration client.
+ */
+void lwm2m_dtls_stats_event( enum lwm2m_rd_client_event client_event );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_DTLS_STATS_H__ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_FOTA_H__
+#define LWM2M_FOTA_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Serve the Firmware Update object (5) in pull mode.
+ *
+ * A Package URI written by the server (/5/0/1) is downloaded with the
+ * FOTA download library into the DFU target, and the Update resource
+ * (/5/0/2) deregisters and reboots into the new image. After the reboot
+ * the image is confirmed and the Update Result reports success.
+ *
+ * Must be called after the engine objects have been initialized and
+ * before the registration client is started.
+ *
+ * @param ctx LwM2M client context, deregistered before the reboot.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_fota_init( struct lwm2m_ctx * ctx );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_FOTA_H__ */
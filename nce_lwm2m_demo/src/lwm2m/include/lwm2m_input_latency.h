@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_INPUT_LATENCY_H__
+#define LWM2M_INPUT_LATENCY_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined( CONFIG_APP_LWM2M_INPUT_LATENCY )
+
+/**
+ * @brief Record an input edge that changed an object instance.
+ *
+ * The latency runs until the next acknowledged notification of the
+ * object instance. Further edges before it are covered by the first one.
+ *
+ * @param obj_id Object ID.
+ * @param obj_inst_id Object instance ID.
+ * @param edge_ms Uptime of the edge, as carried by the ui input event.
+ */
+void lwm2m_input_latency_edge( uint16_t obj_id,
+                               uint16_t obj_inst_id,
+                               int64_t edge_ms );
+
+/**
+ * @brief Account an acknowledged notification.
+ *
+ * Adds the latency of every pending edge of the observed path to the
+ * histogram and logs it. Safe to call from the LwM2M engine callbacks.
+ *
+ * @param path First path of the observation.
+ */
+void lwm2m_input_latency_notified( const struct lwm2m_obj_path * path );
+
+#else /* if defined( CONFIG_APP_LWM2M_INPUT_LATENCY ) */
+
+static inline void lwm2m_input_latency_edge( uint16_t obj_id,
+                                             uint16_t obj_inst_id,
+                                             int64_t edge_ms )
+{
+}
+
+static inline void lwm2m_input_latency_notified( const struct lwm2m_obj_path * path )
+{
+}
+
+#endif /* if defined( CONFIG_APP_LWM2M_INPUT_LATENCY ) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_INPUT_LATENCY_H__ */
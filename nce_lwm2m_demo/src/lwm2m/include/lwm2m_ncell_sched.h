@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_NCELL_SCHED_H__
+#define LWM2M_NCELL_SCHED_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start adaptive scheduling of neighbour cell measurements.
+ *
+ * Scans start every CONFIG_APP_NEIGHBOUR_CELL_SCAN_INTERVAL seconds. The
+ * interval doubles while the serving cell and its RSRP stay the same, up to
+ * CONFIG_APP_NEIGHBOUR_CELL_SCAN_MAX_INTERVAL, and falls back to the fast
+ * interval on a cell change or an RSRP change of at least
+ * CONFIG_APP_NEIGHBOUR_CELL_RSRP_DELTA dB. A due scan waits up to
+ * CONFIG_APP_NEIGHBOUR_CELL_SCAN_RRC_WAIT seconds for an RRC connection, so
+ * it runs while the modem is awake anyway.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_ncell_sched_init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_NCELL_SCHED_H__ */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_NOTIFY_COALESCE_H__
+#define LWM2M_NOTIFY_COALESCE_H__
+
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined( CONFIG_APP_LWM2M_NOTIFY_COALESCE )
+
+/**
+ * @brief Stage a resource value, written to the engine when the window closes.
+ *
+ * The first staged change opens a window of CONFIG_APP_LWM2M_NOTIFY_COALESCE_WINDOW_MS.
+ * All changes staged until it closes are written back to back, so the engine
+ * sends one notification for them, still subject to the server's pmin/pmax.
+ * A later value of the same resource replaces the earlier one; every rising
+ * edge of a boolean inside the window is written as a pulse, so counters such
+ * as the push button counter step once per press.
+ *
+ * @param path Resource path.
+ * @param value New value.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_coalesce_set_bool( const struct lwm2m_obj_path * path,
+                             bool value );
+
+/**
+ * @brief Stage an integer resource value, see lwm2m_coalesce_set_bool().
+ */
+int lwm2m_coalesce_set_s32( const struct lwm2m_obj_path * path,
+                            int32_t value );
+
+/**
+ * @brief Stage a time resource value, see lwm2m_coalesce_set_bool().
+ */
+int lwm2m_coalesce_set_time( const struct lwm2m_obj_path * path,
+                             time_t value );
+
+/**
+ * @brief Count a notification that left the device.
+ *
+ * Called for every acknowledged or timed out notification. Only
+ * notifications of objects with staged resources are counted, the count
+ * is logged with the staged changes at debug level.
+ *
+ * @param path First path of the observation.
+ */
+void lwm2m_coalesce_notified( const struct lwm2m_obj_path * path );
+
+#else /* if defined( CONFIG_APP_LWM2M_NOTIFY_COALESCE ) */
+
+static inline int lwm2m_coalesce_set_bool( const struct lwm2m_obj_path * path,
+                                           bool value )
+{
+    return lwm2m_set_bool( path, value );
+}
+
+static inline int lwm2m_coalesce_set_s32( const struct lwm2m_obj_path * path,
+                                          int32_t value )
+{
+    return lwm2m_set_s32( path, value );
+}
+
+static inline int lwm2m_coalesce_set_time( const struct lwm2m_obj_path * path,
+                                           time_t value )
+{
+    return lwm2m_set_time( path, value );
+}
+
+static inline void lwm2m_coalesce_notified( const struct lwm2m_obj_path * path )
+{
+}
+
+#endif /* if defined( CONFIG_APP_LWM2M_NOTIFY_COALESCE ) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_NOTIFY_COALESCE_H__ */
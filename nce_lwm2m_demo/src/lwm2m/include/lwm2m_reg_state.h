@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_REG_STATE_H__
+#define LWM2M_REG_STATE_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Load the registration state persisted by the previous boot.
+ *
+ * @param endpoint Endpoint name, a stored state of another endpoint is ignored.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_reg_state_init( const char * endpoint );
+
+/**
+ * @brief Flags for lwm2m_rd_client_start().
+ *
+ * The bootstrap is skipped when the previous boot registered with the
+ * server account that is still stored, and forced after that account
+ * was rejected.
+ *
+ * @return uint32_t 0 or LWM2M_RD_CLIENT_FLAG_BOOTSTRAP.
+ */
+uint32_t lwm2m_reg_state_bootstrap_flags( void );
+
+/**
+ * @brief Record a completed registration.
+ *
+ * The first one after boot reports the time-to-registered. The state is
+ * written to settings from the system workqueue, so this may be called
+ * from the LwM2M engine callback.
+ *
+ * @param srv_obj_inst Server object instance the client registered with.
+ */
+void lwm2m_reg_state_registered( uint16_t srv_obj_inst );
+
+/**
+ * @brief Track the registration outcome from an RD client event.
+ *
+ * Timeouts and network errors mark the next registration failure as
+ * transient, a completed registration clears the mark.
+ *
+ * @param client_event Event reported by the LwM2M RD client.
+ */
+void lwm2m_reg_state_event( enum lwm2m_rd_client_event client_event );
+
+/**
+ * @brief Record a failed registration.
+ *
+ * Only a failure the server answered with an error code counts as a
+ * rejection. After a timeout or network error the stored account is kept.
+ *
+ * @return bool true if a stored account was rejected and the client must
+ *         be restarted with a bootstrap.
+ */
+bool lwm2m_reg_state_rejected( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_REG_STATE_H__ */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_SEND_HISTORY_H__
+#define LWM2M_SEND_HISTORY_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start sampling device resources into the time-series cache.
+ *
+ * Every CONFIG_APP_LWM2M_SEND_HISTORY_INTERVAL seconds the battery voltage
+ * and signal strength are stored with their timestamp. Every
+ * CONFIG_APP_LWM2M_SEND_HISTORY_BATCH samples the cached history is sent
+ * in one LwM2M Send message.
+ *
+ * Must be called after the device object has been initialized.
+ *
+ * @param ctx LwM2M client context used for the Send operation.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_send_history_init( struct lwm2m_ctx * ctx );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_SEND_HISTORY_H__ */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_SETTINGS_WB_H__
+#define LWM2M_SETTINGS_WB_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register the write-back buffer as a settings source.
+ *
+ * The shared write-back buffer (lib/write_back) writes with
+ * settings_save_one(). It is loaded after the settings backend, so
+ * settings_load() and settings_load_subtree_direct() see a value saved
+ * with lwm2m_settings_wb_save() before it reached flash.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_settings_wb_init( void );
+
+/**
+ * @brief Save a key through the write-back buffer.
+ *
+ * The value is kept in RAM. A later save of the same key replaces the
+ * pending one. The first pending save opens a window of
+ * CONFIG_NCE_WRITE_BACK_WINDOW_MS, after which all pending keys are
+ * written to flash from the system workqueue. Values larger than
+ * CONFIG_NCE_WRITE_BACK_VALUE_SIZE and new keys while the buffer is full
+ * are written right away.
+ *
+ * @param name Settings key.
+ * @param value Value, copied.
+ * @param len Length of the value, 0 deletes the key.
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_settings_wb_save( const char * name,
+                            const void * value,
+                            size_t len );
+
+/**
+ * @brief Write all pending keys to flash now.
+ *
+ * Call before a reboot. Blocks for the flash writes, so not from the LwM2M
+ * engine callbacks.
+ *
+ * @return int 0 if successful, negative error code of the last failed write if not.
+ */
+int lwm2m_settings_wb_flush( void );
+
+/**
+ * @brief Route the stored security and server objects through the buffer.
+ *
+ * Replaces the post-write callbacks of the LwM2M client utilities for the
+ * resources of the registered account that servers or the demo change,
+ * such as the lifetime, with ones that save the same settings keys through
+ * lwm2m_settings_wb_save(). Call on every completed registration, the
+ * client utilities register their callbacks again for the instances a
+ * bootstrap creates.
+ *
+ * @param client LwM2M context of the registered client.
+ */
+void lwm2m_settings_wb_registered( const struct lwm2m_ctx * client );
+
+/**
+ * @brief Flush early when the client stops or goes idle.
+ *
+ * Pending object keys are dropped when a bootstrap starts, since it
+ * deletes and rewrites them. Safe to call from the LwM2M engine callback,
+ * the flush runs on the system workqueue.
+ *
+ * @param event Registration client event.
+ */
+void lwm2m_settings_wb_event( enum lwm2m_rd_client_event event );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_SETTINGS_WB_H__ */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef LWM2M_SIM_H__
+#define LWM2M_SIM_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set up the client for a local LwM2M server without a modem.
+ *
+ * Points the security and server objects at CONFIG_APP_LWM2M_SIM_SERVER
+ * (no bootstrap, no DTLS) and starts the stand-ins for the modem objects:
+ * the serving cell and signal strength of the connectivity monitoring
+ * object, which take the place of the neighbour cell measurements, and
+ * the location object, which takes the place of GNSS fixes. Both are
+ * updated every CONFIG_APP_LWM2M_SIM_UPDATE_INTERVAL seconds.
+ *
+ * Must be called after the device object has been initialized.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int lwm2m_sim_init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWM2M_SIM_H__ */
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/net/lwm2m.h>
+
+#if defined( CONFIG_LTE_LINK_CONTROL )
+    #include <modem/lte_lc.h>
+#endif
+
+#include "lwm2m_adaptive_lifetime.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+#define LIFETIME_MIN       CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME_MIN
+#define LIFETIME_MAX       CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME_MAX
+#define ACTIVE_TIME_MIN    CONFIG_APP_LWM2M_ADAPTIVE_ACTIVE_TIME_MIN
+#define ACTIVE_TIME_MAX    CONFIG_APP_LWM2M_ADAPTIVE_ACTIVE_TIME_MAX
+
+BUILD_ASSERT( LIFETIME_MIN <= LIFETIME_MAX, "Adaptive lifetime bounds are swapped" );
+BUILD_ASSERT( ACTIVE_TIME_MIN <= ACTIVE_TIME_MAX, "Adaptive active time bounds are swapped" );
+
+static struct k_spinlock lock;
+static uint32_t lifetime_s = CLAMP( CONFIG_LWM2M_ENGINE_DEFAULT_LIFETIME, LIFETIME_MIN, LIFETIME_MAX );
+static uint32_t active_time_s = ACTIVE_TIME_MAX;
+static uint32_t quiet_cycles;
+
+/* The next completed update is the one triggered by our own lifetime write */
+static bool change_pending;
+
+/* The server sets up its observations after every registration, operations
+ * before the first update are not counted as demand */
+static bool first_cycle;
+static atomic_t downlink_seen;
+
+static void ( * apply_lifetime )( void );
+
+/* Report counters */
+static int64_t init_ms;
+static int64_t cycle_start_ms;
+static uint32_t updates;
+static uint64_t cycle_total_ms;
+static uint32_t cycles;
+
+#if defined( CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS )
+static int64_t sleep_enter_ms;
+static uint64_t sleep_total_ms;
+static uint32_t sleeps;
+#endif
+
+static void adaptive_apply_work_handler( struct k_work * work );
+
+static K_WORK_DEFINE( adaptive_apply_work, adaptive_apply_work_handler );
+
+static void adaptive_apply_work_handler( struct k_work * work )
+{
+    k_spinlock_key_t key = k_spin_lock( &lock );
+    uint32_t lifetime = lifetime_s;
+    uint32_t active_time = active_time_s;
+
+    k_spin_unlock( &lock, key );
+
+    #if defined( CONFIG_LTE_PSM_REQ )
+    /* Periodic TAU follows the lifetime, so neither wakes the modem for the other */
+    int err = lte_lc_psm_param_set_seconds( lifetime, active_time );
+
+    if( err == 0 )
+    {
+        err = lte_lc_psm_req( true );
+    }
+
+    if( err )
+    {
+        LOG_WRN( "Unable to request PSM active time %u s (%d)", active_time, err );
+    }
+    #endif
+
+    LOG_INF( "Adaptive lifetime %u s, active time %u s", lifetime, active_time );
+
+    /* Writing the lifetime resource makes the engine send an update with it */
+    apply_lifetime();
+}
+
+/* Must be called with the lock held */
+static void adaptive_change( uint32_t lifetime,
+                             uint32_t active_time )
+{
+    lifetime_s = lifetime;
+    active_time_s = active_time;
+    quiet_cycles = 0;
+    change_pending = true;
+    k_work_submit( &adaptive_apply_work );
+}
+
+static void adaptive_report( void )
+{
+    uint32_t uptime_s = ( uint32_t ) ( ( k_uptime_get() - init_ms ) / MSEC_PER_SEC );
+    uint32_t per_day_x100 = ( uptime_s > 0 ) ? ( uint32_t ) ( ( uint64_t ) updates * 8640000U / uptime_s ) : 0;
+
+    #if defined( CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS )
+    LOG_INF( "Lifetime %u s: %u.%02u updates/day, mean sleep %u s over %u sleeps",
+             lifetime_s, per_day_x100 / 100, per_day_x100 % 100,
+             ( sleeps > 0 ) ? ( uint32_t ) ( sleep_total_ms / sleeps / MSEC_PER_SEC ) : 0, sleeps );
+    #else
+    LOG_INF( "Lifetime %u s: %u.%02u updates/day, mean time between updates %u s",
+             lifetime_s, per_day_x100 / 100, per_day_x100 % 100,
+             ( cycles > 0 ) ? ( uint32_t ) ( cycle_total_ms / cycles / MSEC_PER_SEC ) : 0 );
+    #endif
+}
+
+/* Must be called with the lock held */
+static void adaptive_cycle_done( void )
+{
+    bool downlink = atomic_clear( &downlink_seen );
+
+    if( first_cycle )
+    {
+        first_cycle = false;
+        return;
+    }
+
+    if( change_pending )
+    {
+        /* The update that carried our new lifetime, not a full cycle */
+        change_pending = false;
+        return;
+    }
+
+    if( downlink )
+    {
+        /* Already shortened when the operation arrived */
+        quiet_cycles = 0;
+        return;
+    }
+
+    quiet_cycles++;
+
+    if( ( quiet_cycles >= CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME_QUIET_CYCLES ) &&
+        ( ( lifetime_s < LIFETIME_MAX ) || ( active_time_s > ACTIVE_TIME_MIN ) ) )
+    {
+        adaptive_change( MIN( lifetime_s * 2U, LIFETIME_MAX ), MAX( active_time_s / 2U, ACTIVE_TIME_MIN ) );
+    }
+}
+
+void lwm2m_adaptive_lifetime_event( enum lwm2m_rd_client_event event )
+{
+    k_spinlock_key_t key;
+    int64_t now = k_uptime_get();
+
+    switch( event )
+    {
+        case LWM2M_RD_CLIENT_EVENT_REGISTRATION_COMPLETE:
+            key = k_spin_lock( &lock );
+            atomic_clear( &downlink_seen );
+            first_cycle = true;
+            change_pending = false;
+            quiet_cycles = 0;
+            cycle_start_ms = now;
+            k_spin_unlock( &lock, key );
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_REG_UPDATE_COMPLETE:
+            key = k_spin_lock( &lock );
+            updates++;
+            cycles++;
+            cycle_total_ms += now - cycle_start_ms;
+            cycle_start_ms = now;
+            adaptive_cycle_done();
+            k_spin_unlock( &lock, key );
+            adaptive_report();
+            break;
+
+        default:
+            break;
+    }
+}
+
+void lwm2m_adaptive_lifetime_downlink( void )
+{
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    if( first_cycle )
+    {
+        k_spin_unlock( &lock, key );
+        return;
+    }
+
+    atomic_set( &downlink_seen, 1 );
+
+    if( ( lifetime_s > LIFETIME_MIN ) || ( active_time_s < ACTIVE_TIME_MAX ) )
+    {
+        adaptive_change( LIFETIME_MIN, ACTIVE_TIME_MAX );
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+uint32_t lwm2m_adaptive_lifetime_get( void )
+{
+    k_spinlock_key_t key = k_spin_lock( &lock );
+    uint32_t lifetime = lifetime_s;
+
+    k_spin_unlock( &lock, key );
+
+    return lifetime;
+}
+
+#if defined( CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS )
+static void adaptive_lte_handler( const struct lte_lc_evt *const evt )
+{
+    k_spinlock_key_t key;
+
+    switch( evt->type )
+    {
+        case LTE_LC_EVT_MODEM_SLEEP_ENTER:
+            key = k_spin_lock( &lock );
+            sleep_enter_ms = k_uptime_get();
+            k_spin_unlock( &lock, key );
+            break;
+
+        case LTE_LC_EVT_MODEM_SLEEP_EXIT:
+            key = k_spin_lock( &lock );
+
+            if( sleep_enter_ms > 0 )
+            {
+                sleep_total_ms += k_uptime_get() - sleep_enter_ms;
+                sleeps++;
+                sleep_enter_ms = 0;
+            }
+
+            k_spin_unlock( &lock, key );
+            break;
+
+        default:
+            break;
+    }
+}
+#endif /* if defined( CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS ) */
+
+int lwm2m_adaptive_lifetime_init( void ( * update_lifetime )( void ) )
+{
+    if( update_lifetime == NULL )
+    {
+        return -EINVAL;
+    }
+
+    apply_lifetime = update_lifetime;
+    init_ms = k_uptime_get();
+
+    #if defined( CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS )
+    lte_lc_register_handler( adaptive_lte_handler );
+    #endif
+
+    return 0;
+}
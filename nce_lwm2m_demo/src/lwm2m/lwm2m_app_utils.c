@@ -9,6 +9,7 @@
 #include <lwm2m_resource_ids.h>
 
 #include "lwm2m_app_utils.h"
+#include "lwm2m_notify_coalesce.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER( app_lwm2m, CONFIG_APP_LOG_LEVEL );
@@ -16,12 +17,43 @@ LOG_MODULE_REGISTER( app_lwm2m, CONFIG_APP_LOG_LEVEL );
 void set_ipso_obj_timestamp( int ipso_obj_id,
                              unsigned int obj_inst_id )
 {
+    set_ipso_obj_timestamp_at( ipso_obj_id, obj_inst_id, k_uptime_get() );
+}
+
+void set_ipso_obj_timestamp_at( int ipso_obj_id,
+                                unsigned int obj_inst_id,
+                                int64_t uptime_ms )
+{
+    /* Wall clock time of the given uptime */
+    time_t timestamp = time( NULL ) - ( time_t ) ( ( k_uptime_get() - uptime_ms ) / MSEC_PER_SEC );
     int ret;
 
-    ret = lwm2m_set_time( &LWM2M_OBJ( ipso_obj_id, obj_inst_id, TIMESTAMP_RID ), time( NULL ) );
+    ret = lwm2m_coalesce_set_time( &LWM2M_OBJ( ipso_obj_id, obj_inst_id, TIMESTAMP_RID ), timestamp );
 
     if( ret )
     {
         LOG_ERR( "Unable to set timestamp" );
     }
 }
+
+void lwm2m_cb_timing_record( struct lwm2m_cb_timing * timing,
+                             int event,
+                             uint32_t start_cycles )
+{
+    uint32_t duration_us = k_cyc_to_us_floor32( k_cycle_get_32() - start_cycles );
+
+    timing->calls++;
+
+    if( duration_us > timing->max_us )
+    {
+        timing->max_us = duration_us;
+        timing->max_event = event;
+        LOG_DBG( "%s: new worst case %u us (event %d)", timing->name, duration_us, event );
+    }
+
+    if( duration_us > CONFIG_APP_CALLBACK_WARN_MS * USEC_PER_MSEC )
+    {
+        LOG_WRN( "%s blocked the LwM2M engine for %u ms (event %d)",
+                 timing->name, duration_us / USEC_PER_MSEC, event );
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/net/net_stats.h>
+#include <zephyr/sys/sys_heap.h>
+
+#include "lwm2m_benchmark.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+/* Thread of the Zephyr LwM2M engine, the registration client and all
+ * engine callbacks run on it */
+#define ENGINE_THREAD_NAME    "lwm2m-sock-recv"
+
+extern struct k_heap _system_heap;
+
+struct thread_stack_use
+{
+    const char * name;
+    size_t size;
+    size_t used;
+};
+
+static int64_t start_ms;
+static uint32_t registration_ms;
+static uint32_t registration_bytes;
+
+/* Network bytes at the last completed registration or update */
+static uint32_t cycle_start_bytes;
+static uint32_t last_cycle_bytes;
+static uint32_t min_cycle_bytes = UINT32_MAX;
+static uint32_t max_cycle_bytes;
+static uint64_t total_cycle_bytes;
+static uint32_t cycles;
+
+static void benchmark_report_handler( struct k_work * work );
+
+static K_WORK_DEFINE( benchmark_report_work, benchmark_report_handler );
+
+static uint32_t benchmark_net_bytes( void )
+{
+    struct net_stats_bytes bytes = { 0 };
+
+    /* All interfaces, the LwM2M socket is the only traffic of the demo */
+    if( net_mgmt( NET_REQUEST_STATS_GET_BYTES, NULL, &bytes, sizeof( bytes ) ) )
+    {
+        return 0;
+    }
+
+    return bytes.sent + bytes.received;
+}
+
+static void benchmark_stack_cb( const struct k_thread * thread, void * user_data )
+{
+    struct thread_stack_use * use = user_data;
+    const char * name = k_thread_name_get( ( k_tid_t ) thread );
+    size_t unused;
+
+    if( ( name == NULL ) || ( strcmp( name, use->name ) != 0 ) )
+    {
+        return;
+    }
+
+    if( k_thread_stack_space_get( thread, &unused ) == 0 )
+    {
+        use->size = thread->stack_info.size;
+        use->used = thread->stack_info.size - unused;
+    }
+}
+
+static void benchmark_log_stack( const char * name )
+{
+    struct thread_stack_use use = { .name = name };
+
+    k_thread_foreach( benchmark_stack_cb, &use );
+
+    if( use.size > 0 )
+    {
+        LOG_INF( "LwM2M benchmark: %s stack peak %zu of %zu bytes", name, use.used, use.size );
+    }
+}
+
+static void benchmark_report_handler( struct k_work * work )
+{
+    struct sys_memory_stats heap;
+
+    LOG_INF( "LwM2M benchmark: registration %u ms, %u bytes", registration_ms, registration_bytes );
+
+    if( cycles > 0 )
+    {
+        LOG_INF( "LwM2M benchmark: %u update cycles, bytes/cycle last %u, min %u, avg %u, max %u",
+                 cycles, last_cycle_bytes, min_cycle_bytes,
+                 ( uint32_t ) ( total_cycle_bytes / cycles ), max_cycle_bytes );
+    }
+
+    if( sys_heap_runtime_stats_get( &_system_heap.heap, &heap ) == 0 )
+    {
+        LOG_INF( "LwM2M benchmark: heap peak %zu of %zu bytes", heap.max_allocated_bytes,
+                 heap.allocated_bytes + heap.free_bytes );
+    }
+
+    benchmark_log_stack( ENGINE_THREAD_NAME );
+    benchmark_log_stack( "sysworkq" );
+}
+
+void lwm2m_benchmark_client_start( void )
+{
+    start_ms = k_uptime_get();
+    cycle_start_bytes = benchmark_net_bytes();
+}
+
+void lwm2m_benchmark_event( enum lwm2m_rd_client_event event )
+{
+    uint32_t bytes;
+
+    switch( event )
+    {
+        case LWM2M_RD_CLIENT_EVENT_REGISTRATION_COMPLETE:
+            bytes = benchmark_net_bytes();
+            registration_ms = ( uint32_t ) ( k_uptime_get() - start_ms );
+            registration_bytes = bytes - cycle_start_bytes;
+            cycle_start_bytes = bytes;
+            k_work_submit( &benchmark_report_work );
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_REG_UPDATE_COMPLETE:
+            /* Everything since the previous update: notifications, Sends and the update itself */
+            bytes = benchmark_net_bytes();
+            last_cycle_bytes = bytes - cycle_start_bytes;
+            cycle_start_bytes = bytes;
+            min_cycle_bytes = MIN( min_cycle_bytes, last_cycle_bytes );
+            max_cycle_bytes = MAX( max_cycle_bytes, last_cycle_bytes );
+            total_cycle_bytes += last_cycle_bytes;
+            cycles++;
+            k_work_submit( &benchmark_report_work );
+            break;
+
+        default:
+            break;
+    }
+}
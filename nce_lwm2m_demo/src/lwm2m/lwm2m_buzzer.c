@@ -10,6 +10,7 @@
 #include "lwm2m_engine.h"
 #include "ui_buzzer.h"
 #include "lwm2m_app_utils.h"
+#include "lwm2m_adaptive_lifetime.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
@@ -33,6 +34,8 @@ static int buzzer_state_cb( uint16_t obj_inst_id,
     int ret;
     bool state = *( bool * ) data;
 
+    lwm2m_adaptive_lifetime_downlink();
+
     ret = ui_buzzer_on_off( state );
 
     if( ret )
@@ -63,6 +66,8 @@ static int buzzer_intensity_cb( uint16_t obj_inst_id,
     int ret;
     uint8_t intensity = *( double * ) data;
 
+    lwm2m_adaptive_lifetime_downlink();
+
     ret = ui_buzzer_set_intensity( intensity );
 
     if( ret )
@@ -6,12 +6,20 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log_ctrl.h>
+#include <zephyr/sys/reboot.h>
 #include <zephyr/net/lwm2m.h>
 #include <zephyr/net/lwm2m_path.h>
 #include <ncs_version.h>
 
-#include "pm_config.h"
 #include "lwm2m_app_utils.h"
+#include "lwm2m_adaptive_lifetime.h"
+#if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    #include "lwm2m_settings_wb.h"
+#endif
+
+#if defined( CONFIG_PARTITION_MANAGER_ENABLED )
+    #include "pm_config.h"
+#endif
 
 #ifdef CONFIG_SOC_SERIES_NRF91X
     #include <modem/modem_info.h>
@@ -21,7 +29,11 @@
 LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
 
 #define CLIENT_MODEL_NUMBER    CONFIG_BOARD
-#define CLIENT_FLASH_SIZE      PM_MCUBOOT_SECONDARY_SIZE
+#if defined( CONFIG_PARTITION_MANAGER_ENABLED )
+    #define CLIENT_FLASH_SIZE      PM_MCUBOOT_SECONDARY_SIZE
+#else
+    #define CLIENT_FLASH_SIZE      0 /* native_sim, no firmware update partition */
+#endif
 
 #define UTC_OFFSET_STR_LEN     7  /* '+00:00' + '\0' = 7 */
 #define TIMEZONE_STR_LEN       33 /* Longest: 'America/Argentina/ComodRivadavia' + '\0' = 33 */
@@ -38,6 +50,38 @@ static char utc_offset[ UTC_OFFSET_STR_LEN ] = "";
 static char timezone[ TIMEZONE_STR_LEN ] = "";
 static uint8_t bat_level;
 
+static void device_reboot_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( device_reboot_work, device_reboot_work_handler );
+
+static void device_reboot_work_handler( struct k_work * work )
+{
+    ARG_UNUSED( work );
+
+    #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    lwm2m_settings_wb_flush();
+    #endif
+
+    LOG_INF( "DEVICE: REBOOT" );
+    LOG_PANIC();
+    sys_reboot( SYS_REBOOT_COLD );
+}
+
+static int device_reboot_cb( uint16_t obj_inst_id,
+                             uint8_t * args,
+                             uint16_t args_len )
+{
+    ARG_UNUSED( args );
+    ARG_UNUSED( args_len );
+
+    lwm2m_adaptive_lifetime_downlink();
+
+    /* Lets the execute response leave before the reboot */
+    k_work_schedule( &device_reboot_work, K_SECONDS( 1 ) );
+
+    return 0;
+}
+
 static int device_factory_default_cb( uint16_t obj_inst_id,
                                       uint8_t * args,
                                       uint16_t args_len )
@@ -45,6 +89,7 @@ static int device_factory_default_cb( uint16_t obj_inst_id,
     ARG_UNUSED( args );
     ARG_UNUSED( args_len );
 
+    lwm2m_adaptive_lifetime_downlink();
     LOG_INF( "DEVICE: FACTORY DEFAULT (TODO)" );
 
     return 0;
@@ -57,23 +102,22 @@ int lwm2m_app_init_device( char * serial_num )
     const char * client_sw_ver = ( strlen( CONFIG_APP_CUSTOM_VERSION ) > 0 ) ?
                                  CONFIG_APP_CUSTOM_VERSION : NCS_VERSION_STRING;
 
-    if( IS_ENABLED( CONFIG_SOC_SERIES_NRF91X ) )
+    #ifdef CONFIG_SOC_SERIES_NRF91X
+    int err;
+    static char hw_buf[ sizeof( "nRF91__ ____ ___ " ) ];
+
+    err = modem_info_get_hw_version( hw_buf, sizeof( hw_buf ) );
+
+    if( err == 0 )
+    {
+        hw_str = hw_buf;
+        hw_str_len = strlen( hw_buf ) + 1;
+    }
+    else
     {
-        int err;
-        static char hw_buf[ sizeof( "nRF91__ ____ ___ " ) ];
-
-        err = modem_info_get_hw_version( hw_buf, sizeof( hw_buf ) );
-
-        if( err == 0 )
-        {
-            hw_str = hw_buf;
-            hw_str_len = strlen( hw_buf ) + 1;
-        }
-        else
-        {
-            LOG_ERR( "modem_info_get_hw_version() failed, err %d", err );
-        }
+        LOG_ERR( "modem_info_get_hw_version() failed, err %d", err );
     }
+    #endif
 
     lwm2m_set_res_buf( &LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0, MANUFACTURER_RID ),
                        CONFIG_APP_MANUFACTURER, sizeof( CONFIG_APP_MANUFACTURER ),
@@ -84,6 +128,8 @@ int lwm2m_app_init_device( char * serial_num )
     lwm2m_set_res_buf( &LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0, SERIAL_NUMBER_RID ),
                        serial_num, strlen( serial_num ), strlen( serial_num ),
                        LWM2M_RES_DATA_FLAG_RO );
+    lwm2m_register_exec_callback( &LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0, REBOOT_RID ),
+                                  device_reboot_cb );
     lwm2m_register_exec_callback( &LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0,
                                               FACTORY_RESET_RID ),
                                   device_factory_default_cb );
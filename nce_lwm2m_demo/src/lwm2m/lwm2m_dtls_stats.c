@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/net/socket.h>
+
+#include "lwm2m_dtls_stats.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+enum handshake_type
+{
+    HANDSHAKE_FULL,
+    HANDSHAKE_RESUMED,
+    HANDSHAKE_UNKNOWN,
+    HANDSHAKE_TYPES
+};
+
+static const char * const handshake_names[ HANDSHAKE_TYPES ] = { "full", "resumed", "unknown" };
+
+/* Socket callbacks installed by lwm2m_init_security() */
+static int (* security_set_socketoptions)( struct lwm2m_ctx * client_ctx );
+static void (* security_set_socket_state)( int fd,
+                                           enum lwm2m_socket_states state );
+
+/* Engine thread only */
+static int64_t handshake_start_ms;
+static bool session_new;
+static uint32_t handshake_count[ HANDSHAKE_TYPES ];
+static uint32_t handshake_total_ms[ HANDSHAKE_TYPES ];
+static uint32_t handshake_max_ms[ HANDSHAKE_TYPES ];
+static uint32_t updates_without_handshake;
+static uint32_t update_timeouts;
+
+static int dtls_stats_set_socketoptions( struct lwm2m_ctx * client_ctx )
+{
+    handshake_start_ms = k_uptime_get();
+
+    if( security_set_socketoptions )
+    {
+        return security_set_socketoptions( client_ctx );
+    }
+
+    return lwm2m_set_default_sockopt( client_ctx );
+}
+
+static enum handshake_type dtls_stats_handshake_type( int fd )
+{
+    #if defined( TLS_DTLS_HANDSHAKE_STATUS )
+    int handshake_status;
+    socklen_t len = sizeof( handshake_status );
+
+    if( zsock_getsockopt( fd, SOL_TLS, TLS_DTLS_HANDSHAKE_STATUS, &handshake_status, &len ) )
+    {
+        LOG_WRN( "Failed to read DTLS handshake status (%d)", errno );
+        return HANDSHAKE_UNKNOWN;
+    }
+
+    return ( handshake_status == TLS_DTLS_HANDSHAKE_STATUS_CACHED ) ? HANDSHAKE_RESUMED : HANDSHAKE_FULL;
+    #else
+    ARG_UNUSED( fd );
+
+    return HANDSHAKE_UNKNOWN;
+    #endif
+}
+
+static void dtls_stats_handshake_done( int fd )
+{
+    uint32_t duration_ms = ( uint32_t ) ( k_uptime_get() - handshake_start_ms );
+    enum handshake_type type = dtls_stats_handshake_type( fd );
+
+    handshake_start_ms = 0;
+    session_new = true;
+    handshake_count[ type ]++;
+    handshake_total_ms[ type ] += duration_ms;
+    handshake_max_ms[ type ] = MAX( handshake_max_ms[ type ], duration_ms );
+
+    LOG_INF( "DTLS %s handshake took %u ms (avg %u ms, max %u ms), "
+             "%u full, %u resumed, %u unknown, %u updates without handshake, %u update timeouts",
+             handshake_names[ type ], duration_ms, handshake_total_ms[ type ] / handshake_count[ type ],
+             handshake_max_ms[ type ], handshake_count[ HANDSHAKE_FULL ],
+             handshake_count[ HANDSHAKE_RESUMED ], handshake_count[ HANDSHAKE_UNKNOWN ],
+             updates_without_handshake, update_timeouts );
+}
+
+/* The engine hints the socket state before every send, the first one follows the connect */
+static void dtls_stats_set_socket_state( int fd,
+                                         enum lwm2m_socket_states state )
+{
+    if( handshake_start_ms != 0 )
+    {
+        dtls_stats_handshake_done( fd );
+    }
+
+    if( security_set_socket_state )
+    {
+        security_set_socket_state( fd, state );
+    }
+}
+
+void lwm2m_dtls_stats_event( enum lwm2m_rd_client_event client_event )
+{
+    switch( client_event )
+    {
+        case LWM2M_RD_CLIENT_EVENT_BOOTSTRAP_REG_COMPLETE:
+        case LWM2M_RD_CLIENT_EVENT_REGISTRATION_COMPLETE:
+            session_new = false;
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_REG_UPDATE_COMPLETE:
+
+            if( !session_new )
+            {
+                updates_without_handshake++;
+            }
+
+            session_new = false;
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_REG_TIMEOUT:
+            /* Stale resumed session, the client falls back to a full registration */
+            update_timeouts++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void lwm2m_dtls_stats_init( struct lwm2m_ctx * ctx )
+{
+    security_set_socketoptions = ctx->set_socketoptions;
+    ctx->set_socketoptions = dtls_stats_set_socketoptions;
+    security_set_socket_state = ctx->set_socket_state;
+    ctx->set_socket_state = dtls_stats_set_socket_state;
+}
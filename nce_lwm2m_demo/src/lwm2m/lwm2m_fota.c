@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/sys/reboot.h>
+#include <custom_fota_download.h>
+#include <dfu/dfu_target.h>
+
+#if defined( CONFIG_BOOTLOADER_MCUBOOT )
+    #include <zephyr/dfu/mcuboot.h>
+#endif
+
+#include "lwm2m_app_utils.h"
+#include "lwm2m_fota.h"
+#include "lwm2m_adaptive_lifetime.h"
+
+#if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    #include "lwm2m_settings_wb.h"
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+/* The image is only marked for the bootloader when Update is executed, so it can still be discarded */
+BUILD_ASSERT( !IS_ENABLED( CONFIG_CUSTOM_FOTA_CLIENT_AUTOSCHEDULE_UPDATE ),
+              "Set CONFIG_CUSTOM_FOTA_CLIENT_AUTOSCHEDULE_UPDATE=n, see overlay-fota.conf" );
+
+/* Firmware Update object states, /5/0/3 */
+#define FOTA_STATE_IDLE                0
+#define FOTA_STATE_DOWNLOADING         1
+#define FOTA_STATE_DOWNLOADED          2
+
+/* Firmware Update object results, /5/0/5 */
+#define FOTA_RESULT_DEFAULT            0
+#define FOTA_RESULT_SUCCESS            1
+#define FOTA_RESULT_CONNECTION_LOST    4
+#define FOTA_RESULT_INTEGRITY_FAILED   5
+#define FOTA_RESULT_UNSUPPORTED_TYPE   6
+#define FOTA_RESULT_INVALID_URI        7
+#define FOTA_RESULT_UPDATE_FAILED      8
+#define FOTA_RESULT_UNSUPPORTED_PROTO  9
+
+#define FOTA_DELIVERY_PULL_ONLY        0
+
+/* Time for the de-register to leave the device */
+#define FOTA_REBOOT_DELAY_S            3
+
+static struct lwm2m_ctx * client_ctx;
+static char package_uri[ CONFIG_LWM2M_FIRMWARE_PACKAGE_URI_LEN + 1 ];
+static int64_t download_start_ms;
+static int last_progress;
+static int64_t last_progress_ms;
+
+static void fota_start_work_handler( struct k_work * work );
+static void fota_reboot_work_handler( struct k_work * work );
+
+static K_WORK_DEFINE( fota_start_work, fota_start_work_handler );
+static K_WORK_DELAYABLE_DEFINE( fota_reboot_work, fota_reboot_work_handler );
+
+static void fota_set_state( uint8_t state,
+                            uint8_t result )
+{
+    lwm2m_set_u8( &LWM2M_OBJ( LWM2M_OBJECT_FIRMWARE_ID, 0, FIRMWARE_UPDATE_RESULT_RID ), result );
+    lwm2m_set_u8( &LWM2M_OBJ( LWM2M_OBJECT_FIRMWARE_ID, 0, FIRMWARE_STATE_RID ), state );
+}
+
+static uint8_t fota_get_state( void )
+{
+    uint8_t state = FOTA_STATE_IDLE;
+
+    lwm2m_get_u8( &LWM2M_OBJ( LWM2M_OBJECT_FIRMWARE_ID, 0, FIRMWARE_STATE_RID ), &state );
+
+    return state;
+}
+
+/* Splits "coap://host:port/path/file" into the host part, scheme and port
+ * included, and the path without its leading slash */
+static int fota_split_uri( char * uri,
+                           const char ** host,
+                           const char ** file,
+                           int * sec_tag )
+{
+    char * scheme_end = strstr( uri, "://" );
+    size_t scheme_len;
+    char * path;
+
+    if( scheme_end == NULL )
+    {
+        return -EINVAL;
+    }
+
+    scheme_len = scheme_end - uri;
+
+    if( ( scheme_len == 4 ) && ( ( strncmp( uri, "coap", 4 ) == 0 ) || ( strncmp( uri, "http", 4 ) == 0 ) ) )
+    {
+        *sec_tag = -1;
+    }
+    else if( ( scheme_len == 5 ) && ( ( strncmp( uri, "coaps", 5 ) == 0 ) || ( strncmp( uri, "https", 5 ) == 0 ) ) )
+    {
+        if( CONFIG_APP_LWM2M_FOTA_SEC_TAG < 0 )
+        {
+            return -EPROTONOSUPPORT;
+        }
+
+        *sec_tag = CONFIG_APP_LWM2M_FOTA_SEC_TAG;
+    }
+    else
+    {
+        return -EPROTONOSUPPORT;
+    }
+
+    path = strchr( scheme_end + 3, '/' );
+
+    if( ( path == NULL ) || ( path[ 1 ] == '\0' ) )
+    {
+        return -EINVAL;
+    }
+
+    /* Terminates the host part in place */
+    *path = '\0';
+    *host = uri;
+    *file = path + 1;
+
+    return 0;
+}
+
+static void fota_start_work_handler( struct k_work * work )
+{
+    static char uri[ sizeof( package_uri ) ];
+    const char * host;
+    const char * file;
+    int sec_tag;
+    int err;
+
+    ARG_UNUSED( work );
+
+    strcpy( uri, package_uri );
+    err = fota_split_uri( uri, &host, &file, &sec_tag );
+
+    if( err == 0 )
+    {
+        last_progress = 0;
+        last_progress_ms = k_uptime_get();
+        download_start_ms = last_progress_ms;
+        err = fota_download_start( host, file, sec_tag, 0, 0 );
+    }
+
+    if( err )
+    {
+        LOG_ERR( "Firmware download from %s not started (%d)", package_uri, err );
+        fota_set_state( FOTA_STATE_IDLE,
+                        ( err == -EPROTONOSUPPORT ) ? FOTA_RESULT_UNSUPPORTED_PROTO :
+                        ( err == -EINVAL ) ? FOTA_RESULT_INVALID_URI : FOTA_RESULT_CONNECTION_LOST );
+        return;
+    }
+
+    LOG_INF( "Firmware download started from %s", package_uri );
+}
+
+static void fota_progress( int progress )
+{
+    int64_t now = k_uptime_get();
+
+    /* Object 5 has no progress resource, so progress only goes to the log */
+    if( ( progress < 100 ) &&
+        ( ( progress < ( last_progress + CONFIG_APP_LWM2M_FOTA_PROGRESS_STEP ) ) ||
+          ( ( now - last_progress_ms ) < ( CONFIG_APP_LWM2M_FOTA_PROGRESS_INTERVAL_S * MSEC_PER_SEC ) ) ) )
+    {
+        return;
+    }
+
+    last_progress = progress;
+    last_progress_ms = now;
+    LOG_INF( "Firmware download %d%% after %u s", progress,
+             ( uint32_t ) ( ( now - download_start_ms ) / MSEC_PER_SEC ) );
+}
+
+static void fota_download_handler( const struct fota_download_evt * evt )
+{
+    switch( evt->id )
+    {
+        case CUSTOM_FOTA_DOWNLOAD_EVT_PROGRESS:
+            fota_progress( evt->progress );
+            break;
+
+        case CUSTOM_FOTA_DOWNLOAD_EVT_ERASE_PENDING:
+            LOG_INF( "Waiting for the DFU target to be erased" );
+            break;
+
+        case CUSTOM_FOTA_DOWNLOAD_EVT_FINISHED:
+            LOG_INF( "Firmware downloaded in %u ms",
+                     ( uint32_t ) ( k_uptime_get() - download_start_ms ) );
+            fota_set_state( FOTA_STATE_DOWNLOADED, FOTA_RESULT_DEFAULT );
+            break;
+
+        case CUSTOM_FOTA_DOWNLOAD_EVT_ERROR:
+            LOG_ERR( "Firmware download failed (cause %d)", evt->cause );
+
+            switch( evt->cause )
+            {
+                case CUSTOM_FOTA_DOWNLOAD_ERROR_CAUSE_INVALID_UPDATE:
+                    fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_INTEGRITY_FAILED );
+                    break;
+
+                case CUSTOM_FOTA_DOWNLOAD_ERROR_CAUSE_TYPE_MISMATCH:
+                    fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_UNSUPPORTED_TYPE );
+                    break;
+
+                case CUSTOM_FOTA_DOWNLOAD_ERROR_CAUSE_INTERNAL:
+                    fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_UPDATE_FAILED );
+                    break;
+
+                default:
+                    fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_CONNECTION_LOST );
+                    break;
+            }
+
+            break;
+
+        case CUSTOM_FOTA_DOWNLOAD_EVT_CANCELLED:
+            LOG_INF( "Firmware download cancelled" );
+            fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_DEFAULT );
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int fota_package_uri_cb( uint16_t obj_inst_id,
+                                uint16_t res_id,
+                                uint16_t res_inst_id,
+                                uint8_t * data,
+                                uint16_t data_len,
+                                bool last_block,
+                                size_t total_size,
+                                size_t offset )
+{
+    uint8_t state = fota_get_state();
+    size_t len = strnlen( ( const char * ) data, MIN( data_len, sizeof( package_uri ) - 1 ) );
+
+    ARG_UNUSED( res_id );
+    ARG_UNUSED( res_inst_id );
+    ARG_UNUSED( total_size );
+
+    lwm2m_adaptive_lifetime_downlink();
+
+    if( ( obj_inst_id != 0 ) || !last_block || ( offset != 0 ) )
+    {
+        return -EINVAL;
+    }
+
+    if( len == 0 )
+    {
+        /* An empty URI cancels the download or discards the downloaded image */
+        if( state == FOTA_STATE_DOWNLOADING )
+        {
+            fota_download_cancel();
+        }
+        else
+        {
+            if( state == FOTA_STATE_DOWNLOADED )
+            {
+                /* The download library finished the target, it is not scheduled yet */
+                int err = dfu_target_reset();
+
+                if( err )
+                {
+                    LOG_ERR( "Unable to discard the downloaded image (%d)", err );
+                }
+            }
+
+            fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_DEFAULT );
+        }
+
+        return 0;
+    }
+
+    if( state != FOTA_STATE_IDLE )
+    {
+        LOG_WRN( "Package URI ignored in state %u", state );
+        return -EPERM;
+    }
+
+    memcpy( package_uri, data, len );
+    package_uri[ len ] = '\0';
+    fota_set_state( FOTA_STATE_DOWNLOADING, FOTA_RESULT_DEFAULT );
+
+    /* Connecting the download client blocks, not in the engine thread */
+    k_work_submit( &fota_start_work );
+
+    return 0;
+}
+
+static void fota_reboot_work_handler( struct k_work * work )
+{
+    static bool deregistered;
+
+    ARG_UNUSED( work );
+
+    if( !deregistered )
+    {
+        /* Reboot once the de-register is out */
+        deregistered = true;
+        lwm2m_rd_client_stop( client_ctx, NULL, true );
+        k_work_schedule( &fota_reboot_work, K_SECONDS( FOTA_REBOOT_DELAY_S ) );
+        return;
+    }
+
+    #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    lwm2m_settings_wb_flush();
+    #endif
+
+    LOG_INF( "Rebooting into the new firmware" );
+    LOG_PANIC();
+    sys_reboot( SYS_REBOOT_COLD );
+}
+
+static int fota_update_cb( uint16_t obj_inst_id,
+                           uint8_t * args,
+                           uint16_t args_len )
+{
+    int err;
+
+    ARG_UNUSED( obj_inst_id );
+    ARG_UNUSED( args );
+    ARG_UNUSED( args_len );
+
+    lwm2m_adaptive_lifetime_downlink();
+
+    /* Marks the image for the bootloader, it is swapped in on the reboot */
+    err = dfu_target_schedule_update( 0 );
+
+    if( err )
+    {
+        LOG_ERR( "Unable to schedule the firmware update (%d)", err );
+        fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_UPDATE_FAILED );
+        return err;
+    }
+
+    LOG_INF( "Firmware update %u ms after the download started",
+             ( uint32_t ) ( k_uptime_get() - download_start_ms ) );
+
+    /* Lets the execute response leave before the de-register */
+    k_work_schedule( &fota_reboot_work, K_SECONDS( 1 ) );
+
+    return 0;
+}
+
+int lwm2m_fota_init( struct lwm2m_ctx * ctx )
+{
+    int ret;
+
+    client_ctx = ctx;
+
+    ret = custom_fota_download_init( fota_download_handler );
+
+    if( ret )
+    {
+        LOG_ERR( "Unable to init the FOTA download library (%d)", ret );
+        return ret;
+    }
+
+    lwm2m_set_u8( &LWM2M_OBJ( LWM2M_OBJECT_FIRMWARE_ID, 0, FIRMWARE_DELIVERY_METHOD_RID ),
+                  FOTA_DELIVERY_PULL_ONLY );
+    lwm2m_register_post_write_callback( &LWM2M_OBJ( LWM2M_OBJECT_FIRMWARE_ID, 0, FIRMWARE_PACKAGE_URI_RID ),
+                                        fota_package_uri_cb );
+    lwm2m_firmware_set_update_cb( fota_update_cb );
+
+    #if defined( CONFIG_BOOTLOADER_MCUBOOT )
+    if( !boot_is_img_confirmed() )
+    {
+        ret = boot_write_img_confirmed();
+
+        if( ret )
+        {
+            LOG_ERR( "Unable to confirm the new firmware (%d)", ret );
+            fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_UPDATE_FAILED );
+            return ret;
+        }
+
+        LOG_INF( "Running the new firmware, image confirmed" );
+        fota_set_state( FOTA_STATE_IDLE, FOTA_RESULT_SUCCESS );
+    }
+    #endif /* if defined( CONFIG_BOOTLOADER_MCUBOOT ) */
+
+    return 0;
+}
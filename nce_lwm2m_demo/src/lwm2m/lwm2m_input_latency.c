@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/sys/util.h>
+
+#include "lwm2m_input_latency.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+/* Bucket 0 holds latencies below 1 ms, bucket N [2^(N-1), 2^N) ms and the last one the rest */
+#define LATENCY_BUCKETS        18
+
+/* Two push buttons and two on/off switches */
+#define LATENCY_INPUTS         4
+
+#define LATENCY_LINE_LEN       160
+
+struct latency_input
+{
+    uint16_t obj_id;
+    uint16_t obj_inst_id;
+    int64_t edge_ms;    /* 0 while no edge waits for a notification */
+};
+
+static struct latency_input inputs[ LATENCY_INPUTS ];
+static uint32_t buckets[ LATENCY_BUCKETS ];
+static uint32_t count;
+static uint32_t max_ms;
+
+static struct k_spinlock lock;
+
+void lwm2m_input_latency_edge( uint16_t obj_id,
+                               uint16_t obj_inst_id,
+                               int64_t edge_ms )
+{
+    struct latency_input * free_input = NULL;
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    for(size_t i = 0; i < ARRAY_SIZE( inputs ); i++)
+    {
+        if( inputs[ i ].edge_ms == 0 )
+        {
+            free_input = free_input ? free_input : &inputs[ i ];
+        }
+        else if( ( inputs[ i ].obj_id == obj_id ) && ( inputs[ i ].obj_inst_id == obj_inst_id ) )
+        {
+            /* The first unnotified edge is the oldest change */
+            free_input = NULL;
+            break;
+        }
+    }
+
+    if( free_input != NULL )
+    {
+        free_input->obj_id = obj_id;
+        free_input->obj_inst_id = obj_inst_id;
+        free_input->edge_ms = MAX( edge_ms, 1 );
+    }
+
+    k_spin_unlock( &lock, key );
+}
+
+static void latency_log( uint32_t latency_ms )
+{
+    char line[ LATENCY_LINE_LEN ];
+    size_t len = 0;
+
+    line[ 0 ] = '\0';
+
+    for(size_t i = 0; i < ARRAY_SIZE( buckets ); i++)
+    {
+        if( buckets[ i ] == 0 )
+        {
+            continue;
+        }
+
+        len += snprintk( &line[ len ], sizeof( line ) - len, " %s%u:%u",
+                         ( i == ARRAY_SIZE( buckets ) - 1 ) ? ">=" : "<",
+                         ( uint32_t ) BIT( MIN( i, ARRAY_SIZE( buckets ) - 2 ) ),
+                         buckets[ i ] );
+
+        if( len >= sizeof( line ) )
+        {
+            break;
+        }
+    }
+
+    LOG_INF( "Input to notification %u ms, %u samples, max %u ms, ms buckets:%s",
+             latency_ms, count, max_ms, line );
+}
+
+void lwm2m_input_latency_notified( const struct lwm2m_obj_path * path )
+{
+    int64_t now = k_uptime_get();
+
+    if( path == NULL )
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < ARRAY_SIZE( inputs ); i++)
+    {
+        k_spinlock_key_t key = k_spin_lock( &lock );
+        struct latency_input * input = &inputs[ i ];
+        uint32_t latency_ms;
+        size_t bucket;
+
+        if( ( input->edge_ms == 0 ) || ( input->obj_id != path->obj_id ) ||
+            ( ( path->level >= LWM2M_PATH_LEVEL_OBJECT_INST ) && ( input->obj_inst_id != path->obj_inst_id ) ) )
+        {
+            k_spin_unlock( &lock, key );
+            continue;
+        }
+
+        latency_ms = ( uint32_t ) MAX( now - input->edge_ms, 0 );
+        input->edge_ms = 0;
+        bucket = ( latency_ms == 0 ) ? 0 : MIN( ( size_t ) LOG2( latency_ms ) + 1, ARRAY_SIZE( buckets ) - 1 );
+        buckets[ bucket ]++;
+        count++;
+        max_ms = MAX( max_ms, latency_ms );
+        k_spin_unlock( &lock, key );
+
+        latency_log( latency_ms );
+    }
+}
@@ -8,8 +8,11 @@
 #include <zephyr/net/lwm2m.h>
 #include <lwm2m_resource_ids.h>
 #include <stdlib.h>
+#include <string.h>
 #include "lwm2m_engine.h"
 #include "lwm2m_app_utils.h"
+#include "lwm2m_notify_coalesce.h"
+#include "lwm2m_adaptive_lifetime.h"
 #include "ui_led.h"
 
 #include <zephyr/logging/log.h>
@@ -36,85 +39,203 @@ LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
 
 #define BRIGHTNESS_MAX    100U
 
-static bool state[ NUM_LEDS ];
-static uint8_t brightness_val[ NUM_LEDS ];
-static uint8_t colour_val[ NUM_LEDS ];
+/* State requested by the server, written by the engine callbacks */
+struct led_target
+{
+    bool on;
+    uint8_t colour;
+    uint8_t brightness;
+};
+
+static struct led_target target[ NUM_LEDS ];
+static char colour_str[ RGBIR_STR_LENGTH ];
+static bool colour_pending;
+static struct k_spinlock target_lock;
+
+/* State last written to the LED driver, work item only */
+static bool applied_on[ NUM_LEDS ];
+static uint8_t applied_level[ NUM_LEDS ];
+static bool applied_valid[ NUM_LEDS ];
+
+static struct lwm2m_cb_timing write_timing = LWM2M_CB_TIMING_INIT( "light control write" );
+
+static void light_apply_work_handler( struct k_work * work );
+
+static K_WORK_DEFINE( light_apply_work, light_apply_work_handler );
 
 static void reset_on_time( uint16_t obj_inst_id )
 {
-    lwm2m_set_s32( &LWM2M_OBJ( IPSO_OBJECT_LIGHT_CONTROL_ID, obj_inst_id, ON_TIME_RID ), 0 );
+    lwm2m_coalesce_set_s32( &LWM2M_OBJ( IPSO_OBJECT_LIGHT_CONTROL_ID, obj_inst_id, ON_TIME_RID ), 0 );
 }
 
-static int rgb_lc_on_off_cb( uint16_t obj_inst_id,
-                             uint16_t res_id,
-                             uint16_t res_inst_id,
-                             uint8_t * data,
-                             uint16_t data_len,
-                             bool last_block,
-                             size_t total_size,
-                             size_t offset )
+static uint8_t calculate_intensity( uint8_t colour_value,
+                                    uint8_t brightness_value )
 {
-    int ret = 0;
-    bool new_state = *( bool * ) data;
+    uint32_t numerator = ( uint32_t ) colour_value * brightness_value;
+    uint32_t denominator = BRIGHTNESS_MAX;
 
-    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
+    return ( uint8_t ) ( numerator / denominator );
+}
+
+/* Write the LEDs whose target differs from what the driver last got */
+static void light_apply_work_handler( struct k_work * work )
+{
+    struct led_target snapshot[ NUM_LEDS ];
+    char colour_copy[ RGBIR_STR_LENGTH ];
+    bool parse_colour;
+    k_spinlock_key_t key;
+    int changed = 0;
+    int ret;
+
+    key = k_spin_lock( &target_lock );
+    parse_colour = colour_pending;
+    colour_pending = false;
+    memcpy( colour_copy, colour_str, sizeof( colour_copy ) );
+    k_spin_unlock( &target_lock, key );
+
+    if( parse_colour )
     {
-        /* Reset on-time if transition from off to on */
-        if( ( state[ 0 ] == false ) && ( new_state == true ) )
+        uint32_t colour_values = strtoul( colour_copy, NULL, 0 );
+
+        key = k_spin_lock( &target_lock );
+
+        for(int i = 0; i < NUM_LEDS; ++i)
         {
-            reset_on_time( obj_inst_id );
+            target[ i ].colour = ( uint8_t ) ( colour_values >> 8 * ( 2 - i ) );
         }
 
-        for(int i = 0; i < NUM_LEDS; ++i)
+        k_spin_unlock( &target_lock, key );
+    }
+
+    key = k_spin_lock( &target_lock );
+    memcpy( snapshot, target, sizeof( snapshot ) );
+    k_spin_unlock( &target_lock, key );
+
+    for(int i = 0; i < NUM_LEDS; ++i)
+    {
+        uint8_t level;
+
+        if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
         {
-            state[ i ] = new_state;
-            ret = ui_led_pwm_on_off( i, new_state );
+            level = calculate_intensity( snapshot[ i ].colour, snapshot[ i ].brightness );
 
-            if( ret )
+            if( !applied_valid[ i ] || ( applied_level[ i ] != level ) )
             {
-                LOG_ERR( "Set PWM LED %d on/off failed (%d)", i, ret );
-                continue;
+                ret = ui_led_pwm_set_intensity( i, level );
+
+                if( ret )
+                {
+                    LOG_ERR( "Set PWM LED %d intensity failed (%d)", i, ret );
+                    continue;
+                }
+
+                changed++;
             }
 
-            LOG_INF( "Set PWM LED %d on/off success", i );
-        }
-    }
-    else if( IS_ENABLED( CONFIG_UI_LED_USE_GPIO ) )
-    {
-        /* Reset on-time if transition from off to on */
-        if( ( state[ 0 ] == false ) && ( new_state == true ) )
-        {
-            reset_on_time( obj_inst_id );
-        }
+            if( !applied_valid[ i ] || ( applied_on[ i ] != snapshot[ i ].on ) )
+            {
+                ret = ui_led_pwm_on_off( i, snapshot[ i ].on );
 
-        for(int i = 0; i < NUM_LEDS; ++i)
+                if( ret )
+                {
+                    LOG_ERR( "Set PWM LED %d on/off failed (%d)", i, ret );
+                    continue;
+                }
+
+                changed++;
+            }
+        }
+        else if( IS_ENABLED( CONFIG_UI_LED_USE_GPIO ) )
         {
-            state[ i ] = new_state;
-            ret = ui_led_gpio_on_off( i, state[ i ] && ( bool ) colour_val[ i ] );
+            level = snapshot[ i ].colour;
 
-            if( ret )
+            if( !applied_valid[ i ] || ( applied_on[ i ] != snapshot[ i ].on ) ||
+                ( ( bool ) applied_level[ i ] != ( bool ) level ) )
             {
-                LOG_ERR( "Set GPIO LED %d on/off failed (%d)", i, ret );
-                continue;
-            }
+                ret = ui_led_gpio_on_off( i, snapshot[ i ].on && ( bool ) level );
+
+                if( ret )
+                {
+                    LOG_ERR( "Set GPIO LED %d failed (%d)", i, ret );
+                    continue;
+                }
 
-            LOG_INF( "Set GPIO LED %d on/off success", i );
+                changed++;
+            }
+        }
+        else
+        {
+            continue;
         }
+
+        applied_on[ i ] = snapshot[ i ].on;
+        applied_level[ i ] = level;
+        applied_valid[ i ] = true;
     }
 
-    return ret;
+    if( changed )
+    {
+        LOG_INF( "Light control applied, %d LED writes", changed );
+    }
 }
 
-static uint8_t calculate_intensity( uint8_t colour_value,
-                                    uint8_t brightness_value )
+static void light_apply_request( void )
 {
-    uint32_t numerator = ( uint32_t ) colour_value * brightness_value;
-    uint32_t denominator = BRIGHTNESS_MAX;
+    if( IS_ENABLED( CONFIG_APP_LIGHT_CONTROL_DEFERRED_APPLY ) )
+    {
+        k_work_submit( &light_apply_work );
+    }
+    else
+    {
+        light_apply_work_handler( &light_apply_work );
+    }
+}
 
-    return ( uint8_t ) ( numerator / denominator );
+/* Record the on/off target of the LEDs in [first, last], false if nothing changed */
+static bool light_set_on( uint16_t obj_inst_id,
+                          int first,
+                          int last,
+                          bool new_state )
+{
+    k_spinlock_key_t key = k_spin_lock( &target_lock );
+    bool was_on = target[ first ].on;
+
+    for(int i = first; i <= last; ++i)
+    {
+        target[ i ].on = new_state;
+    }
+
+    k_spin_unlock( &target_lock, key );
+
+    /* Reset on-time if transition from off to on */
+    if( !was_on && new_state )
+    {
+        reset_on_time( obj_inst_id );
+    }
+
+    return was_on != new_state;
 }
 
-static int rgb_lc_colour_cb( uint16_t obj_inst_id,
+/* Record the brightness target of the LEDs in [first, last], false if nothing changed */
+static bool light_set_brightness( int first,
+                                  int last,
+                                  uint8_t new_brightness )
+{
+    k_spinlock_key_t key = k_spin_lock( &target_lock );
+    bool changed = false;
+
+    for(int i = first; i <= last; ++i)
+    {
+        changed = changed || ( target[ i ].brightness != new_brightness );
+        target[ i ].brightness = new_brightness;
+    }
+
+    k_spin_unlock( &target_lock, key );
+
+    return changed;
+}
+
+static int rgb_lc_on_off_cb( uint16_t obj_inst_id,
                              uint16_t res_id,
                              uint16_t res_inst_id,
                              uint8_t * data,
@@ -123,46 +244,56 @@ static int rgb_lc_colour_cb( uint16_t obj_inst_id,
                              size_t total_size,
                              size_t offset )
 {
-    int ret = 0;
-    uint32_t colour_values = strtoul( data, NULL, 0 );
+    uint32_t start = k_cycle_get_32();
 
-    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
+    if( light_set_on( obj_inst_id, 0, NUM_LEDS - 1, *( bool * ) data ) )
     {
-        uint8_t intensity;
+        light_apply_request();
+    }
 
-        for(int i = 0; i < NUM_LEDS; ++i)
-        {
-            colour_val[ i ] = ( uint8_t ) ( colour_values >> 8 * ( 2 - i ) );
-            intensity = calculate_intensity( colour_val[ i ], brightness_val[ i ] );
-            ret = ui_led_pwm_set_intensity( i, intensity );
+    lwm2m_adaptive_lifetime_downlink();
+    lwm2m_cb_timing_record( &write_timing, res_id, start );
 
-            if( ret )
-            {
-                LOG_ERR( "Set PWM LED %d intensity failed (%d)", i, ret );
-                continue;
-            }
+    return 0;
+}
 
-            LOG_INF( "Set PWM LED %d intensity success", i );
-        }
-    }
-    else if( IS_ENABLED( CONFIG_UI_LED_USE_GPIO ) )
+static int rgb_lc_colour_cb( uint16_t obj_inst_id,
+                             uint16_t res_id,
+                             uint16_t res_inst_id,
+                             uint8_t * data,
+                             uint16_t data_len,
+                             bool last_block,
+                             size_t total_size,
+                             size_t offset )
+{
+    uint32_t start = k_cycle_get_32();
+    char new_colour[ RGBIR_STR_LENGTH ] = { 0 };
+    k_spinlock_key_t key;
+    bool changed;
+
+    memcpy( new_colour, data, MIN( data_len, sizeof( new_colour ) - 1 ) );
+
+    /* Parsed on the work item, the callback only keeps the string */
+    key = k_spin_lock( &target_lock );
+    changed = strcmp( new_colour, colour_str ) != 0;
+
+    if( changed )
     {
-        for(int i = 0; i < NUM_LEDS; ++i)
-        {
-            colour_val[ i ] = ( uint8_t ) ( colour_values >> 8 * ( 2 - i ) );
-            ret = ui_led_gpio_on_off( i, state[ i ] && ( bool ) colour_val[ i ] );
+        memcpy( colour_str, new_colour, sizeof( colour_str ) );
+        colour_pending = true;
+    }
 
-            if( ret )
-            {
-                LOG_ERR( "Set GPIO LED %d failed (%d)", i, ret );
-                continue;
-            }
+    k_spin_unlock( &target_lock, key );
 
-            LOG_INF( "Set GPIO LED %d intensity success", i );
-        }
+    if( changed )
+    {
+        light_apply_request();
     }
 
-    return ret;
+    lwm2m_adaptive_lifetime_downlink();
+    lwm2m_cb_timing_record( &write_timing, res_id, start );
+
+    return 0;
 }
 
 static int rgb_lc_dimmer_cb( uint16_t obj_inst_id,
@@ -174,29 +305,17 @@ static int rgb_lc_dimmer_cb( uint16_t obj_inst_id,
                              size_t total_size,
                              size_t offset )
 {
-    int ret = 0;
-    uint8_t new_brightness = *data;
-    uint8_t intensity;
+    uint32_t start = k_cycle_get_32();
 
-    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
+    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) && light_set_brightness( 0, NUM_LEDS - 1, *data ) )
     {
-        for(int i = 0; i < NUM_LEDS; ++i)
-        {
-            brightness_val[ i ] = new_brightness;
-            intensity = calculate_intensity( colour_val[ i ], brightness_val[ i ] );
-            ret = ui_led_pwm_set_intensity( i, intensity );
-
-            if( ret )
-            {
-                LOG_ERR( "Set PWM LED %d intensity failed (%d)", i, ret );
-                continue;
-            }
-
-            LOG_INF( "Set PWM LED %d intensity success", i );
-        }
+        light_apply_request();
     }
 
-    return ret;
+    lwm2m_adaptive_lifetime_downlink();
+    lwm2m_cb_timing_record( &write_timing, res_id, start );
+
+    return 0;
 }
 
 static int lc_on_off_cb( uint16_t obj_inst_id,
@@ -208,49 +327,17 @@ static int lc_on_off_cb( uint16_t obj_inst_id,
                          size_t total_size,
                          size_t offset )
 {
-    int ret = 0;
-    bool new_state = *( bool * ) data;
+    uint32_t start = k_cycle_get_32();
 
-    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
+    if( light_set_on( obj_inst_id, obj_inst_id, obj_inst_id, *( bool * ) data ) )
     {
-        /* Reset on-time if transition from off to on */
-        if( ( state[ 0 ] == false ) && ( new_state == true ) )
-        {
-            reset_on_time( obj_inst_id );
-        }
-
-        state[ obj_inst_id ] = new_state;
-        ret = ui_led_pwm_on_off( obj_inst_id, new_state );
-
-        if( ret )
-        {
-            LOG_ERR( "Set PWM LED %u on/off failed (%d)", obj_inst_id, ret );
-            return ret;
-        }
-
-        LOG_INF( "Set PWM LED %u on/off success", obj_inst_id );
+        light_apply_request();
     }
-    else if( IS_ENABLED( CONFIG_UI_LED_USE_GPIO ) )
-    {
-        /* Reset on-time if transition from off to on */
-        if( ( state[ 0 ] == false ) && ( new_state == true ) )
-        {
-            reset_on_time( obj_inst_id );
-        }
-
-        state[ obj_inst_id ] = new_state;
-        ret = ui_led_gpio_on_off( obj_inst_id, new_state );
-
-        if( ret )
-        {
-            LOG_ERR( "Set GPIO LED %u on/off failed (%d)", obj_inst_id, ret );
-            return ret;
-        }
 
-        LOG_INF( "Set PWM LED %u on/off success", obj_inst_id );
-    }
+    lwm2m_adaptive_lifetime_downlink();
+    lwm2m_cb_timing_record( &write_timing, res_id, start );
 
-    return ret;
+    return 0;
 }
 
 static int lc_dimmer_cb( uint16_t obj_inst_id,
@@ -262,54 +349,43 @@ static int lc_dimmer_cb( uint16_t obj_inst_id,
                          size_t total_size,
                          size_t offset )
 {
-    int ret;
-    uint8_t new_brightness = *data;
-    uint8_t intensity;
+    uint32_t start = k_cycle_get_32();
 
-    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
+    if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) && light_set_brightness( obj_inst_id, obj_inst_id, *data ) )
     {
-        brightness_val[ obj_inst_id ] = new_brightness;
-        intensity = calculate_intensity( UINT8_MAX, brightness_val[ obj_inst_id ] );
-        ret = ui_led_pwm_set_intensity( obj_inst_id, intensity );
-
-        if( ret )
-        {
-            LOG_ERR( "Set PWM LED %u intensity failed (%d)", obj_inst_id, ret );
-            return ret;
-        }
-
-        LOG_INF( "Set PWM LED %u intensity success", obj_inst_id );
+        light_apply_request();
     }
 
+    lwm2m_adaptive_lifetime_downlink();
+    lwm2m_cb_timing_record( &write_timing, res_id, start );
+
     return 0;
 }
 
 static int lwm2m_init_light_control( void )
 {
     int ret = 0;
-    uint8_t intensity;
-    char colour_str[ RGBIR_STR_LENGTH ];
+    char colour_init[ RGBIR_STR_LENGTH ];
+
+    for(int i = 0; i < NUM_LEDS; ++i)
+    {
+        target[ i ].colour = UINT8_MAX;
+        target[ i ].brightness = BRIGHTNESS_MAX;
+    }
 
     if( IS_ENABLED( CONFIG_UI_LED_USE_PWM ) )
     {
         ui_led_pwm_init();
-
-        for(int i = 0; i < NUM_LEDS; ++i)
-        {
-            colour_val[ i ] = UINT8_MAX;
-            brightness_val[ i ] = BRIGHTNESS_MAX;
-            intensity = calculate_intensity( colour_val[ i ], brightness_val[ i ] );
-            ui_led_pwm_set_intensity( i, intensity );
-        }
-
-        snprintk( colour_str, RGBIR_STR_LENGTH, "0xFFFFFF" );
+        snprintk( colour_init, RGBIR_STR_LENGTH, "0xFFFFFF" );
     }
     else if( IS_ENABLED( CONFIG_UI_LED_USE_GPIO ) )
     {
         ui_led_gpio_init();
-        snprintk( colour_str, RGBIR_STR_LENGTH, "0x010101" );
+        snprintk( colour_init, RGBIR_STR_LENGTH, "0x010101" );
     }
 
+    light_apply_request();
+
     if( IS_ENABLED( CONFIG_BOARD_THINGY91_NRF9160_NS ) ||
         IS_ENABLED( CONFIG_BOARD_THINGY91X_NRF9151_NS ) )
     {
@@ -325,7 +401,7 @@ static int lwm2m_init_light_control( void )
             &LWM2M_OBJ( IPSO_OBJECT_LIGHT_CONTROL_ID, 0, APPLICATION_TYPE_RID ),
             APP_TYPE, sizeof( APP_TYPE ), sizeof( APP_TYPE ), LWM2M_RES_DATA_FLAG_RO );
         lwm2m_set_string( &LWM2M_OBJ( IPSO_OBJECT_LIGHT_CONTROL_ID, 0, COLOUR_RID ),
-                          colour_str );
+                          colour_init );
         lwm2m_set_u8( &LWM2M_OBJ( IPSO_OBJECT_LIGHT_CONTROL_ID, 0, DIMMER_RID ),
                       BRIGHTNESS_MAX );
     }
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <modem/lte_lc.h>
+#include <net/lwm2m_client_utils.h>
+
+#include "lwm2m_ncell_sched.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+#define SECONDS_PER_DAY    ( 24U * 60U * 60U )
+
+/* Written by the LTE event handler only */
+static uint32_t interval_s = CONFIG_APP_NEIGHBOUR_CELL_SCAN_INTERVAL;
+static uint32_t serving_cell_id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+static int16_t serving_rsrp = LTE_LC_CELL_RSRP_INVALID;
+static uint32_t meas_today;
+static int64_t day_start_ms;
+
+static atomic_t rrc_connected;
+static atomic_t scan_waiting;
+
+static void ncell_sched_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( ncell_sched_work, ncell_sched_work_handler );
+
+static void ncell_sched_work_handler( struct k_work * work )
+{
+    /* Wait for the next RRC connection unless the radio is up or the wait already ran out */
+    if( !atomic_get( &rrc_connected ) && !atomic_get( &scan_waiting ) &&
+        ( CONFIG_APP_NEIGHBOUR_CELL_SCAN_RRC_WAIT > 0 ) )
+    {
+        atomic_set( &scan_waiting, 1 );
+        k_work_schedule( &ncell_sched_work, K_SECONDS( CONFIG_APP_NEIGHBOUR_CELL_SCAN_RRC_WAIT ) );
+        return;
+    }
+
+    atomic_clear( &scan_waiting );
+
+    /* The client utils start the scan once the RRC connection is released */
+    lwm2m_ncell_schedule_measurement();
+
+    /* Fallback if no result arrives, a result reschedules from its own time */
+    k_work_schedule( &ncell_sched_work, K_SECONDS( interval_s ) );
+}
+
+static void ncell_sched_count( void )
+{
+    int64_t now = k_uptime_get();
+
+    if( ( now - day_start_ms ) >= ( int64_t ) SECONDS_PER_DAY * MSEC_PER_SEC )
+    {
+        LOG_INF( "Neighbour cell measurements in the last 24 h: %u", meas_today );
+        meas_today = 0;
+        day_start_ms = now;
+    }
+
+    meas_today++;
+}
+
+static void ncell_sched_meas_result( const struct lte_lc_cells_info * cells )
+{
+    const struct lte_lc_cell * cell = &cells->current_cell;
+    bool stable;
+
+    if( cell->id == LTE_LC_CELL_EUTRAN_ID_INVALID )
+    {
+        return;
+    }
+
+    ncell_sched_count();
+
+    stable = ( cell->id == serving_cell_id ) &&
+             ( cell->rsrp != LTE_LC_CELL_RSRP_INVALID ) &&
+             ( serving_rsrp != LTE_LC_CELL_RSRP_INVALID ) &&
+             ( abs( cell->rsrp - serving_rsrp ) < CONFIG_APP_NEIGHBOUR_CELL_RSRP_DELTA );
+
+    interval_s = stable ? MIN( interval_s * 2, CONFIG_APP_NEIGHBOUR_CELL_SCAN_MAX_INTERVAL ) :
+                 CONFIG_APP_NEIGHBOUR_CELL_SCAN_INTERVAL;
+    serving_cell_id = cell->id;
+    serving_rsrp = cell->rsrp;
+
+    LOG_INF( "Neighbour cells: %u found, cell %s, next scan in %u s, %u scans today",
+             cells->ncells_count, stable ? "stable" : "changed", interval_s, meas_today );
+
+    k_work_reschedule( &ncell_sched_work, K_SECONDS( interval_s ) );
+}
+
+static void ncell_sched_lte_handler( const struct lte_lc_evt *const evt )
+{
+    switch( evt->type )
+    {
+        case LTE_LC_EVT_RRC_UPDATE:
+            atomic_set( &rrc_connected, evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED );
+
+            if( ( evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ) && atomic_get( &scan_waiting ) )
+            {
+                k_work_reschedule( &ncell_sched_work, K_NO_WAIT );
+            }
+
+            break;
+
+        case LTE_LC_EVT_CELL_UPDATE:
+
+            if( ( serving_cell_id != LTE_LC_CELL_EUTRAN_ID_INVALID ) && ( evt->cell.id != serving_cell_id ) )
+            {
+                LOG_DBG( "Serving cell changed, back to the fast scan interval" );
+                interval_s = CONFIG_APP_NEIGHBOUR_CELL_SCAN_INTERVAL;
+                k_work_reschedule( &ncell_sched_work, K_NO_WAIT );
+            }
+
+            break;
+
+        case LTE_LC_EVT_NEIGHBOR_CELL_MEAS:
+            ncell_sched_meas_result( &evt->cells_info );
+            break;
+
+        default:
+            break;
+    }
+}
+
+int lwm2m_ncell_sched_init( void )
+{
+    day_start_ms = k_uptime_get();
+    lte_lc_register_handler( ncell_sched_lte_handler );
+
+    /* First scan right away, the radio is attaching anyway */
+    atomic_set( &scan_waiting, 1 );
+    k_work_schedule( &ncell_sched_work, K_SECONDS( 1 ) );
+
+    return 0;
+}
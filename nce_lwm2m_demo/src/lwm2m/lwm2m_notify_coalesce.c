@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#include "lwm2m_notify_coalesce.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+/* A value held back longer than pmax would reach the server a period late */
+BUILD_ASSERT( CONFIG_APP_LWM2M_NOTIFY_COALESCE_WINDOW_MS < CONFIG_LWM2M_SERVER_DEFAULT_PMAX * MSEC_PER_SEC,
+              "Notification window must be shorter than the default pmax" );
+
+enum coalesce_type
+{
+    COALESCE_BOOL,
+    COALESCE_S32,
+    COALESCE_TIME,
+};
+
+struct coalesce_entry
+{
+    struct lwm2m_obj_path path;
+    enum coalesce_type type;
+    union
+    {
+        bool b;
+        int32_t s32;
+        time_t time;
+    } value;
+    uint32_t rising; /* Boolean false to true transitions in the window */
+};
+
+static struct coalesce_entry entries[ CONFIG_APP_LWM2M_NOTIFY_COALESCE_ENTRIES ];
+static size_t entry_count;
+static uint32_t window_changes;
+
+/* Objects with staged resources, whose notifications are counted */
+static uint16_t objects[ CONFIG_APP_LWM2M_NOTIFY_COALESCE_ENTRIES ];
+static size_t object_count;
+
+/* Counters since boot */
+static uint32_t total_changes;
+static uint32_t total_notifications;
+
+static K_MUTEX_DEFINE( coalesce_lock );
+
+static void coalesce_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( coalesce_work, coalesce_work_handler );
+
+static int coalesce_apply( const struct coalesce_entry * entry )
+{
+    switch( entry->type )
+    {
+        case COALESCE_BOOL:
+        {
+            /* The last rising edge is the final write itself if the value ends true */
+            uint32_t pulses = entry->rising - ( ( entry->value.b && ( entry->rising > 0 ) ) ? 1 : 0 );
+
+            /* Let the object see every rising edge, e.g. the push button counter */
+            for(uint32_t i = 0; i < pulses; i++)
+            {
+                int ret = lwm2m_set_bool( &entry->path, true );
+
+                ret = ret ? ret : lwm2m_set_bool( &entry->path, false );
+
+                if( ret )
+                {
+                    return ret;
+                }
+            }
+
+            return lwm2m_set_bool( &entry->path, entry->value.b );
+        }
+
+        case COALESCE_S32:
+            return lwm2m_set_s32( &entry->path, entry->value.s32 );
+
+        case COALESCE_TIME:
+            return lwm2m_set_time( &entry->path, entry->value.time );
+    }
+
+    return -EINVAL;
+}
+
+static void coalesce_work_handler( struct k_work * work )
+{
+    static struct coalesce_entry flush[ CONFIG_APP_LWM2M_NOTIFY_COALESCE_ENTRIES ];
+    size_t count;
+    uint32_t changes;
+
+    k_mutex_lock( &coalesce_lock, K_FOREVER );
+    count = entry_count;
+    changes = window_changes;
+    memcpy( flush, entries, count * sizeof( flush[ 0 ] ) );
+    entry_count = 0;
+    window_changes = 0;
+    k_mutex_unlock( &coalesce_lock );
+
+    for(size_t i = 0; i < count; i++)
+    {
+        int ret = coalesce_apply( &flush[ i ] );
+
+        if( ret )
+        {
+            LOG_ERR( "Set /%u/%u/%u failed (%d)", flush[ i ].path.obj_id, flush[ i ].path.obj_inst_id,
+                     flush[ i ].path.res_id, ret );
+        }
+    }
+
+    k_mutex_lock( &coalesce_lock, K_FOREVER );
+    total_changes += changes;
+    LOG_DBG( "Coalesced %u changes of %u resources, %u changes and %u notifications of their objects since boot",
+             changes, count, total_changes, total_notifications );
+    k_mutex_unlock( &coalesce_lock );
+}
+
+static bool coalesce_same_path( const struct lwm2m_obj_path * a,
+                                const struct lwm2m_obj_path * b )
+{
+    return ( a->level == b->level ) && ( a->obj_id == b->obj_id ) && ( a->obj_inst_id == b->obj_inst_id ) &&
+           ( a->res_id == b->res_id ) && ( a->res_inst_id == b->res_inst_id );
+}
+
+/* Must be called with coalesce_lock held */
+static void coalesce_track_object( uint16_t obj_id )
+{
+    for(size_t i = 0; i < object_count; i++)
+    {
+        if( objects[ i ] == obj_id )
+        {
+            return;
+        }
+    }
+
+    if( object_count < ARRAY_SIZE( objects ) )
+    {
+        objects[ object_count++ ] = obj_id;
+    }
+}
+
+static int coalesce_stage( const struct coalesce_entry * change )
+{
+    struct coalesce_entry * entry = NULL;
+
+    k_mutex_lock( &coalesce_lock, K_FOREVER );
+
+    for(size_t i = 0; i < entry_count; i++)
+    {
+        if( coalesce_same_path( &entries[ i ].path, &change->path ) )
+        {
+            entry = &entries[ i ];
+            break;
+        }
+    }
+
+    if( entry == NULL )
+    {
+        if( entry_count == ARRAY_SIZE( entries ) )
+        {
+            k_mutex_unlock( &coalesce_lock );
+            LOG_WRN( "Notification window full, writing /%u/%u/%u right away", change->path.obj_id,
+                     change->path.obj_inst_id, change->path.res_id );
+            return coalesce_apply( change );
+        }
+
+        entry = &entries[ entry_count++ ];
+        *entry = *change;
+
+        if( change->type == COALESCE_BOOL )
+        {
+            bool current = false;
+
+            /* A rising edge is counted against the value the engine holds */
+            ( void ) lwm2m_get_bool( &change->path, &current );
+            entry->rising = ( !current && change->value.b ) ? 1 : 0;
+        }
+
+        coalesce_track_object( change->path.obj_id );
+    }
+    else
+    {
+        if( ( change->type == COALESCE_BOOL ) && !entry->value.b && change->value.b )
+        {
+            entry->rising++;
+        }
+
+        entry->value = change->value;
+    }
+
+    window_changes++;
+
+    /* The window opens with its first change and is not extended by later ones */
+    k_work_schedule( &coalesce_work, K_MSEC( CONFIG_APP_LWM2M_NOTIFY_COALESCE_WINDOW_MS ) );
+
+    k_mutex_unlock( &coalesce_lock );
+
+    return 0;
+}
+
+int lwm2m_coalesce_set_bool( const struct lwm2m_obj_path * path,
+                             bool value )
+{
+    struct coalesce_entry change = { .path = *path, .type = COALESCE_BOOL, .value.b = value };
+
+    return coalesce_stage( &change );
+}
+
+int lwm2m_coalesce_set_s32( const struct lwm2m_obj_path * path,
+                            int32_t value )
+{
+    struct coalesce_entry change = { .path = *path, .type = COALESCE_S32, .value.s32 = value };
+
+    return coalesce_stage( &change );
+}
+
+int lwm2m_coalesce_set_time( const struct lwm2m_obj_path * path,
+                             time_t value )
+{
+    struct coalesce_entry change = { .path = *path, .type = COALESCE_TIME, .value.time = value };
+
+    return coalesce_stage( &change );
+}
+
+void lwm2m_coalesce_notified( const struct lwm2m_obj_path * path )
+{
+    if( path == NULL )
+    {
+        return;
+    }
+
+    k_mutex_lock( &coalesce_lock, K_FOREVER );
+
+    for(size_t i = 0; i < object_count; i++)
+    {
+        if( objects[ i ] == path->obj_id )
+        {
+            total_notifications++;
+            break;
+        }
+    }
+
+    k_mutex_unlock( &coalesce_lock );
+}
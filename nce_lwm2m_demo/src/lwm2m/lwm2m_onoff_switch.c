@@ -11,6 +11,8 @@
 #include "ui_input.h"
 #include "ui_input_event.h"
 #include "lwm2m_app_utils.h"
+#include "lwm2m_notify_coalesce.h"
+#include "lwm2m_input_latency.h"
 #include "lwm2m_engine.h"
 
 #include <zephyr/logging/log.h>
@@ -80,29 +82,31 @@ static bool app_event_handler( const struct app_event_header * aeh )
         switch( event->device_number )
         {
             case 1:
-                lwm2m_set_bool( &LWM2M_OBJ( IPSO_OBJECT_ONOFF_SWITCH_ID,
-                                            SWICTH1_OBJ_INST_ID,
-                                            DIGITAL_INPUT_STATE_RID ),
-                                event->state );
+                lwm2m_coalesce_set_bool( &LWM2M_OBJ( IPSO_OBJECT_ONOFF_SWITCH_ID,
+                                                     SWICTH1_OBJ_INST_ID,
+                                                     DIGITAL_INPUT_STATE_RID ),
+                                         event->state );
 
                 if( IS_ENABLED( CONFIG_LWM2M_IPSO_ONOFF_SWITCH_VERSION_1_1 ) )
                 {
-                    set_ipso_obj_timestamp( IPSO_OBJECT_ONOFF_SWITCH_ID,
-                                            SWICTH1_OBJ_INST_ID );
+                    set_ipso_obj_timestamp_at( IPSO_OBJECT_ONOFF_SWITCH_ID,
+                                               SWICTH1_OBJ_INST_ID,
+                                               event->timestamp );
                 }
 
                 break;
 
             case 2:
-                lwm2m_set_bool( &LWM2M_OBJ( IPSO_OBJECT_ONOFF_SWITCH_ID,
-                                            SWITCH2_OBJ_INST_ID,
-                                            DIGITAL_INPUT_STATE_RID ),
-                                event->state );
+                lwm2m_coalesce_set_bool( &LWM2M_OBJ( IPSO_OBJECT_ONOFF_SWITCH_ID,
+                                                     SWITCH2_OBJ_INST_ID,
+                                                     DIGITAL_INPUT_STATE_RID ),
+                                         event->state );
 
                 if( IS_ENABLED( CONFIG_LWM2M_IPSO_ONOFF_SWITCH_VERSION_1_1 ) )
                 {
-                    set_ipso_obj_timestamp( IPSO_OBJECT_ONOFF_SWITCH_ID,
-                                            SWITCH2_OBJ_INST_ID );
+                    set_ipso_obj_timestamp_at( IPSO_OBJECT_ONOFF_SWITCH_ID,
+                                               SWITCH2_OBJ_INST_ID,
+                                               event->timestamp );
                 }
 
                 break;
@@ -111,6 +115,7 @@ static bool app_event_handler( const struct app_event_header * aeh )
                 return false;
         }
 
+        lwm2m_input_latency_edge( IPSO_OBJECT_ONOFF_SWITCH_ID, event->device_number - 1, event->timestamp );
         LOG_DBG( "Switch %d changed state to %d.", event->device_number, event->state );
         return true;
     }
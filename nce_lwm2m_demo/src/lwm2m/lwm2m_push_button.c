@@ -11,6 +11,8 @@
 #include "ui_input.h"
 #include "ui_input_event.h"
 #include "lwm2m_app_utils.h"
+#include "lwm2m_notify_coalesce.h"
+#include "lwm2m_input_latency.h"
 #include "lwm2m_engine.h"
 
 #include <zephyr/logging/log.h>
@@ -87,34 +89,36 @@ static bool app_event_handler( const struct app_event_header * aeh )
         switch( event->device_number )
         {
             case 1:
-                lwm2m_set_bool( &LWM2M_OBJ( IPSO_OBJECT_PUSH_BUTTON_ID,
-                                            BUTTON1_OBJ_INST_ID,
-                                            DIGITAL_INPUT_STATE_RID ),
-                                event->state );
+                lwm2m_coalesce_set_bool( &LWM2M_OBJ( IPSO_OBJECT_PUSH_BUTTON_ID,
+                                                     BUTTON1_OBJ_INST_ID,
+                                                     DIGITAL_INPUT_STATE_RID ),
+                                         event->state );
 
                 if( event->state )
                 {
                     if( IS_ENABLED( CONFIG_LWM2M_IPSO_PUSH_BUTTON_VERSION_1_1 ) )
                     {
-                        set_ipso_obj_timestamp( IPSO_OBJECT_PUSH_BUTTON_ID,
-                                                BUTTON1_OBJ_INST_ID );
+                        set_ipso_obj_timestamp_at( IPSO_OBJECT_PUSH_BUTTON_ID,
+                                                   BUTTON1_OBJ_INST_ID,
+                                                   event->timestamp );
                     }
                 }
 
                 break;
 
             case 2:
-                lwm2m_set_bool( &LWM2M_OBJ( IPSO_OBJECT_PUSH_BUTTON_ID,
-                                            BUTTON2_OBJ_INST_ID,
-                                            DIGITAL_INPUT_STATE_RID ),
-                                event->state );
+                lwm2m_coalesce_set_bool( &LWM2M_OBJ( IPSO_OBJECT_PUSH_BUTTON_ID,
+                                                     BUTTON2_OBJ_INST_ID,
+                                                     DIGITAL_INPUT_STATE_RID ),
+                                         event->state );
 
                 if( event->state )
                 {
                     if( IS_ENABLED( CONFIG_LWM2M_IPSO_PUSH_BUTTON_VERSION_1_1 ) )
                     {
-                        set_ipso_obj_timestamp( IPSO_OBJECT_PUSH_BUTTON_ID,
-                                                BUTTON2_OBJ_INST_ID );
+                        set_ipso_obj_timestamp_at( IPSO_OBJECT_PUSH_BUTTON_ID,
+                                                   BUTTON2_OBJ_INST_ID,
+                                                   event->timestamp );
                     }
                 }
 
@@ -124,6 +128,7 @@ static bool app_event_handler( const struct app_event_header * aeh )
                 return false;
         }
 
+        lwm2m_input_latency_edge( IPSO_OBJECT_PUSH_BUTTON_ID, event->device_number - 1, event->timestamp );
         LOG_DBG( "Button %d changed state to %d.", event->device_number, event->state );
         return true;
     }
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <net/lwm2m_client_utils.h>
+
+#include "lwm2m_app_utils.h"
+#include "lwm2m_reg_state.h"
+#if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    #include "lwm2m_settings_wb.h"
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+#define REG_STATE_SETTINGS_KEY    "app_lwm2m/reg"
+
+/* Persisted registration state */
+struct reg_state
+{
+    uint32_t endpoint_crc; /* CRC-32 of the endpoint name, 0 if nothing is stored */
+    uint16_t srv_obj_inst;
+    uint32_t lifetime_s;
+    uint32_t cold_ms;      /* Last time-to-registered with a bootstrap */
+    uint32_t warm_ms;      /* Last time-to-registered without a bootstrap */
+};
+
+static struct reg_state state;
+static uint32_t endpoint_crc;
+static bool warm_start;
+static bool registered_once;
+static bool transport_failed; /* Timeout or network error since the last registration outcome */
+
+static void reg_state_save_work_handler( struct k_work * work );
+
+static K_WORK_DEFINE( reg_state_save_work, reg_state_save_work_handler );
+
+static int reg_state_load_cb( const char * key,
+                              size_t len,
+                              settings_read_cb read_cb,
+                              void * cb_arg,
+                              void * param )
+{
+    ssize_t ret;
+
+    if( len != sizeof( state ) )
+    {
+        return -EINVAL;
+    }
+
+    ret = read_cb( cb_arg, &state, sizeof( state ) );
+
+    return ( ret < 0 ) ? ( int ) ret : 0;
+}
+
+static void reg_state_save_work_handler( struct k_work * work )
+{
+    int ret;
+
+    if( state.endpoint_crc != 0 )
+    {
+        lwm2m_get_u32( &LWM2M_OBJ( LWM2M_OBJECT_SERVER_ID, state.srv_obj_inst, LIFETIME_RID ), &state.lifetime_s );
+    }
+
+    #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    ret = lwm2m_settings_wb_save( REG_STATE_SETTINGS_KEY, &state, sizeof( state ) );
+    #else
+    ret = settings_save_one( REG_STATE_SETTINGS_KEY, &state, sizeof( state ) );
+    #endif
+
+    if( ret )
+    {
+        LOG_WRN( "Failed to persist the registration state (%d)", ret );
+    }
+}
+
+int lwm2m_reg_state_init( const char * endpoint )
+{
+    int ret;
+
+    endpoint_crc = crc32_ieee( ( const uint8_t * ) endpoint, strlen( endpoint ) );
+
+    ret = settings_subsys_init();
+
+    if( ret == 0 )
+    {
+        ret = settings_load_subtree_direct( REG_STATE_SETTINGS_KEY, reg_state_load_cb, NULL );
+    }
+
+    if( ret )
+    {
+        LOG_WRN( "Failed to load the registration state (%d)", ret );
+        memset( &state, 0, sizeof( state ) );
+        return ret;
+    }
+
+    if( state.endpoint_crc != endpoint_crc )
+    {
+        state.endpoint_crc = 0;
+    }
+
+    return 0;
+}
+
+uint32_t lwm2m_reg_state_bootstrap_flags( void )
+{
+    warm_start = ( state.endpoint_crc != 0 ) && !lwm2m_security_needs_bootstrap();
+
+    if( warm_start )
+    {
+        LOG_INF( "Registering with the stored server account (lifetime %u s), bootstrap skipped",
+                 state.lifetime_s );
+        return 0;
+    }
+
+    return LWM2M_RD_CLIENT_FLAG_BOOTSTRAP;
+}
+
+void lwm2m_reg_state_registered( uint16_t srv_obj_inst )
+{
+    uint32_t uptime_ms = k_uptime_get_32();
+
+    state.endpoint_crc = endpoint_crc;
+    state.srv_obj_inst = srv_obj_inst;
+
+    if( !registered_once )
+    {
+        registered_once = true;
+
+        if( warm_start )
+        {
+            state.warm_ms = uptime_ms;
+        }
+        else
+        {
+            state.cold_ms = uptime_ms;
+        }
+
+        LOG_INF( "Registered %u ms after boot (%s start), last cold start %u ms, last warm start %u ms",
+                 uptime_ms, warm_start ? "warm" : "cold", state.cold_ms, state.warm_ms );
+    }
+
+    k_work_submit( &reg_state_save_work );
+}
+
+void lwm2m_reg_state_event( enum lwm2m_rd_client_event client_event )
+{
+    switch( client_event )
+    {
+        case LWM2M_RD_CLIENT_EVENT_REG_TIMEOUT:
+        case LWM2M_RD_CLIENT_EVENT_NETWORK_ERROR:
+            transport_failed = true;
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_REGISTRATION_COMPLETE:
+        case LWM2M_RD_CLIENT_EVENT_REG_UPDATE_COMPLETE:
+            transport_failed = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool lwm2m_reg_state_rejected( void )
+{
+    /* The engine reports the server's error code and a lost request with the same event */
+    bool answered = !transport_failed;
+
+    transport_failed = false;
+
+    if( !warm_start )
+    {
+        return false;
+    }
+
+    if( !answered )
+    {
+        LOG_INF( "Registration failed without an answer from the server, keeping the stored account" );
+        return false;
+    }
+
+    LOG_WRN( "Stored server account rejected, restarting with bootstrap" );
+    warm_start = false;
+    state.endpoint_crc = 0;
+    k_work_submit( &reg_state_save_work );
+
+    return true;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <modem/lte_lc.h>
+#include <modem/modem_info.h>
+#include <nrf_modem_at.h>
+
+#include "lwm2m_app_utils.h"
+#include "lwm2m_send_history.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+#define HISTORY_PATH_COUNT    2
+
+/* One batch per resource, while a Send is deferred the engine overwrites the oldest samples */
+#define HISTORY_CACHE_LEN     CONFIG_APP_LWM2M_SEND_HISTORY_BATCH
+
+#if defined( CONFIG_LWM2M_RW_SENML_CBOR_SUPPORT )
+BUILD_ASSERT( HISTORY_PATH_COUNT * HISTORY_CACHE_LEN <= CONFIG_LWM2M_RW_SENML_CBOR_RECORDS,
+              "CONFIG_LWM2M_RW_SENML_CBOR_RECORDS too small for the history batch" );
+#endif
+
+static const struct lwm2m_obj_path history_paths[ HISTORY_PATH_COUNT ] =
+{
+    LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0, POWER_SOURCE_VOLTAGE_RID, 0 ),
+    LWM2M_OBJ( LWM2M_OBJECT_CONNECTIVITY_MONITORING_ID, 0, RADIO_SIGNAL_STRENGTH_RID ),
+};
+
+static struct lwm2m_time_series_elem voltage_cache[ HISTORY_CACHE_LEN ];
+static struct lwm2m_time_series_elem rss_cache[ HISTORY_CACHE_LEN ];
+
+static struct lwm2m_ctx * client_ctx;
+static uint32_t pending_samples;
+
+/* Counters for the wakeup and payload report */
+static uint32_t sent_samples;
+static uint32_t send_count;
+static atomic_t rrc_connections;
+
+static void history_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( history_work, history_work_handler );
+
+static void history_lte_handler( const struct lte_lc_evt *const evt )
+{
+    if( ( evt->type == LTE_LC_EVT_RRC_UPDATE ) && ( evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ) )
+    {
+        atomic_inc( &rrc_connections );
+    }
+}
+
+static void history_report( void )
+{
+    int tx_kb = 0;
+    int rx_kb = 0;
+    uint32_t uptime_s = ( uint32_t ) ( k_uptime_get() / MSEC_PER_SEC );
+    uint32_t wakeups_per_hour_x100;
+
+    /* Modem counters since AT%XCONNSTAT=1, in kB, include the DTLS and CoAP overhead */
+    if( nrf_modem_at_scanf( "AT%XCONNSTAT?", "%%XCONNSTAT: %*d,%*d,%d,%d", &tx_kb, &rx_kb ) != 2 )
+    {
+        LOG_DBG( "Connection statistics not available" );
+    }
+
+    wakeups_per_hour_x100 = ( uptime_s > 0 ) ?
+                            ( uint32_t ) ( ( uint64_t ) atomic_get( &rrc_connections ) * 360000U / uptime_s ) : 0;
+
+    LOG_INF( "History: %u samples in %u sends, %u.%02u radio wakeups/h, uplink %d kB, %u bytes/sample",
+             sent_samples, send_count, wakeups_per_hour_x100 / 100, wakeups_per_hour_x100 % 100,
+             tx_kb, ( sent_samples > 0 ) ? ( uint32_t ) tx_kb * 1024U / sent_samples : 0 );
+}
+
+static void history_send_reply_cb( enum lwm2m_send_status status )
+{
+    if( status == LWM2M_SEND_STATUS_SUCCESS )
+    {
+        LOG_DBG( "History batch delivered" );
+    }
+    else
+    {
+        LOG_WRN( "History batch not acknowledged (%d)", status );
+    }
+}
+
+static void history_sample( void )
+{
+    int ret;
+    int voltage_mv;
+    int rsrp_dbm;
+
+    ret = modem_info_get_batt_voltage( &voltage_mv );
+
+    if( ret == 0 )
+    {
+        lwm2m_set_s32( &history_paths[ 0 ], voltage_mv );
+    }
+
+    ret = modem_info_get_rsrp( &rsrp_dbm );
+
+    if( ret == 0 )
+    {
+        lwm2m_set_s16( &history_paths[ 1 ], ( int16_t ) rsrp_dbm );
+    }
+
+    pending_samples++;
+}
+
+static void history_work_handler( struct k_work * work )
+{
+    int ret;
+
+    k_work_schedule( &history_work, K_SECONDS( CONFIG_APP_LWM2M_SEND_HISTORY_INTERVAL ) );
+
+    history_sample();
+
+    if( pending_samples < CONFIG_APP_LWM2M_SEND_HISTORY_BATCH )
+    {
+        return;
+    }
+
+    /* Sends every cached entry of the paths, each with its own timestamp */
+    ret = lwm2m_send_cb( client_ctx, history_paths, HISTORY_PATH_COUNT, history_send_reply_cb );
+
+    if( ret )
+    {
+        /* Samples stay cached, the next interval tries again */
+        LOG_DBG( "History send deferred (%d)", ret );
+        return;
+    }
+
+    send_count++;
+    sent_samples += MIN( pending_samples, HISTORY_CACHE_LEN );
+    pending_samples = 0;
+    history_report();
+}
+
+int lwm2m_send_history_init( struct lwm2m_ctx * ctx )
+{
+    int ret;
+
+    client_ctx = ctx;
+
+    ret = lwm2m_enable_cache( &history_paths[ 0 ], voltage_cache, ARRAY_SIZE( voltage_cache ) );
+
+    if( ret == 0 )
+    {
+        ret = lwm2m_enable_cache( &history_paths[ 1 ], rss_cache, ARRAY_SIZE( rss_cache ) );
+    }
+
+    if( ret )
+    {
+        LOG_ERR( "Unable to enable the history cache (%d)", ret );
+        return ret;
+    }
+
+    lte_lc_register_handler( history_lte_handler );
+
+    ret = nrf_modem_at_printf( "AT%%XCONNSTAT=1" );
+
+    if( ret )
+    {
+        LOG_WRN( "Unable to start connection statistics (%d)", ret );
+    }
+
+    k_work_schedule( &history_work, K_SECONDS( CONFIG_APP_LWM2M_SEND_HISTORY_INTERVAL ) );
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+#include <zephyr/settings/settings.h>
+
+#include "lwm2m_app_utils.h"
+#include "lwm2m_settings_wb.h"
+#include "write_back.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+/* Key layout of the security and server objects stored by the LwM2M client utilities, loaded at boot */
+#define ENGINE_SETTINGS_PREFIX    "lwm2m:sec"
+
+/* Resources the bootstrap server, the server or the demo change; the others keep the client utilities' callbacks */
+static const uint16_t security_rids[] =
+{
+    SECURITY_SERVER_URI_RID,        SECURITY_BOOTSTRAP_FLAG_RID, SECURITY_MODE_RID,
+    SECURITY_CLIENT_IDENTITY_RID,   SECURITY_SERVER_PUBLIC_KEY_RID,
+    SECURITY_SECRET_KEY_RID,        SECURITY_SHORT_SERVER_ID_RID,
+};
+
+static const uint16_t server_rids[] =
+{
+    SHORT_SERVER_ID_RID, LIFETIME_RID,             DEFAULT_MIN_PERIOD_RID, DEFAULT_MAX_PERIOD_RID,
+    DISABLE_TIMEOUT_RID, NOTIFICATION_STORING_RID, BINDING_RID,
+};
+
+struct wb_read
+{
+    const uint8_t * value;
+    size_t len;
+    size_t offset;
+};
+
+struct wb_load
+{
+    const struct settings_load_arg * arg;
+};
+
+static ssize_t wb_read_cb( void * cb_arg,
+                           void * data,
+                           size_t len )
+{
+    struct wb_read * read = cb_arg;
+    size_t chunk = MIN( len, read->len - read->offset );
+
+    memcpy( data, &read->value[ read->offset ], chunk );
+    read->offset += chunk;
+
+    return chunk;
+}
+
+static int wb_load_entry( const char * name,
+                          const void * value,
+                          size_t len,
+                          void * arg )
+{
+    struct wb_load * load = arg;
+    struct wb_read read = { .value = value, .len = len };
+
+    settings_call_set_handler( name, len, wb_read_cb, &read, load->arg );
+
+    return 0;
+}
+
+/* Pending keys are loaded after the backend's, so their value wins */
+static int wb_csi_load( struct settings_store * cs,
+                        const struct settings_load_arg * arg )
+{
+    struct wb_load load = { .arg = arg };
+
+    ARG_UNUSED( cs );
+
+    return write_back_foreach( wb_load_entry, &load );
+}
+
+static const struct settings_store_itf wb_itf =
+{
+    .csi_load = wb_csi_load,
+};
+
+static struct settings_store wb_store =
+{
+    .cs_itf = &wb_itf,
+};
+
+static int wb_engine_save( uint16_t obj_id,
+                           uint16_t obj_inst_id,
+                           uint16_t res_id,
+                           const uint8_t * data,
+                           uint16_t data_len )
+{
+    char name[ sizeof( ENGINE_SETTINGS_PREFIX "/65535/65535/65535" ) ];
+    int ret;
+
+    snprintk( name, sizeof( name ), ENGINE_SETTINGS_PREFIX "/%u/%u/%u", obj_id, obj_inst_id, res_id );
+    ret = lwm2m_settings_wb_save( name, data, data_len );
+
+    if( ret )
+    {
+        /* The resource holds the new value, only persisting it failed */
+        LOG_WRN( "Failed to save %s (%d)", name, ret );
+    }
+
+    return 0;
+}
+
+static int wb_security_write_cb( uint16_t obj_inst_id,
+                                 uint16_t res_id,
+                                 uint16_t res_inst_id,
+                                 uint8_t * data,
+                                 uint16_t data_len,
+                                 bool last_block,
+                                 size_t total_size,
+                                 size_t offset )
+{
+    ARG_UNUSED( res_inst_id );
+    ARG_UNUSED( last_block );
+    ARG_UNUSED( total_size );
+    ARG_UNUSED( offset );
+
+    return wb_engine_save( LWM2M_OBJECT_SECURITY_ID, obj_inst_id, res_id, data, data_len );
+}
+
+static int wb_server_write_cb( uint16_t obj_inst_id,
+                               uint16_t res_id,
+                               uint16_t res_inst_id,
+                               uint8_t * data,
+                               uint16_t data_len,
+                               bool last_block,
+                               size_t total_size,
+                               size_t offset )
+{
+    ARG_UNUSED( res_inst_id );
+    ARG_UNUSED( last_block );
+    ARG_UNUSED( total_size );
+    ARG_UNUSED( offset );
+
+    return wb_engine_save( LWM2M_OBJECT_SERVER_ID, obj_inst_id, res_id, data, data_len );
+}
+
+int lwm2m_settings_wb_save( const char * name,
+                            const void * value,
+                            size_t len )
+{
+    return write_back_save( name, value, len );
+}
+
+int lwm2m_settings_wb_flush( void )
+{
+    return write_back_flush();
+}
+
+void lwm2m_settings_wb_registered( const struct lwm2m_ctx * client )
+{
+    /* The client utilities register their own callbacks for every instance the bootstrap creates */
+    for(size_t i = 0; i < ARRAY_SIZE( security_rids ); i++)
+    {
+        lwm2m_register_post_write_callback( &LWM2M_OBJ( LWM2M_OBJECT_SECURITY_ID, client->sec_obj_inst,
+                                                        security_rids[ i ] ),
+                                            wb_security_write_cb );
+    }
+
+    for(size_t i = 0; i < ARRAY_SIZE( server_rids ); i++)
+    {
+        lwm2m_register_post_write_callback( &LWM2M_OBJ( LWM2M_OBJECT_SERVER_ID, client->srv_obj_inst,
+                                                        server_rids[ i ] ),
+                                            wb_server_write_cb );
+    }
+}
+
+void lwm2m_settings_wb_event( enum lwm2m_rd_client_event event )
+{
+    int dropped;
+
+    switch( event )
+    {
+        case LWM2M_RD_CLIENT_EVENT_BOOTSTRAP_REG_COMPLETE:
+            /* The bootstrap deletes and rewrites the stored objects, older pending values must not return */
+            dropped = write_back_discard( ENGINE_SETTINGS_PREFIX "/" );
+
+            if( dropped > 0 )
+            {
+                LOG_INF( "Dropped %d pending object keys for the bootstrap", dropped );
+            }
+
+            break;
+
+        case LWM2M_RD_CLIENT_EVENT_QUEUE_MODE_RX_OFF:
+        case LWM2M_RD_CLIENT_EVENT_ENGINE_SUSPENDED:
+        case LWM2M_RD_CLIENT_EVENT_DISCONNECT:
+            /* The radio is idle or the client stops, a reboot may follow */
+            write_back_flush_async();
+            break;
+
+        default:
+            break;
+    }
+}
+
+int lwm2m_settings_wb_init( void )
+{
+    static bool registered;
+    int ret = settings_subsys_init();
+
+    if( ret )
+    {
+        return ret;
+    }
+
+    if( !registered )
+    {
+        ret = write_back_init( settings_save_one );
+
+        if( ret )
+        {
+            return ret;
+        }
+
+        /* Registered after the backend, so settings_load() reads it last */
+        settings_src_register( &wb_store );
+        registered = true;
+    }
+
+    return 0;
+}
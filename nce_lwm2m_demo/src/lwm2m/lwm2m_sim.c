@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/lwm2m.h>
+
+#include "lwm2m_app_utils.h"
+#include "lwm2m_sim.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m, CONFIG_APP_LOG_LEVEL );
+
+#define SIM_SECURITY_MODE_NO_SEC    3
+#define SIM_SHORT_SERVER_ID         1
+
+/* Starting point of the simulated walk, moved by a fixed step per update */
+#define SIM_LATITUDE                50.9375
+#define SIM_LONGITUDE               6.9603
+#define SIM_STEP_DEGREES            0.0005
+
+#define SIM_RSRP_DBM                ( -95 )
+#define SIM_CELL_ID                 0x0145A0B
+#define SIM_STEPS_PER_CELL          8
+#define SIM_BATTERY_MV              3900
+
+static uint32_t sim_step;
+
+static void sim_work_handler( struct k_work * work );
+
+static K_WORK_DELAYABLE_DEFINE( sim_work, sim_work_handler );
+
+static void sim_update_device( void )
+{
+    /* Slow discharge, so the voltage changes every few updates only */
+    lwm2m_set_s32( &LWM2M_OBJ( LWM2M_OBJECT_DEVICE_ID, 0, POWER_SOURCE_VOLTAGE_RID, 0 ),
+                   SIM_BATTERY_MV - ( int32_t ) ( sim_step / 4 ) );
+}
+
+static void sim_update_cell( void )
+{
+    #if defined( CONFIG_LWM2M_CONN_MON_OBJ_SUPPORT )
+    /* Stands in for the neighbour cell measurements: a handover every few
+     * updates and a signal strength that moves within a few dB */
+    static const int8_t rsrp_offsets[] = { 0, -2, -5, -3, 1, 4, 2, -1 };
+
+    lwm2m_set_u32( &LWM2M_OBJ( LWM2M_OBJECT_CONNECTIVITY_MONITORING_ID, 0, CELL_ID_RID ),
+                   SIM_CELL_ID + sim_step / SIM_STEPS_PER_CELL );
+    lwm2m_set_s16( &LWM2M_OBJ( LWM2M_OBJECT_CONNECTIVITY_MONITORING_ID, 0, RADIO_SIGNAL_STRENGTH_RID ),
+                   SIM_RSRP_DBM + rsrp_offsets[ sim_step % ARRAY_SIZE( rsrp_offsets ) ] );
+    #endif
+}
+
+static void sim_update_location( void )
+{
+    #if defined( CONFIG_LWM2M_LOCATION_OBJ_SUPPORT )
+    /* Stands in for a GNSS fix: a walk around a square with a 200 m side */
+    uint32_t side = ( sim_step / 4 ) % 4;
+    double offset = ( sim_step % 4 ) * SIM_STEP_DEGREES;
+    double latitude = SIM_LATITUDE;
+    double longitude = SIM_LONGITUDE;
+
+    switch( side )
+    {
+        case 0:
+            longitude += offset;
+            break;
+
+        case 1:
+            latitude += offset;
+            longitude += 4 * SIM_STEP_DEGREES;
+            break;
+
+        case 2:
+            latitude += 4 * SIM_STEP_DEGREES;
+            longitude += 4 * SIM_STEP_DEGREES - offset;
+            break;
+
+        default:
+            latitude += 4 * SIM_STEP_DEGREES - offset;
+            break;
+    }
+
+    lwm2m_set_f64( &LWM2M_OBJ( LWM2M_OBJECT_LOCATION_ID, 0, LATITUDE_RID ), latitude );
+    lwm2m_set_f64( &LWM2M_OBJ( LWM2M_OBJECT_LOCATION_ID, 0, LONGITUDE_RID ), longitude );
+    lwm2m_set_f64( &LWM2M_OBJ( LWM2M_OBJECT_LOCATION_ID, 0, LOCATION_RADIUS_RID ), 10.0 );
+    lwm2m_set_time( &LWM2M_OBJ( LWM2M_OBJECT_LOCATION_ID, 0, LOCATION_TIMESTAMP_RID ),
+                    ( time_t ) ( k_uptime_get() / MSEC_PER_SEC ) );
+    #endif
+}
+
+static void sim_work_handler( struct k_work * work )
+{
+    sim_update_device();
+    sim_update_cell();
+    sim_update_location();
+    sim_step++;
+
+    k_work_schedule( &sim_work, K_SECONDS( CONFIG_APP_LWM2M_SIM_UPDATE_INTERVAL ) );
+}
+
+static int sim_init_server( void )
+{
+    int ret;
+
+    ret = lwm2m_set_string( &LWM2M_OBJ( LWM2M_OBJECT_SECURITY_ID, 0, SECURITY_SERVER_URI_RID ),
+                            CONFIG_APP_LWM2M_SIM_SERVER );
+
+    if( ret )
+    {
+        return ret;
+    }
+
+    lwm2m_set_u8( &LWM2M_OBJ( LWM2M_OBJECT_SECURITY_ID, 0, SECURITY_MODE_RID ), SIM_SECURITY_MODE_NO_SEC );
+    lwm2m_set_bool( &LWM2M_OBJ( LWM2M_OBJECT_SECURITY_ID, 0, SECURITY_BOOTSTRAP_FLAG_RID ), false );
+    lwm2m_set_u16( &LWM2M_OBJ( LWM2M_OBJECT_SECURITY_ID, 0, SECURITY_SHORT_SERVER_ID_RID ), SIM_SHORT_SERVER_ID );
+    lwm2m_set_u16( &LWM2M_OBJ( LWM2M_OBJECT_SERVER_ID, 0, SHORT_SERVER_ID_RID ), SIM_SHORT_SERVER_ID );
+    lwm2m_set_u32( &LWM2M_OBJ( LWM2M_OBJECT_SERVER_ID, 0, LIFETIME_RID ), CONFIG_LWM2M_ENGINE_DEFAULT_LIFETIME );
+
+    return 0;
+}
+
+int lwm2m_sim_init( void )
+{
+    int ret;
+
+    ret = sim_init_server();
+
+    if( ret )
+    {
+        LOG_ERR( "Unable to set up the local server account (%d)", ret );
+        return ret;
+    }
+
+    LOG_INF( "Simulated modem objects, server %s", CONFIG_APP_LWM2M_SIM_SERVER );
+
+    /* First values right away, so the server reads them after registering */
+    k_work_schedule( &sim_work, K_NO_WAIT );
+
+    return 0;
+}
@@ -19,48 +19,82 @@
 #include <zephyr/drivers/gpio.h>
 #include <stdio.h>
 #include <zephyr/net/lwm2m.h>
-#include <modem/nrf_modem_lib.h>
-#include <net/lwm2m_client_utils.h>
 #include <app_event_manager.h>
-#include <net/lwm2m_client_utils_location.h>
-#include <date_time.h>
+
+#if !defined( CONFIG_APP_LWM2M_SIM )
+    #include <modem/nrf_modem_lib.h>
+    #include <net/lwm2m_client_utils.h>
+    #include <net/lwm2m_client_utils_location.h>
+#endif
+
+#if defined( CONFIG_DATE_TIME )
+    #include <date_time.h>
+#endif
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER( app_lwm2m_client, CONFIG_APP_LOG_LEVEL );
 
-#include <modem/lte_lc.h>
-#include <modem/modem_info.h>
-#include <nrf_modem_at.h>
+#if !defined( CONFIG_APP_LWM2M_SIM )
+    #include <modem/lte_lc.h>
+    #include <modem/modem_info.h>
+    #include <nrf_modem_at.h>
+    #include <modem/modem_key_mgmt.h>
+#endif
 
 #include "lwm2m_client_app.h"
 #include "lwm2m_app_utils.h"
 
+#if defined( CONFIG_APP_LWM2M_SEND_HISTORY )
+    #include "lwm2m_send_history.h"
+#endif
+
+#if defined( CONFIG_LWM2M_CLIENT_UTILS_SIGNAL_MEAS_INFO_OBJ_SUPPORT )
+    #include "lwm2m_ncell_sched.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_WARM_START )
+    #include "lwm2m_reg_state.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    #include "lwm2m_settings_wb.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_DTLS_STATS )
+    #include "lwm2m_dtls_stats.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_FOTA )
+    #include "lwm2m_fota.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_SIM )
+    #include "lwm2m_sim.h"
+#endif
+
+#if defined( CONFIG_APP_LWM2M_BENCHMARK )
+    #include "lwm2m_benchmark.h"
+#endif
+
+#include "lwm2m_adaptive_lifetime.h"
+#include "lwm2m_input_latency.h"
+#include "lwm2m_notify_coalesce.h"
+
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
-#include <modem/modem_key_mgmt.h>
 
 #if defined( CONFIG_LWM2M_CLIENT_UTILS_LOCATION_ASSISTANCE )
     #include "ui_input.h"
     #include "ui_input_event.h"
 #endif
 
-#if !defined( CONFIG_LTE_LINK_CONTROL )
+#if !defined( CONFIG_LTE_LINK_CONTROL ) && !defined( CONFIG_APP_LWM2M_SIM )
     #error "Missing CONFIG_LTE_LINK_CONTROL"
 #endif
 
-#if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
-    #include <zephyr/drivers/gpio.h>
-
-/*
- * Thingy:91 LEDs
- */
-static struct gpio_dt_spec ledRed = GPIO_DT_SPEC_GET_OR( DT_ALIAS( led0 ), gpios,
-                                                         { 0 } );
-static struct gpio_dt_spec ledGreen = GPIO_DT_SPEC_GET_OR( DT_ALIAS( led1 ), gpios,
-                                                           { 0 } );
-static struct gpio_dt_spec ledBlue = GPIO_DT_SPEC_GET_OR( DT_ALIAS( led2 ), gpios,
-                                                          { 0 } );
-#endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
+#if defined( CONFIG_UI_STATUS_LED )
+    #include "ui_status_led.h"
+#endif
 
 #define APP_BANNER                       "Run LWM2M client"
 
@@ -73,6 +107,12 @@ static struct gpio_dt_spec ledBlue = GPIO_DT_SPEC_GET_OR( DT_ALIAS( led2 ), gpio
 #define CONNEVAL_MAX_DELAY_S             60
 #define CONNEVAL_POLL_PERIOD_MS          5000
 
+#if defined( CONFIG_APP_LWM2M_SIM )
+    #define LWM2M_SERVER_URI             CONFIG_APP_LWM2M_SIM_SERVER
+#else
+    #define LWM2M_SERVER_URI             CONFIG_LWM2M_CLIENT_UTILS_SERVER
+#endif
+
 /* Client State Machine states */
 static enum client_state
 {
@@ -104,82 +144,6 @@ void client_acknowledge( void )
     lwm2m_acknowledge( &client );
 }
 
-#if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
-
-/**
- * @brief Configures the LED GPIOs if the device is ready.
- */
-void configureLeds()
-{
-    int ret = 0;
-
-    if( ledRed.port && !device_is_ready( ledRed.port ) )
-    {
-        LOG_ERR( "Error %d: LED device %s is not ready; ignoring it\n",
-                 ret, ledRed.port->name );
-        ledRed.port = NULL;
-    }
-
-    if( ledRed.port )
-    {
-        ret = gpio_pin_configure_dt( &ledRed, GPIO_OUTPUT );
-
-        if( ret != 0 )
-        {
-            LOG_ERR( "Error %d: failed to configure LED device %s pin %d\n",
-                     ret, ledRed.port->name, ledRed.pin );
-            ledRed.port = NULL;
-        }
-    }
-
-    if( ledGreen.port && !device_is_ready( ledGreen.port ) )
-    {
-        LOG_ERR( "Error %d: LED device %s is not ready; ignoring it\n",
-                 ret, ledGreen.port->name );
-        ledGreen.port = NULL;
-    }
-
-    if( ledGreen.port )
-    {
-        ret = gpio_pin_configure_dt( &ledGreen, GPIO_OUTPUT );
-
-        if( ret != 0 )
-        {
-            LOG_ERR( "Error %d: failed to configure LED device %s pin %d\n",
-                     ret, ledGreen.port->name, ledGreen.pin );
-            ledGreen.port = NULL;
-        }
-    }
-
-    if( ledBlue.port && !device_is_ready( ledBlue.port ) )
-    {
-        LOG_ERR( "Error %d: LED device %s is not ready; ignoring it\n",
-                 ret, ledBlue.port->name );
-        ledBlue.port = NULL;
-    }
-
-    if( ledBlue.port )
-    {
-        ret = gpio_pin_configure_dt( &ledBlue, GPIO_OUTPUT );
-
-        if( ret != 0 )
-        {
-            LOG_ERR( "Error %d: failed to configure LED device %s pin %d\n",
-                     ret, ledBlue.port->name, ledBlue.pin );
-            ledBlue.port = NULL;
-        }
-    }
-}
-#endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
-
-#if defined( CONFIG_LWM2M_CLIENT_UTILS_SIGNAL_MEAS_INFO_OBJ_SUPPORT )
-static struct k_work_delayable ncell_meas_work;
-void ncell_meas_work_handler( struct k_work * work )
-{
-    lwm2m_ncell_schedule_measurement();
-    k_work_schedule( &ncell_meas_work, K_SECONDS( CONFIG_APP_NEIGHBOUR_CELL_SCAN_INTERVAL ) );
-}
-#endif
 #if defined( CONFIG_LWM2M_CLIENT_UTILS_VISIBLE_WIFI_AP_OBJ_SUPPORT )
 static struct k_work_delayable ground_fix_work;
 void ground_fix_work_handler( struct k_work * work )
@@ -205,6 +169,8 @@ static int server_send_mute_cb( uint16_t obj_inst_id,
                                 size_t total_size,
                                 size_t offset )
 {
+    lwm2m_adaptive_lifetime_downlink();
+
     if( *data )
     {
         LOG_INF( "Server Muted Send" );
@@ -287,13 +253,23 @@ static void state_trigger_and_unlock( enum client_state new_state )
 
 static int lwm2m_setup( void )
 {
+    #if !defined( CONFIG_APP_LWM2M_SIM )
     /* Save power by not updating timestamp on device object */
     lwm2m_update_device_service_period( 0 );
+    #endif
 
     /* Manufacturer dependent */
     /* use IMEI as serial number */
     lwm2m_app_init_device( endpoint_name );
+
+    #if defined( CONFIG_APP_LWM2M_SIM )
+    /* Local server without bootstrap or DTLS, modem objects are simulated */
+    return lwm2m_sim_init();
+    #else
     lwm2m_init_security( &client, endpoint_name, NULL );
+    #if defined( CONFIG_APP_LWM2M_DTLS_STATS )
+    lwm2m_dtls_stats_init( &client );
+    #endif
 
     if( false && sizeof( CONFIG_NCE_LWM2M_BOOTSTRAP_PSK ) > 1 )
     {
@@ -316,8 +292,10 @@ static int lwm2m_setup( void )
     }
 
     return 0;
+    #endif /* if defined( CONFIG_APP_LWM2M_SIM ) */
 }
 
+#if defined( CONFIG_DATE_TIME )
 static void date_time_event_handler( const struct date_time_evt * evt )
 {
     switch( evt->type )
@@ -352,6 +330,9 @@ static void date_time_event_handler( const struct date_time_evt * evt )
             break;
     }
 }
+#endif /* if defined( CONFIG_DATE_TIME ) */
+
+#if !defined( CONFIG_APP_LWM2M_SIM )
 
 int store_credentials( void )
 {
@@ -411,12 +392,17 @@ int reset_credentials( void )
 
     return err;
 }
+#endif /* if !defined( CONFIG_APP_LWM2M_SIM ) */
 
 static void rd_client_update_lifetime( int srv_obj_inst )
 {
     uint32_t current_lifetime = 0;
 
+    #if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME )
+    uint32_t lifetime = lwm2m_adaptive_lifetime_get();
+    #else
     uint32_t lifetime = CONFIG_LWM2M_ENGINE_DEFAULT_LIFETIME;
+    #endif
 
     struct lwm2m_obj_path path = LWM2M_OBJ( 1, srv_obj_inst, 1 );
 
@@ -432,14 +418,22 @@ static void rd_client_update_lifetime( int srv_obj_inst )
     update_session_lifetime = false;
 }
 
+#if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME )
+/* Runs on the system workqueue when the adaptive policy changed the lifetime */
+static void adaptive_update_lifetime( void )
+{
+    rd_client_update_lifetime( client.srv_obj_inst );
+}
+#endif
+
 static void state_set_and_unlock( enum client_state new_state )
 {
     client_state = new_state;
     k_mutex_unlock( &lte_mutex );
 }
 
-static void rd_client_event( struct lwm2m_ctx * client,
-                             enum lwm2m_rd_client_event client_event )
+static void rd_client_event_process( struct lwm2m_ctx * client,
+                                     enum lwm2m_rd_client_event client_event )
 {
     k_mutex_lock( &lte_mutex, K_FOREVER );
 
@@ -450,7 +444,29 @@ static void rd_client_event( struct lwm2m_ctx * client,
         return;
     }
 
+    #if !defined( CONFIG_APP_LWM2M_SIM )
     lwm2m_utils_connection_manage( client, &client_event );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_DTLS_STATS )
+    lwm2m_dtls_stats_event( client_event );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_BENCHMARK )
+    lwm2m_benchmark_event( client_event );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME )
+    lwm2m_adaptive_lifetime_event( client_event );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    lwm2m_settings_wb_event( client_event );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_WARM_START )
+    lwm2m_reg_state_event( client_event );
+    #endif
 
     switch( client_event )
     {
@@ -479,29 +495,28 @@ static void rd_client_event( struct lwm2m_ctx * client,
 
         case LWM2M_RD_CLIENT_EVENT_REGISTRATION_FAILURE:
             LOG_WRN( "Registration failure!" );
+            #if defined( CONFIG_APP_LWM2M_WARM_START )
+            if( lwm2m_reg_state_rejected() )
+            {
+                /* Restart the client, the next start bootstraps */
+                state_trigger_and_unlock( NETWORK_ERROR );
+                break;
+            }
+            #endif
             state_trigger_and_unlock( CONNECTING );
             break;
 
         case LWM2M_RD_CLIENT_EVENT_REGISTRATION_COMPLETE:
             LOG_DBG( "Registration complete" );
-            #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
-            if( ledBlue.port )
-            {
-                gpio_pin_set_dt( &ledBlue, 0 );
-            }
-
-            if( ledGreen.port )
-            {
-                gpio_pin_set_dt( &ledGreen, 100 );
-            }
-
-            k_sleep( K_SECONDS( 10 ) );
-
-            if( ledGreen.port )
-            {
-                gpio_pin_set_dt( &ledGreen, 0 );
-            }
-            #endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
+            #if defined( CONFIG_APP_LWM2M_WARM_START )
+            lwm2m_reg_state_registered( client->srv_obj_inst );
+            #endif
+            #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+            lwm2m_settings_wb_registered( client );
+            #endif
+            #if defined( CONFIG_UI_STATUS_LED )
+            ui_status_led_set( UI_STATUS_LED_REGISTERED );
+            #endif
             state_trigger_and_unlock( CONNECTED );
             break;
 
@@ -548,6 +563,47 @@ static void rd_client_event( struct lwm2m_ctx * client,
     }
 }
 
+/* Runs on the LwM2M engine thread: must not block, its duration is recorded */
+static void rd_client_event( struct lwm2m_ctx * client,
+                             enum lwm2m_rd_client_event client_event )
+{
+    static struct lwm2m_cb_timing timing = LWM2M_CB_TIMING_INIT( "rd_client_event" );
+    uint32_t start = k_cycle_get_32();
+
+    rd_client_event_process( client, client_event );
+    lwm2m_cb_timing_record( &timing, client_event, start );
+}
+
+static void observe_event( enum lwm2m_observe_event event,
+                           struct lwm2m_obj_path * path,
+                           void * user_data )
+{
+    ARG_UNUSED( user_data );
+
+    switch( event )
+    {
+        case LWM2M_OBSERVE_EVENT_OBSERVER_ADDED:
+        case LWM2M_OBSERVE_EVENT_OBSERVER_REMOVED:
+            LOG_DBG( "Observation of /%u/%u/%u %s", path->obj_id, path->obj_inst_id, path->res_id,
+                     ( event == LWM2M_OBSERVE_EVENT_OBSERVER_ADDED ) ? "added" : "removed" );
+            lwm2m_adaptive_lifetime_downlink();
+            break;
+
+        case LWM2M_OBSERVE_EVENT_NOTIFY_ACK:
+            lwm2m_input_latency_notified( path );
+            lwm2m_coalesce_notified( path );
+            break;
+
+        case LWM2M_OBSERVE_EVENT_NOTIFY_TIMEOUT:
+            lwm2m_coalesce_notified( path );
+            break;
+
+        default:
+            break;
+    }
+}
+
+#if !defined( CONFIG_APP_LWM2M_SIM )
 static void modem_connect( void )
 {
     int ret;
@@ -672,6 +728,7 @@ static void lte_notify_handler( const struct lte_lc_evt *const evt )
             break;
     }
 }
+#endif /* if !defined( CONFIG_APP_LWM2M_SIM ) */
 
 static void suspend_lwm2m_engine( void )
 {
@@ -696,16 +753,13 @@ int main( void )
 
     LOG_INF( APP_BANNER );
 
-    #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
-    configureLeds();
+    #if defined( CONFIG_UI_STATUS_LED )
+    ui_status_led_init();
     k_sleep( K_SECONDS( 10 ) );
+    ui_status_led_set( UI_STATUS_LED_STARTING );
+    #endif /* if defined( CONFIG_UI_STATUS_LED ) */
 
-    if( ledRed.port )
-    {
-        gpio_pin_set_dt( &ledRed, 100 );
-    }
-    #endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
-
+    #if !defined( CONFIG_APP_LWM2M_SIM )
     ret = nrf_modem_lib_init();
 
     if( ret < 0 )
@@ -713,6 +767,7 @@ int main( void )
         LOG_ERR( "Unable to init modem library (%d)", ret );
         return 0;
     }
+    #endif
 
     if( strlen( CONFIG_NCE_ICCID ) < 1 )
     {
@@ -728,6 +783,10 @@ int main( void )
         return 0;
     }
 
+    #if defined( CONFIG_APP_LWM2M_SIM )
+    /* The native_sim network interface is up before main() runs */
+    modem_connected_to_network = true;
+    #else
     lte_lc_register_handler( lte_notify_handler );
 
     ret = modem_info_init();
@@ -768,9 +827,20 @@ int main( void )
         LOG_ERR( "Failed to connect to the LTE network, err %d\n", ret );
         return ret;
     }
+    #endif /* if defined( CONFIG_APP_LWM2M_SIM ) */
 
     LOG_INF( "endpoint: %s", ( char * ) endpoint_name );
 
+    #if defined( CONFIG_APP_LWM2M_SETTINGS_WB )
+    /* Before the registration state is loaded */
+    ret = lwm2m_settings_wb_init();
+
+    if( ret )
+    {
+        LOG_WRN( "Settings write-back not registered, pending saves are not loaded (%d)", ret );
+    }
+    #endif
+
     /* Setup LwM2M */
     ret = lwm2m_setup();
 
@@ -780,11 +850,33 @@ int main( void )
         return 0;
     }
 
+    #if defined( CONFIG_APP_LWM2M_WARM_START )
+    lwm2m_reg_state_init( ( char * ) endpoint_name );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_SEND_HISTORY )
+    lwm2m_send_history_init( &client );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_ADAPTIVE_LIFETIME )
+    lwm2m_adaptive_lifetime_init( adaptive_update_lifetime );
+    #endif
+
+    #if defined( CONFIG_APP_LWM2M_FOTA )
+    ret = lwm2m_fota_init( &client );
+
+    if( ret )
+    {
+        LOG_WRN( "Firmware update not available (%d)", ret );
+    }
+    #endif
+
+    #if !defined( CONFIG_APP_LWM2M_SIM )
     modem_connect();
+    #endif
 
     #if defined( CONFIG_LWM2M_CLIENT_UTILS_SIGNAL_MEAS_INFO_OBJ_SUPPORT )
-    k_work_init_delayable( &ncell_meas_work, ncell_meas_work_handler );
-    k_work_schedule( &ncell_meas_work, K_SECONDS( 1 ) );
+    lwm2m_ncell_sched_init();
     #endif
     #if defined( CONFIG_LWM2M_CLIENT_UTILS_VISIBLE_WIFI_AP_OBJ_SUPPORT )
     k_work_init_delayable( &ground_fix_work, ground_fix_work_handler );
@@ -799,7 +891,9 @@ int main( void )
 
     while( true )
     {
-        #if defined( CONFIG_LWM2M_RD_CLIENT_SUPPORT_BOOTSTRAP )
+        #if defined( CONFIG_APP_LWM2M_WARM_START )
+        bootstrap_flags = lwm2m_reg_state_bootstrap_flags();
+        #elif defined( CONFIG_LWM2M_RD_CLIENT_SUPPORT_BOOTSTRAP )
         bootstrap_flags = LWM2M_RD_CLIENT_FLAG_BOOTSTRAP;
         #else
         bootstrap_flags = 0;
@@ -811,8 +905,11 @@ int main( void )
         {
             case START:
                 LOG_INF( "Client connect to server" );
+                #if defined( CONFIG_APP_LWM2M_BENCHMARK )
+                lwm2m_benchmark_client_start();
+                #endif
                 ret = lwm2m_rd_client_start( &client, endpoint_name, bootstrap_flags,
-                                             rd_client_event, NULL );
+                                             rd_client_event, observe_event );
 
                 if( ret )
                 {
@@ -828,21 +925,13 @@ int main( void )
             case BOOTSTRAP:
                 state_set_and_unlock( BOOTSTRAP );
                 LOG_INF( "LwM2M is bootstrapping" );
-                #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
-                if( ledRed.port )
-                {
-                    gpio_pin_set_dt( &ledRed, 0 );
-                }
-
-                if( ledBlue.port )
-                {
-                    gpio_pin_set_dt( &ledBlue, 100 );
-                }
-                #endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
+                #if defined( CONFIG_UI_STATUS_LED )
+                ui_status_led_set( UI_STATUS_LED_BOOTSTRAP );
+                #endif
                 break;
 
             case CONNECTING:
-                LOG_INF( "LwM2M is connecting to server (%s)", CONFIG_LWM2M_CLIENT_UTILS_SERVER );
+                LOG_INF( "LwM2M is connecting to server (%s)", LWM2M_SERVER_URI );
                 k_mutex_unlock( &lte_mutex );
                 break;
 
@@ -867,8 +956,10 @@ int main( void )
                     #if defined( CONFIG_APP_LWM2M_CONFORMANCE_TESTING )
                     lwm2m_register_server_send_mute_cb();
                     #endif
+                    #if defined( CONFIG_DATE_TIME )
                     /* Get current time and date */
                     date_time_update_async( date_time_event_handler );
+                    #endif
                 }
 
                 break;
@@ -907,6 +998,7 @@ int main( void )
                     LOG_INF( "LwM2M restart requested. The sample will try to"
                              " re-establish network connection." );
 
+                    #if !defined( CONFIG_APP_LWM2M_SIM )
                     /* Try to reconnect to the network. */
                     ret = lte_lc_offline();
 
@@ -917,6 +1009,7 @@ int main( void )
                     }
 
                     modem_connect();
+                    #endif
                 }
 
                 #if defined( CONFIG_APP_LWM2M_CONFORMANCE_TESTING )
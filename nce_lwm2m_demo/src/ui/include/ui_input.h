@@ -14,11 +14,10 @@ extern "C" {
 #endif
 
 /**
- * @brief Initialize the dk_buttons_and_leds library
- *        with a callback function that submits a ui input event
- *        when a input device's state changes.
- *        The DK buttons library interpret switch state changes as button state changes,
- *        and can thus be used for both.
+ * @brief Initialize the buttons and switches of the devicetree buttons node
+ *        to submit a ui input event when a input device's state changes.
+ *        Edges are timestamped in the GPIO interrupt and the state is read
+ *        after CONFIG_UI_INPUT_DEBOUNCE_MS without further edges.
  *
  * @return int 0 if successful, negative error code if not.
  */
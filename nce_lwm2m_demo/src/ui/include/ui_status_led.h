@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef UI_STATUS_LED_H__
+#define UI_STATUS_LED_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Connection state patterns shown on the status LEDs.
+ */
+enum ui_status_led_pattern
+{
+    UI_STATUS_LED_OFF,
+    UI_STATUS_LED_STARTING,   /* Red until the client starts bootstrapping */
+    UI_STATUS_LED_BOOTSTRAP,  /* Blue while bootstrapping */
+    UI_STATUS_LED_REGISTERED, /* Green for CONFIG_UI_STATUS_LED_REGISTERED_SECONDS, then off */
+};
+
+/**
+ * @brief Configure the status LED GPIOs. LEDs that are not ready are ignored.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_status_led_init( void );
+
+/**
+ * @brief Show a pattern on the status LEDs.
+ *
+ * Replaces the running pattern and returns right away, timed steps are
+ * applied from a kernel timer. Safe to call from LwM2M engine callbacks
+ * and interrupts.
+ *
+ * @param pattern Pattern to show.
+ */
+void ui_status_led_set( enum ui_status_led_pattern pattern );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UI_STATUS_LED_H__ */
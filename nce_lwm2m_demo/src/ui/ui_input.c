@@ -5,52 +5,166 @@
  */
 
 #include <zephyr/kernel.h>
-#include <dk_buttons_and_leds.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/math_extras.h>
+#include <zephyr/sys/util.h>
 
 #include "ui_input_event.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE( app_lwm2m_client, CONFIG_APP_LOG_LEVEL );
 
-/**
- * @brief Callback used by the DK buttons and LEDs library.
- *
- * Submits a ui input event when a input device changes states.
- * The input device can either be a push-button or a on/off-switch.
- *
- * @param device_states Bitmask containing the devices' state,
- * i.e. bit 1 corresponds to the state of device 1 etc.
- * @param has_changed Bitmask indicating whether the devices' state has
- * changed, i.e. bit 1 high corresponds to a change in the state
- * of device 1.
- */
-static void dk_input_device_event_handler( uint32_t device_states,
-                                           uint32_t has_changed )
+#define BUTTONS_NODE    DT_PATH( buttons )
+
+#define GPIO_SPEC_AND_COMMA( button )    GPIO_DT_SPEC_GET( button, gpios ),
+
+/* Device N is buttons[ N - 1 ], in the order of the DK buttons library */
+static const struct gpio_dt_spec buttons[] =
+{
+#if DT_NODE_EXISTS( BUTTONS_NODE )
+    DT_FOREACH_CHILD( BUTTONS_NODE, GPIO_SPEC_AND_COMMA )
+#endif
+};
+
+BUILD_ASSERT( ARRAY_SIZE( buttons ) < 32, "Device states do not fit the 32 bit masks" );
+
+static struct gpio_callback button_cb[ ARRAY_SIZE( buttons ) ];
+
+/* A debounced change of one device, as handed from the timer to the work item */
+struct input_transition
+{
+    uint8_t index;
+    bool state;
+    int64_t edge_ms;
+};
+
+/* Room for four changes per device before the work item runs */
+#define INPUT_QUEUE_LEN    ( 4 * ARRAY_SIZE( buttons ) )
+
+K_MSGQ_DEFINE( input_msgq, sizeof( struct input_transition ), INPUT_QUEUE_LEN, 8 );
+
+static struct k_spinlock lock;
+
+/* Protected by lock */
+static uint32_t bouncing;                              /* Edge seen, level not sampled yet */
+static uint32_t stable_states;                         /* Level after the last debounce */
+static int64_t edge_ms[ ARRAY_SIZE( buttons ) ];       /* Uptime of the first edge of a change */
+
+static atomic_t dropped;                               /* Changes lost to a full queue */
+
+static void debounce_timer_handler( struct k_timer * timer );
+static void input_work_handler( struct k_work * work );
+
+K_TIMER_DEFINE( debounce_timer, debounce_timer_handler, NULL );
+static K_WORK_DEFINE( input_work, input_work_handler );
+
+/* Returns the devices whose level is set, from the devices in mask */
+static uint32_t input_sample( uint32_t mask )
 {
-    uint8_t dev_num;
+    uint32_t states = 0;
 
-    while( has_changed )
+    for( ; mask; mask &= mask - 1)
     {
-        dev_num = 0;
+        uint32_t i = u32_count_trailing_zeros( mask );
 
-        /* Get bit position for next device that changed state. */
-        for(uint8_t i = 0; i < 32; i++)
+        if( gpio_pin_get_dt( &buttons[ i ] ) > 0 )
         {
-            if( has_changed & BIT( i ) )
-            {
-                dev_num = i + 1;
-                break;
-            }
+            states |= BIT( i );
         }
+    }
+
+    return states;
+}
+
+/* GPIO interrupt: timestamps the edge, the level is read once it is stable */
+static void button_isr( const struct device * port,
+                        struct gpio_callback * cb,
+                        gpio_port_pins_t pins )
+{
+    uint32_t i = cb - button_cb;
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    ARG_UNUSED( port );
+    ARG_UNUSED( pins );
+
+    /* Bounces keep the time of the first edge, queued changes carry their own */
+    if( !( bouncing & BIT( i ) ) )
+    {
+        edge_ms[ i ] = k_uptime_get();
+    }
+
+    bouncing |= BIT( i );
+
+    /* Restarted by every edge, expires once all inputs are quiet */
+    k_timer_start( &debounce_timer, K_MSEC( CONFIG_UI_INPUT_DEBOUNCE_MS ), K_NO_WAIT );
+    k_spin_unlock( &lock, key );
+}
+
+static void debounce_timer_handler( struct k_timer * timer )
+{
+    struct input_transition transitions[ ARRAY_SIZE( buttons ) ];
+    size_t count = 0;
+    k_spinlock_key_t key = k_spin_lock( &lock );
+    uint32_t states = input_sample( bouncing );
+    /* Glitches back to the stable level are dropped here */
+    uint32_t changed = ( states ^ stable_states ) & bouncing;
+
+    ARG_UNUSED( timer );
+
+    stable_states = ( stable_states & ~bouncing ) | states;
+    bouncing = 0;
+
+    /* Lowest device first */
+    for( ; changed; changed &= changed - 1)
+    {
+        uint32_t i = u32_count_trailing_zeros( changed );
+
+        transitions[ count ].index = i;
+        transitions[ count ].state = ( states & BIT( i ) );
+        transitions[ count ].edge_ms = edge_ms[ i ];
+        count++;
+    }
+
+    k_spin_unlock( &lock, key );
 
-        if( dev_num == 0 )
+    /* Every change is queued, a change still waiting for the work item is not folded into it */
+    for(size_t i = 0; i < count; i++)
+    {
+        if( k_msgq_put( &input_msgq, &transitions[ i ], K_NO_WAIT ) )
         {
-            return;
+            atomic_inc( &dropped );
         }
+    }
+
+    /* Events are allocated and submitted in thread context */
+    if( count > 0 )
+    {
+        k_work_submit( &input_work );
+    }
+}
+
+/**
+ * @brief Submits a ui input event per debounced change, in the order they happened.
+ *
+ * The input device can either be a push-button or a on/off-switch.
+ * Device 1 and 2 are push-buttons, device 3 and 4 on/off-switch 1 and 2.
+ */
+static void input_work_handler( struct k_work * work )
+{
+    struct input_transition transition;
+    atomic_val_t lost = atomic_clear( &dropped );
+
+    ARG_UNUSED( work );
 
-        /* Device number has been stored, remove from bitmask. */
-        has_changed &= ~( 1UL << ( dev_num - 1 ) );
+    if( lost > 0 )
+    {
+        LOG_WRN( "%ld input changes dropped, queue full", ( long ) lost );
+    }
 
+    while( k_msgq_get( &input_msgq, &transition, K_NO_WAIT ) == 0 )
+    {
+        uint8_t dev_num = transition.index + 1;
         struct ui_input_event * event = new_ui_input_event();
 
         event->type = dev_num > 2 ? ON_OFF_SWITCH : PUSH_BUTTON;
@@ -64,7 +178,8 @@ static void dk_input_device_event_handler( uint32_t device_states,
             event->device_number = dev_num;
         }
 
-        event->state = ( device_states & BIT( dev_num - 1 ) );
+        event->state = transition.state;
+        event->timestamp = transition.edge_ms;
 
         APP_EVENT_SUBMIT( event );
     }
@@ -73,19 +188,54 @@ static void dk_input_device_event_handler( uint32_t device_states,
 int ui_input_init( void )
 {
     static bool initialised;
+    int ret;
 
-    if( !initialised )
+    if( initialised )
     {
-        int ret = dk_buttons_init( dk_input_device_event_handler );
+        return 0;
+    }
+
+    for(size_t i = 0; i < ARRAY_SIZE( buttons ); i++)
+    {
+        if( !gpio_is_ready_dt( &buttons[ i ] ) )
+        {
+            LOG_ERR( "Button %u GPIO not ready", i + 1 );
+            return -ENODEV;
+        }
+
+        ret = gpio_pin_configure_dt( &buttons[ i ], GPIO_INPUT );
 
         if( ret )
         {
-            LOG_ERR( "Could not initialize buttons (%d)", ret );
+            LOG_ERR( "Could not configure button %u (%d)", i + 1, ret );
             return ret;
         }
 
-        initialised = true;
+        gpio_init_callback( &button_cb[ i ], button_isr, BIT( buttons[ i ].pin ) );
+        ret = gpio_add_callback_dt( &buttons[ i ], &button_cb[ i ] );
+
+        if( ret )
+        {
+            LOG_ERR( "Could not add button %u callback (%d)", i + 1, ret );
+            return ret;
+        }
     }
 
+    /* Switches report changes from their position at boot */
+    stable_states = input_sample( BIT_MASK( ARRAY_SIZE( buttons ) ) );
+
+    for(size_t i = 0; i < ARRAY_SIZE( buttons ); i++)
+    {
+        ret = gpio_pin_interrupt_configure_dt( &buttons[ i ], GPIO_INT_EDGE_BOTH );
+
+        if( ret )
+        {
+            LOG_ERR( "Could not enable button %u interrupt (%d)", i + 1, ret );
+            return ret;
+        }
+    }
+
+    initialised = true;
+
     return 0;
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025 1NCE GmbH
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/util.h>
+
+#include "ui_status_led.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE( app_lwm2m_client, CONFIG_APP_LOG_LEVEL );
+
+#define STATUS_LED_RED      BIT( 0 )
+#define STATUS_LED_GREEN    BIT( 1 )
+#define STATUS_LED_BLUE     BIT( 2 )
+
+/* One step of a pattern, a duration of 0 holds the step until the next request */
+struct status_led_step
+{
+    uint8_t leds;
+    uint32_t duration_ms;
+};
+
+#define PATTERN_MAX_STEPS    2
+
+static const struct status_led_step patterns[][ PATTERN_MAX_STEPS ] =
+{
+    [ UI_STATUS_LED_OFF ] =        { { 0, 0 } },
+    [ UI_STATUS_LED_STARTING ] =   { { STATUS_LED_RED, 0 } },
+    [ UI_STATUS_LED_BOOTSTRAP ] =  { { STATUS_LED_BLUE, 0 } },
+    [ UI_STATUS_LED_REGISTERED ] = { { STATUS_LED_GREEN, CONFIG_UI_STATUS_LED_REGISTERED_SECONDS * MSEC_PER_SEC },
+                                     { 0, 0 } },
+};
+
+static struct gpio_dt_spec leds[] =
+{
+    GPIO_DT_SPEC_GET_OR( DT_ALIAS( led0 ), gpios, { 0 } ),
+    GPIO_DT_SPEC_GET_OR( DT_ALIAS( led1 ), gpios, { 0 } ),
+    GPIO_DT_SPEC_GET_OR( DT_ALIAS( led2 ), gpios, { 0 } ),
+};
+
+static struct k_spinlock lock;
+static enum ui_status_led_pattern current_pattern;
+static uint8_t current_step;
+
+static void status_led_timer_handler( struct k_timer * timer );
+
+K_TIMER_DEFINE( status_led_timer, status_led_timer_handler, NULL );
+
+/* Apply the current step and arm the timer for the next one, must be called with the lock held */
+static void status_led_apply_step( void )
+{
+    const struct status_led_step * step = &patterns[ current_pattern ][ current_step ];
+
+    for(size_t i = 0; i < ARRAY_SIZE( leds ); ++i)
+    {
+        if( leds[ i ].port )
+        {
+            gpio_pin_set_dt( &leds[ i ], ( step->leds & BIT( i ) ) ? 1 : 0 );
+        }
+    }
+
+    if( ( step->duration_ms > 0 ) && ( current_step + 1 < PATTERN_MAX_STEPS ) )
+    {
+        k_timer_start( &status_led_timer, K_MSEC( step->duration_ms ), K_NO_WAIT );
+    }
+}
+
+static void status_led_timer_handler( struct k_timer * timer )
+{
+    k_spinlock_key_t key = k_spin_lock( &lock );
+
+    current_step++;
+    status_led_apply_step();
+
+    k_spin_unlock( &lock, key );
+}
+
+void ui_status_led_set( enum ui_status_led_pattern pattern )
+{
+    k_spinlock_key_t key;
+
+    if( pattern >= ARRAY_SIZE( patterns ) )
+    {
+        return;
+    }
+
+    key = k_spin_lock( &lock );
+
+    k_timer_stop( &status_led_timer );
+    current_pattern = pattern;
+    current_step = 0;
+    status_led_apply_step();
+
+    k_spin_unlock( &lock, key );
+}
+
+int ui_status_led_init( void )
+{
+    int ret;
+
+    for(size_t i = 0; i < ARRAY_SIZE( leds ); ++i)
+    {
+        if( leds[ i ].port && !device_is_ready( leds[ i ].port ) )
+        {
+            LOG_ERR( "LED device %s is not ready; ignoring it", leds[ i ].port->name );
+            leds[ i ].port = NULL;
+        }
+
+        if( leds[ i ].port )
+        {
+            ret = gpio_pin_configure_dt( &leds[ i ], GPIO_OUTPUT_INACTIVE );
+
+            if( ret )
+            {
+                LOG_ERR( "Error %d: failed to configure LED device %s pin %d",
+                         ret, leds[ i ].port->name, leds[ i ].pin );
+                leds[ i ].port = NULL;
+            }
+        }
+    }
+
+    return 0;
+}
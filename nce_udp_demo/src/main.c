@@ -22,7 +22,12 @@
 #include <modem/lte_lc.h>
 #include <modem/nrf_modem_lib.h>
 #include <zephyr/net/socket.h>
+#include <zephyr/random/random.h>
 #include <nce_iot_c_sdk.h>
+#include "uplink_queue.h"
+#if defined( CONFIG_NCE_NAT_KEEPALIVE )
+    #include "nat_keepalive.h"
+#endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
 #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
     #include <zephyr/drivers/gpio.h>
 
@@ -57,11 +62,40 @@ struct k_thread uplink_thread;
 static int uplink_fd = -1;
 static K_SEM_DEFINE( lte_connected_sem, 0, 1 );
 
+/** @brief Network registration state, uplink sending pauses while it is false. */
+static bool is_registered;
+static bool network_lost;
+static int64_t network_restored_at;
+static uint32_t network_recovery_count;
+static int64_t network_recovery_total_ms;
+K_MUTEX_DEFINE( network_lock );
+K_CONDVAR_DEFINE( network_registered );
+
 #if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER )
-    #define DOWNLINK_STACK_SIZE    1024
+    #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+        #define DOWNLINK_STACK_SIZE         2048
+    #else
+        #define DOWNLINK_STACK_SIZE         1024
+    #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
+    #define DOWNLINK_WORKER_STACK_SIZE      1024
+    #define DOWNLINK_WORKER_PRIORITY        ( THREAD_PRIORITY + 1 )
 K_THREAD_STACK_DEFINE( downlink_thread_stack, DOWNLINK_STACK_SIZE );
 struct k_thread downlink_thread;
+K_THREAD_STACK_DEFINE( downlink_worker_stack, DOWNLINK_WORKER_STACK_SIZE );
+struct k_thread downlink_worker;
 static int downlink_fd = -1;
+
+/** @brief Received downlink message waiting for the worker. */
+struct downlink_msg
+{
+    int64_t received_at;
+    uint16_t len;
+    char data[ CONFIG_NCE_RECEIVE_BUFFER_SIZE ];
+};
+
+K_MSGQ_DEFINE( downlink_queue, sizeof( struct downlink_msg ), CONFIG_NCE_DOWNLINK_QUEUE_DEPTH, 4 );
+static uint32_t downlink_dropped_count;  /**< Messages dropped because the queue was full. */
+static uint32_t downlink_overflow_count; /**< Messages that filled the receive buffer and may be truncated. */
 #endif
 
 /******************************************************************************
@@ -135,6 +169,95 @@ void configureLeds()
 }
 #endif /* if defined( CONFIG_BOARD_THINGY91_NRF9160_NS ) */
 
+/**
+ * @brief Updates the network registration state and wakes up the uplink.
+ *
+ * @param registered Whether the device is registered to the network.
+ */
+static void network_state_set( bool registered )
+{
+    k_mutex_lock( &network_lock, K_FOREVER );
+
+    if( registered && network_lost )
+    {
+        network_lost = false;
+        network_restored_at = k_uptime_get();
+    }
+    else if( !registered && is_registered )
+    {
+        network_lost = true;
+    }
+
+    is_registered = registered;
+
+    if( registered )
+    {
+        k_condvar_broadcast( &network_registered );
+    }
+
+    k_mutex_unlock( &network_lock );
+}
+
+/**
+ * @brief Blocks until the device is registered to the network.
+ */
+static void wait_for_network( void )
+{
+    k_mutex_lock( &network_lock, K_FOREVER );
+
+    if( !is_registered )
+    {
+        LOG_INF( "Network down, uplink paused" );
+    }
+
+    while( !is_registered )
+    {
+        k_condvar_wait( &network_registered, &network_lock, K_FOREVER );
+    }
+
+    k_mutex_unlock( &network_lock );
+}
+
+/**
+ * @brief Returns whether the device is registered to the network.
+ */
+static bool network_is_registered( void )
+{
+    bool registered;
+
+    k_mutex_lock( &network_lock, K_FOREVER );
+    registered = is_registered;
+    k_mutex_unlock( &network_lock );
+
+    return registered;
+}
+
+/**
+ * @brief Logs the time from registration returning to the first successful uplink.
+ */
+static void uplink_recovery_report( void )
+{
+    int64_t elapsed = -1;
+
+    k_mutex_lock( &network_lock, K_FOREVER );
+
+    if( network_restored_at > 0 )
+    {
+        elapsed = k_uptime_get() - network_restored_at;
+        network_restored_at = 0;
+        network_recovery_count++;
+        network_recovery_total_ms += elapsed;
+    }
+
+    k_mutex_unlock( &network_lock );
+
+    if( elapsed >= 0 )
+    {
+        LOG_INF( "First uplink %lld ms after the network returned (mean %lld ms over %u recoveries)",
+                 elapsed, network_recovery_total_ms / network_recovery_count, network_recovery_count );
+    }
+}
+
 /**
  * @brief Handles LTE network events.
  *
@@ -149,11 +272,14 @@ static void lte_handler( const struct lte_lc_evt *const evt )
             if( ( evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_HOME ) &&
                 ( evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_ROAMING ) )
             {
+                LOG_INF( "Network registration lost, status: %d", evt->nw_reg_status );
+                network_state_set( false );
                 break;
             }
 
             LOG_INF( "Network registration status: %s",
                      evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME ? "Connected - home" : "Connected - roaming" );
+            network_state_set( true );
             k_sem_give( &lte_connected_sem );
             break;
 
@@ -193,6 +319,46 @@ static void lte_handler( const struct lte_lc_evt *const evt )
     }
 }
 
+/**
+ * @brief Takes a periodic sample and queues it with a time-to-live.
+ *
+ * @param work Sample work item.
+ */
+static void uplink_sample_work_fn( struct k_work * work )
+{
+    int err;
+
+    k_work_reschedule( k_work_delayable_from_work( work ), K_SECONDS( CONFIG_UDP_DATA_UPLOAD_FREQUENCY_SECONDS ) );
+
+    #if !defined( CONFIG_NCE_ENERGY_SAVER )
+    char buffer[] = CONFIG_PAYLOAD;
+    LOG_INF( "Payload (string): %s", buffer );
+    #else
+    char buffer[ CONFIG_PAYLOAD_DATA_SIZE ];
+
+    Element2byte_gen_t battery_level = { .type = E_INTEGER, .value.i = 99, .template_length = 1 };
+    Element2byte_gen_t signal_strength = { .type = E_INTEGER, .value.i = 84, .template_length = 1 };
+    Element2byte_gen_t software_version = { .type = E_STRING, .value.s = "2.2.1", .template_length = 5 };
+    err = os_energy_save( buffer, 1, 3, battery_level, signal_strength, software_version );
+
+    if( err < 0 )
+    {
+        LOG_ERR( "Failed to save energy, %d", errno );
+    }
+
+    LOG_HEXDUMP_INF( buffer, sizeof( buffer ), "Payload (binary):" );
+    #endif /* if !defined( CONFIG_NCE_ENERGY_SAVER ) */
+    err = uplink_queue_put( UPLINK_PRIORITY_NORMAL, CONFIG_NCE_UPLINK_SAMPLE_TTL_SECONDS, 0, buffer,
+                            sizeof( buffer ) - 1 );
+
+    if( err )
+    {
+        LOG_ERR( "Failed to queue uplink sample, err %d", err );
+    }
+}
+
+static K_WORK_DELAYABLE_DEFINE( uplink_sample_work, uplink_sample_work_fn );
+
 /**
  * @brief Thread function handling outgoing UDP packets.
  */
@@ -201,8 +367,8 @@ void uplink_thread_fn( void * p1,
                        void * p3 )
 {
     int err;
-    const int MAX_RETRIES = 5;
-    int retry_count = 0;
+    int backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
+    static struct uplink_msg msg;
     struct addrinfo * res;
     struct addrinfo hints =
     {
@@ -211,7 +377,11 @@ void uplink_thread_fn( void * p1,
     };
 
     LOG_INF( "Uplink thread started..." );
+
+    /* Samples are taken on schedule even while the uplink is down */
+    k_work_schedule( &uplink_sample_work, K_NO_WAIT );
 connect_retry:
+    wait_for_network();
     err = zsock_getaddrinfo( CONFIG_UDP_SERVER_HOSTNAME, NULL, &hints, &res );
 
     if( err < 0 )
@@ -248,35 +418,30 @@ connect_retry:
     LOG_INF( "Hostname %s, port number %d",
              CONFIG_UDP_SERVER_HOSTNAME,
              CONFIG_UDP_SERVER_PORT );
-    retry_count = 0;
 
     while( 1 )
     {
-        #if !defined( CONFIG_NCE_ENERGY_SAVER )
-        char buffer[] = CONFIG_PAYLOAD;
-        LOG_INF( "Payload (string): %s", buffer );
-        #else
-        char buffer[ CONFIG_PAYLOAD_DATA_SIZE ];
+        wait_for_network();
 
-        Element2byte_gen_t battery_level = { .type = E_INTEGER, .value.i = 99, .template_length = 1 };
-        Element2byte_gen_t signal_strength = { .type = E_INTEGER, .value.i = 84, .template_length = 1 };
-        Element2byte_gen_t software_version = { .type = E_STRING, .value.s = "2.2.1", .template_length = 5 };
-        err = os_energy_save( buffer, 1, 3, battery_level, signal_strength, software_version );
+        /* Wait for the next sample or an alarm, whichever comes first */
+        uplink_queue_get( &msg, K_FOREVER );
 
-        if( err < 0 )
+        if( !network_is_registered() )
         {
-            LOG_ERR( "Failed to save energy, %d", errno );
+            /* Keep the message until the network returns or it expires */
+            uplink_queue_putback( &msg );
+            continue;
         }
 
-        LOG_INF( "Transmitting UDP/IP payload of %d bytes to the server %s:%d",
-                 CONFIG_PAYLOAD_DATA_SIZE + UDP_IP_HEADER_SIZE, CONFIG_UDP_SERVER_HOSTNAME, CONFIG_UDP_SERVER_PORT );
-        LOG_HEXDUMP_INF( buffer, sizeof( buffer ), "Payload (binary):" );
-        #endif /* if !defined( CONFIG_NCE_ENERGY_SAVER ) */
-        err = zsock_send( uplink_fd, buffer, sizeof( buffer ) - 1, 0 );
+        LOG_INF( "Transmitting %s UDP/IP payload of %zu bytes to the server %s:%d, queued %lld ms ago",
+                 ( msg.priority == UPLINK_PRIORITY_ALARM ) ? "alarm" : "periodic", msg.len + UDP_IP_HEADER_SIZE,
+                 CONFIG_UDP_SERVER_HOSTNAME, CONFIG_UDP_SERVER_PORT, k_uptime_get() - msg.enqueued_at );
+        err = zsock_send( uplink_fd, msg.data, msg.len, 0 );
 
         if( err < 0 )
         {
             LOG_ERR( "Send failed (errno: %d), reconnecting...", errno );
+            uplink_queue_putback( &msg );
             zsock_close( uplink_fd );
             uplink_fd = -1;
             goto wait_and_retry;
@@ -284,6 +449,12 @@ connect_retry:
         else
         {
             LOG_INF( "UDP packet sent (%d bytes)", err );
+            uplink_queue_release( &msg );
+            backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
+            uplink_recovery_report();
+            #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+            nat_keepalive_uplink_sent();
+            #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
             #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
             if( ledBlue.port )
             {
@@ -296,31 +467,21 @@ connect_retry:
             }
             #endif
         }
-
-        k_sleep( K_SECONDS( CONFIG_UDP_DATA_UPLOAD_FREQUENCY_SECONDS ) );
     }
 
 wait_and_retry:
-    retry_count++;
 
-    if( retry_count < MAX_RETRIES )
+    if( !network_is_registered() )
     {
-        LOG_WRN( "Retrying uplink (%d/%d)...", retry_count, MAX_RETRIES );
-        k_sleep( K_SECONDS( 5 ) );
+        /* Reconnect as soon as the network returns */
+        backoff_s = CONFIG_NCE_UPLINK_BACKOFF_INITIAL_SECONDS;
         goto connect_retry;
     }
-    else
-    {
-        LOG_ERR( " Max uplink retries reached. Stopping thread." );
-
-        if( uplink_fd > 0 )
-        {
-            zsock_close( uplink_fd );
-            uplink_fd = -1;
-        }
 
-        return;
-    }
+    LOG_WRN( "Retrying uplink in %d s", backoff_s );
+    k_sleep( K_MSEC( backoff_s * MSEC_PER_SEC + sys_rand32_get() % MSEC_PER_SEC ) );
+    backoff_s = MIN( backoff_s * 2, CONFIG_NCE_UPLINK_BACKOFF_MAX_SECONDS );
+    goto connect_retry;
 }
 
 #if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER )
@@ -332,7 +493,7 @@ void downlink_thread_fn( void * p1,
                          void * p2,
                          void * p3 )
 {
-    char buffer[ 256 ];
+    static struct downlink_msg msg;
     struct sockaddr_in my_addr =
     {
         .sin_family      = AF_INET,
@@ -380,9 +541,16 @@ retry_downlink:
 
     retry_count = 0;
 
+    #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+    if( nat_keepalive_start( downlink_fd ) != 0 )
+    {
+        LOG_WRN( "NAT keepalive not started" );
+    }
+    #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
+
     while( 1 )
     {
-        ssize_t received_bytes = zsock_recvfrom( downlink_fd, buffer, sizeof( buffer ) - 1, 0,
+        ssize_t received_bytes = zsock_recvfrom( downlink_fd, msg.data, sizeof( msg.data ) - 1, 0,
                                                  ( struct sockaddr * ) &sender_addr, &sender_addr_len );
 
         if( received_bytes < 0 )
@@ -395,14 +563,39 @@ retry_downlink:
             else
             {
                 LOG_ERR( "recvfrom() failed, errno: %d", errno );
+                #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+                nat_keepalive_stop();
+                #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
                 zsock_close( downlink_fd );
                 downlink_fd = -1;
                 goto wait_and_retry;
             }
         }
 
-        buffer[ received_bytes ] = '\0';
-        LOG_INF( "Received message: %s", buffer );
+        #if defined( CONFIG_NCE_NAT_KEEPALIVE )
+        if( nat_keepalive_rx( ( struct sockaddr * ) &sender_addr, ( const uint8_t * ) msg.data, received_bytes ) )
+        {
+            continue;
+        }
+        #endif /* if defined( CONFIG_NCE_NAT_KEEPALIVE ) */
+
+        if( received_bytes == sizeof( msg.data ) - 1 )
+        {
+            downlink_overflow_count++;
+            LOG_WRN( "Downlink message fills the receive buffer, it may be truncated (%u so far)",
+                     downlink_overflow_count );
+        }
+
+        /* Hand the message over and return to recvfrom() right away */
+        msg.data[ received_bytes ] = '\0';
+        msg.len = received_bytes;
+        msg.received_at = k_uptime_get();
+
+        if( k_msgq_put( &downlink_queue, &msg, K_NO_WAIT ) != 0 )
+        {
+            downlink_dropped_count++;
+            LOG_WRN( "Downlink queue full, message dropped (%u so far)", downlink_dropped_count );
+        }
     }
 
 wait_and_retry:
@@ -427,6 +620,23 @@ wait_and_retry:
         return;
     }
 }
+
+/**
+ * @brief Thread function processing the queued downlink messages.
+ */
+void downlink_worker_fn( void * p1,
+                         void * p2,
+                         void * p3 )
+{
+    static struct downlink_msg msg;
+
+    while( 1 )
+    {
+        k_msgq_get( &downlink_queue, &msg, K_FOREVER );
+        LOG_INF( "Received message (%u bytes, queued %lld ms): %s",
+                 msg.len, k_uptime_get() - msg.received_at, msg.data );
+    }
+}
 #endif /* if defined( CONFIG_NCE_ENABLE_DEVICE_CONTROLLER ) */
 
 /******************************************************************************
@@ -481,6 +691,12 @@ int main( void )
                                             NULL, NULL, NULL,
                                             THREAD_PRIORITY, 0, K_NO_WAIT );
     k_thread_name_set( downlink_tid, "downlink_thread" );
+    k_tid_t worker_tid = k_thread_create( &downlink_worker, downlink_worker_stack,
+                                          K_THREAD_STACK_SIZEOF( downlink_worker_stack ),
+                                          downlink_worker_fn,
+                                          NULL, NULL, NULL,
+                                          DOWNLINK_WORKER_PRIORITY, 0, K_NO_WAIT );
+    k_thread_name_set( worker_tid, "downlink_worker" );
     #endif
     k_tid_t uplink_tid = k_thread_create( &uplink_thread, uplink_thread_stack,
                                           K_THREAD_STACK_SIZEOF( uplink_thread_stack ),
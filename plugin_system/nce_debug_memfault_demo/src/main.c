@@ -41,8 +41,9 @@
     #include <modem/modem_key_mgmt.h>
     #include <nrf_modem_at.h>
     #include <zephyr/net/tls_credentials.h>
-    #define MAX_PSK_SIZE    100
-extern void sys_arch_reboot( int type );
+    #include <zephyr/settings/settings.h>
+    #define MAX_PSK_SIZE               100
+    #define ONBOARDING_SETTINGS_KEY    "nce/onboarding"
 #endif /* if defined( CONFIG_NCE_MEMFAULT_DEMO_ENABLE_DTLS ) */
 
 #if defined( CONFIG_BOARD_THINGY91_NRF9160_NS )
@@ -76,6 +77,15 @@ const sec_tag_t tls_sec_tag[] =
     CONFIG_NCE_SDK_DTLS_SECURITY_TAG,
 };
 DtlsKey_t nceKey = { 0 };
+
+/* Onboarding progress, persisted so an interrupted credential update is redone on the next boot */
+enum onboarding_state
+{
+    ONBOARDING_STATE_IDLE = 0,
+    ONBOARDING_STATE_IN_PROGRESS,
+    ONBOARDING_STATE_DONE,
+};
+static uint8_t onboarding_state = ONBOARDING_STATE_IDLE;
 #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
 
 /* LTE event handler */
@@ -430,9 +440,61 @@ int store_credentials( void )
     return err;
 }
 
+/* Settings loader for the persisted onboarding state */
+static int prv_onboarding_state_load_cb( const char * key,
+                                         size_t len,
+                                         settings_read_cb read_cb,
+                                         void * cb_arg,
+                                         void * param )
+{
+    ssize_t ret;
+
+    if( len != sizeof( onboarding_state ) )
+    {
+        return -EINVAL;
+    }
+
+    ret = read_cb( cb_arg, &onboarding_state, sizeof( onboarding_state ) );
+
+    return ( ret < 0 ) ? ( int ) ret : 0;
+}
+
+/* Load the persisted onboarding state, defaults to idle when nothing is stored */
+static int prv_onboarding_state_load( void )
+{
+    int err;
+
+    err = settings_subsys_init();
+
+    if( err )
+    {
+        LOG_ERR( "Failed to initialize settings, err %d", err );
+        return err;
+    }
+
+    return settings_load_subtree_direct( ONBOARDING_SETTINGS_KEY, prv_onboarding_state_load_cb, NULL );
+}
+
+/* Persist the onboarding state */
+static void prv_onboarding_state_save( enum onboarding_state state )
+{
+    int err;
+
+    onboarding_state = state;
+    err = settings_save_one( ONBOARDING_SETTINGS_KEY, &onboarding_state, sizeof( onboarding_state ) );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to persist onboarding state %d, err %d", state, err );
+    }
+}
+
 /**
  * @brief Onboard the device by managing DTLS credentials.
  *
+ * Credentials are written while the modem is offline, then the LTE connection is
+ * re-established without rebooting.
+ *
  * @param[in] overwrite Whether to overwrite existing credentials, should be set to true when DTLS connecting is failing.
  * @return 0 on success, negative error code on failure.
  */
@@ -442,9 +504,16 @@ static int prv_onboard_device( bool overwrite )
     /* Unless "overwrite" is true,  */
     int err;
     bool exists;
+    int64_t onboarding_start = k_uptime_get();
 
     err = modem_key_mgmt_exists( CONFIG_NCE_SDK_DTLS_SECURITY_TAG, MODEM_KEY_MGMT_CRED_TYPE_PSK, &exists );
 
+    if( ( prv_onboarding_state_load() == 0 ) && ( onboarding_state == ONBOARDING_STATE_IN_PROGRESS ) )
+    {
+        LOG_WRN( "Previous onboarding was interrupted, onboarding again" );
+        overwrite = true;
+    }
+
     if( overwrite || !exists )
     {
         struct OSNetwork xOSNetwork = { .os_socket = 0 };
@@ -457,6 +526,7 @@ static int prv_onboard_device( bool overwrite )
             .nce_os_udp_disconnect = nce_os_disconnect
         };
 
+        prv_onboarding_state_save( ONBOARDING_STATE_IN_PROGRESS );
 
         err = os_auth( &osNetwork, &nceKey );
 
@@ -481,12 +551,26 @@ static int prv_onboard_device( bool overwrite )
         if( err )
         {
             LOG_ERR( "Failed to store credentials, err %d\n", errno );
+        }
+
+        /* Go back online even if storing failed, the persisted state retries onboarding later */
+        if( lte_lc_connect() )
+        {
+            LOG_ERR( "Failed to reconnect to the LTE network\n" );
+            return -ENETUNREACH;
+        }
+
+        /* The registration event was consumed by this reconnect, the caller continues from here */
+        k_sem_reset( &lte_connected_sem );
+
+        if( err )
+        {
             return err;
         }
 
-        LOG_INF( "Rebooting to ensure changes take effect after saving credentials.." );
+        prv_onboarding_state_save( ONBOARDING_STATE_DONE );
 
-        sys_arch_reboot( 0 );
+        LOG_INF( "Onboarding completed in %lld ms without reboot", k_uptime_get() - onboarding_start );
     }
     else
     {
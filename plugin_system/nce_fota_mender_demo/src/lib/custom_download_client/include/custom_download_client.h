@@ -24,6 +24,10 @@
 #include <zephyr/types.h>
 #include <zephyr/net/coap.h>
 
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    #include <coap_stats.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -176,6 +180,17 @@ struct download_client
 
         /** CoAP pending object. */
         struct coap_pending pending;
+
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+        /** RTT and retransmission statistics of the host. */
+        struct coap_stats * stats;
+        /** Uptime when the pending request was first sent. */
+        int64_t sent_at;
+        /** Uptime when the pending request was last retransmitted. */
+        int64_t resent_at;
+        /** Number of retransmissions of the pending request. */
+        uint8_t retransmissions;
+#endif
     }
     coap;
 
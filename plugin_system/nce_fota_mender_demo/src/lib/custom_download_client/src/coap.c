@@ -94,6 +94,9 @@ int coap_initiate_retransmission( struct download_client * dl )
     if( !coap_pending_cycle( &dl->coap.pending ) )
     {
         LOG_ERR( "CoAP max-retransmissions exceeded" );
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+        coap_stats_timeout( dl->coap.stats );
+#endif
         return -1;
     }
 
@@ -197,6 +200,21 @@ int coap_parse( struct download_client * client,
 
     coap_pending_clear( &client->coap.pending );
 
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    if( client->coap.retransmissions == 0 )
+    {
+        coap_stats_rx( client->coap.stats, len, ( int32_t ) ( k_uptime_get() - client->coap.sent_at ) );
+    }
+    else
+    {
+        /* Karn's algorithm: the answered transmission is ambiguous, feed the weak estimator only */
+        coap_stats_rx_retransmitted( client->coap.stats, len,
+                                     ( uint32_t ) ( k_uptime_get() - client->coap.sent_at ),
+                                     ( uint32_t ) ( k_uptime_get() - client->coap.resent_at ),
+                                     client->coap.retransmissions );
+    }
+#endif
+
     if( coap_header_get_type( &response ) != COAP_TYPE_ACK )
     {
         LOG_ERR( "Response must be of coap type ACK" );
@@ -244,8 +262,9 @@ int coap_request_send( struct download_client * client )
     char * path_elem;
     char * path_elem_saveptr;
     struct coap_packet request;
+    bool retransmission = has_pending( client );
 
-    if( has_pending( client ) )
+    if( retransmission )
     {
         id = client->coap.pending.id;
     }
@@ -303,8 +322,15 @@ int coap_request_send( struct download_client * client )
 
     if( !has_pending( client ) )
     {
-        err = coap_pending_init( &client->coap.pending, &request, &client->remote_addr,
-                                 CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_MAX_RETRANSMIT_REQUEST_COUNT );
+        struct coap_transmission_parameters params = coap_get_transmission_parameters();
+
+        params.max_retransmission = CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_MAX_RETRANSMIT_REQUEST_COUNT;
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+        /* Initial timeout and backoff follow the RTT measured for the host */
+        coap_stats_rto_apply( client->coap.stats, &params );
+#endif
+
+        err = coap_pending_init( &client->coap.pending, &request, &client->remote_addr, &params );
 
         if( err < 0 )
         {
@@ -324,6 +350,21 @@ int coap_request_send( struct download_client * client )
         return err;
     }
 
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    coap_stats_tx( client->coap.stats, request.offset, retransmission );
+
+    if( retransmission )
+    {
+        client->coap.resent_at = k_uptime_get();
+        client->coap.retransmissions++;
+    }
+    else
+    {
+        client->coap.sent_at = k_uptime_get();
+        client->coap.retransmissions = 0;
+    }
+#endif
+
     if( IS_ENABLED( CONFIG_CUSTOM_DOWNLOAD_CLIENT_LOG_HEADERS ) )
     {
         LOG_HEXDUMP_DBG( request.data, request.offset, "CoAP request" );
@@ -942,6 +942,10 @@ int download_client_connect( struct download_client * client,
     client->config = *config;
     client->host = host;
 
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    client->coap.stats = coap_stats_get( host );
+#endif
+
     err = client_connect( client );
 
     if( client->fd < 0 )
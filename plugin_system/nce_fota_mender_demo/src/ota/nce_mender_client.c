@@ -13,6 +13,7 @@
 #include <custom_fota_download.h>
 #include <nrf_socket.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <zephyr/sys/reboot.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/kernel.h>
@@ -28,11 +29,20 @@
 #include <network_interface_zephyr.h>
 #include <modem/nrf_modem_lib.h>
 #include <zephyr/net/coap.h>
+#include <zephyr/sys/byteorder.h>
 #include "update.h"
 #include "nce_mender_client.h"
 #include "led_control.h"
 #include <zephyr/logging/log.h>
 
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    #include <coap_stats.h>
+#endif
+
+#if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    #include <write_back.h>
+#endif
+
 #if defined( CONFIG_NCE_ENABLE_DTLS )
     #include <modem/modem_key_mgmt.h>
     #include <nrf_modem_at.h>
@@ -77,6 +87,16 @@ struct addrinfo hints =
 
 static struct k_work_delayable nce_mender_work;
 
+/* Last proxy request, kept until its ACK arrives for retransmission */
+static uint8_t proxy_request[ MAX_COAP_MSG_LEN ];
+static size_t proxy_request_len;
+static uint16_t proxy_request_id;
+static int64_t proxy_request_sent_at;
+
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+static struct coap_stats * proxy_stats;
+#endif
+
 struct coap_packet response, request;
 
 #if defined( CONFIG_NCE_ENABLE_DTLS )
@@ -149,6 +169,9 @@ K_THREAD_DEFINE( led_thread, CONFIG_LED_THREAD_STACK_SIZE, led_animation_thread_
         } while( 0 )
 
 /* Static function declaration */
+static void nvs_record_write( uint16_t item,
+                              const void * value,
+                              size_t len );
 #if defined( CONFIG_NCE_ENABLE_DTLS )
 static int store_credentials( void );
 static int dtls_setup( int fd );
@@ -246,6 +269,30 @@ static int dtls_setup( int fd )
         return err;
     }
 
+    #if defined( CONFIG_NCE_DTLS_CID )
+    /* Advertise Connection ID support so the session survives NAT rebinding */
+    int cid = TLS_DTLS_CID_SUPPORTED;
+
+    err = zsock_setsockopt( fd, SOL_TLS, TLS_DTLS_CID, &cid, sizeof( cid ) );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to setup DTLS Connection ID, err %d", errno );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_CID ) */
+
+    #if defined( CONFIG_NCE_DTLS_SESSION_CACHE )
+    /* Allow the modem to resume a cached session */
+    int session_cache = TLS_SESSION_CACHE_ENABLED;
+
+    err = zsock_setsockopt( fd, SOL_TLS, TLS_SESSION_CACHE, &session_cache, sizeof( session_cache ) );
+
+    if( err )
+    {
+        LOG_WRN( "Failed to enable DTLS session cache, err %d", errno );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_SESSION_CACHE ) */
+
     /* Associate the socket with the security tag */
     err = zsock_setsockopt( fd, SOL_TLS, TLS_SEC_TAG_LIST, tls_sec_tag,
                             sizeof( tls_sec_tag ) );
@@ -265,6 +312,9 @@ static int connect_to_coap_server( int fd,
                                    char * hostname,
                                    int port )
 {
+    /* DTLS follows the configured security tag, not the port number */
+    bool secure = IS_ENABLED( CONFIG_NCE_ENABLE_DTLS );
+
     LOG_INF( "Attempting to connect to CoAP server: %s:%d", hostname, port );
 
     #if defined( CONFIG_NCE_ENABLE_DTLS )
@@ -338,7 +388,7 @@ static int connect_to_coap_server( int fd,
 
     ( ( struct sockaddr_in * ) res->ai_addr )->sin_port = htons( port );
 
-    if( port == 5684 )
+    if( secure )
     {
         fd = socket( AF_INET, SOCK_DGRAM, IPPROTO_DTLS_1_2 );
     }
@@ -354,7 +404,7 @@ static int connect_to_coap_server( int fd,
     }
 
     #if defined( CONFIG_NCE_ENABLE_DTLS )
-    if( port == 5684 )
+    if( secure )
     {
         LOG_INF( "Configuring DTLS socket for secure CoAP..." );
         /* Setup DTLS socket options */
@@ -365,7 +415,7 @@ static int connect_to_coap_server( int fd,
             LOG_ERR( "DTLS socket configuration failed (err: %d)", err );
             return -1;
         }
-    } /* if( prot 5684 ) */
+    } /* if( secure ) */
     #endif /* if defined( CONFIG_NCE_ENABLE_DTLS ) */
     LOG_INF( "Connecting to CoAP server at %s:%d...", hostname, port );
 
@@ -378,6 +428,18 @@ static int connect_to_coap_server( int fd,
     }
 
     LOG_INF( "Successfully connected to CoAP server." );
+
+    #if defined( CONFIG_NCE_DTLS_SESSION_CACHE ) && defined( TLS_DTLS_HANDSHAKE_STATUS )
+    int handshake_status;
+    socklen_t len = sizeof( handshake_status );
+
+    if( secure &&
+        ( zsock_getsockopt( fd, SOL_TLS, TLS_DTLS_HANDSHAKE_STATUS, &handshake_status, &len ) == 0 ) )
+    {
+        LOG_INF( "DTLS handshake: %s",
+                 ( handshake_status == TLS_DTLS_HANDSHAKE_STATUS_CACHED ) ? "resumed" : "full" );
+    }
+    #endif /* if defined( CONFIG_NCE_DTLS_SESSION_CACHE ) && defined( TLS_DTLS_HANDSHAKE_STATUS ) */
     return 0;
 }
 
@@ -480,6 +542,20 @@ static int coap_request( int fd,
     }
 
     LOG_DBG( "CoAP request sent successfully" );
+
+    memcpy( proxy_request, request.data, request.offset );
+    proxy_request_len = request.offset;
+    proxy_request_id = coap_header_get_id( &request );
+    proxy_request_sent_at = k_uptime_get();
+
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    if( proxy_stats == NULL )
+    {
+        proxy_stats = coap_stats_get( CONFIG_NCE_MENDER_COAP_PROXY_HOST );
+    }
+
+    coap_stats_tx( proxy_stats, request.offset, false );
+#endif
 end:
     k_free( data );
     return r;
@@ -526,21 +602,121 @@ static void print_coap_payload( struct coap_packet * packet )
     free( filename1 );
 }
 
+/* Wait for the ACK of the last proxy request, retransmitting it with exponential backoff */
+static int receive_proxy_ack( int sock,
+                              uint8_t * buffer,
+                              size_t len,
+                              int * retransmissions,
+                              int64_t * resent_at )
+{
+    struct coap_transmission_parameters params = coap_get_transmission_parameters();
+    int timeout_ms;
+    int64_t deadline;
+    int ret;
+
+    params.max_retransmission = CONFIG_NCE_MENDER_COAP_MAX_RETRANSMIT;
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+    /* Initial timeout and backoff follow the RTT measured for the proxy */
+    coap_stats_rto_apply( proxy_stats, &params );
+#endif
+    timeout_ms = params.ack_timeout;
+    deadline = proxy_request_sent_at + timeout_ms;
+
+    while( 1 )
+    {
+        struct zsock_pollfd pfd =
+        {
+            .fd     = sock,
+            .events = ZSOCK_POLLIN,
+        };
+        int64_t wait = deadline - k_uptime_get();
+
+        if( wait <= 0 )
+        {
+            if( *retransmissions >= params.max_retransmission )
+            {
+                return 0;
+            }
+
+            if( zsock_send( sock, proxy_request, proxy_request_len, 0 ) < 0 )
+            {
+                return -errno;
+            }
+
+            ( *retransmissions )++;
+            *resent_at = k_uptime_get();
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+            coap_stats_tx( proxy_stats, proxy_request_len, true );
+#endif
+            timeout_ms = timeout_ms * params.coap_backoff_percent / 100;
+            deadline = *resent_at + timeout_ms;
+            LOG_DBG( "CoAP request retransmitted (%d/%d), next timeout %d ms",
+                     *retransmissions, params.max_retransmission, timeout_ms );
+            continue;
+        }
+
+        ret = zsock_poll( &pfd, 1, ( int ) wait );
+
+        if( ret < 0 )
+        {
+            return -errno;
+        }
+
+        if( ret == 0 )
+        {
+            continue;
+        }
+
+        ret = zsock_recv( sock, buffer, len, 0 );
+
+        if( ret <= 0 )
+        {
+            return ret;
+        }
+
+        if( ( ret >= 4 ) && ( sys_get_be16( &buffer[ 2 ] ) != proxy_request_id ) )
+        {
+            LOG_DBG( "Ignoring CoAP message %u, waiting for %u", sys_get_be16( &buffer[ 2 ] ), proxy_request_id );
+            continue;
+        }
+
+        return ret;
+    }
+}
+
 /* Handle the confirmable CoAP response received from the connected socket */
 static uint8_t handle_confirmable_response( int sock,
                                             struct coap_packet * response )
 {
     uint8_t buffer[ MAX_COAP_MSG_LEN ];
     uint8_t response_code = 0;
-    int bytes_received = zsock_recv( sock, buffer, sizeof( buffer ), 0 );
+    int retransmissions = 0;
+    int64_t resent_at = 0;
+    int bytes_received = receive_proxy_ack( sock, buffer, sizeof( buffer ), &retransmissions, &resent_at );
 
     if( bytes_received <= 0 )
     {
         LOG_WRN( "No CoAP response received from server" );
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+        coap_stats_timeout( proxy_stats );
+#endif
         return 0;
     }
     else
     {
+#if defined( CONFIG_CUSTOM_DOWNLOAD_CLIENT_COAP_STATS )
+        if( retransmissions == 0 )
+        {
+            coap_stats_rx( proxy_stats, bytes_received, ( int32_t ) ( k_uptime_get() - proxy_request_sent_at ) );
+        }
+        else
+        {
+            coap_stats_rx_retransmitted( proxy_stats, bytes_received,
+                                         ( uint32_t ) ( k_uptime_get() - proxy_request_sent_at ),
+                                         ( uint32_t ) ( k_uptime_get() - resent_at ), retransmissions );
+        }
+#endif
+
         int err = coap_packet_parse( response, buffer, bytes_received, NULL, 0 );
 
         if( err < 0 )
@@ -803,6 +979,48 @@ static void nce_mender_work_fn( struct k_work * work )
     }
 }
 
+#if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+/* Write function of the write-back buffer, which names an NVS item by its decimal ID */
+static int nvs_wb_write( const char * name,
+                         const void * value,
+                         size_t len )
+{
+    uint16_t item = ( uint16_t ) strtoul( name, NULL, 10 );
+    ssize_t ret;
+
+    if( len == 0 )
+    {
+        return nvs_delete( &fs, item );
+    }
+
+    ret = nvs_write( &fs, item, value, len );
+
+    return ( ret < 0 ) ? ( int ) ret : 0;
+}
+#endif /* if defined( CONFIG_NCE_MENDER_WRITE_BACK ) */
+
+/* Write or, with len 0, delete an item of the deployment record */
+static void nvs_record_write( uint16_t item,
+                              const void * value,
+                              size_t len )
+{
+    #if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    char name[ sizeof( "65535" ) ];
+
+    snprintk( name, sizeof( name ), "%u", item );
+    ( void ) write_back_save( name, value, len );
+    #else
+    if( len == 0 )
+    {
+        ( void ) nvs_delete( &fs, item );
+    }
+    else
+    {
+        ( void ) nvs_write( &fs, item, value, len );
+    }
+    #endif /* if defined( CONFIG_NCE_MENDER_WRITE_BACK ) */
+}
+
 /* Connect to Mender via 1NCE CoAP proxy using DTLS and check active deployment status from NVS (if exists)  */
 void nce_mender_application()
 {
@@ -844,8 +1062,8 @@ void nce_mender_application()
             long_led_pattern( LED_IDLE );
         }
 
-        ( void ) nvs_delete( &fs, DEPLOYMENT_ID );
-        ( void ) nvs_delete( &fs, ARTIFACT_NAME_ID );
+        nvs_record_write( DEPLOYMENT_ID, NULL, 0 );
+        nvs_record_write( ARTIFACT_NAME_ID, NULL, 0 );
     }
     else
     {
@@ -898,6 +1116,10 @@ int fota_init( struct fota_init_params * params )
 
     LOG_INF( "NVS storage mounted successfully" );
 
+    #if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    ( void ) write_back_init( nvs_wb_write );
+    #endif
+
     err = modem_info_init();
 
     if( err < 0 )
@@ -973,12 +1195,10 @@ void fota_done( void )
 
     /* Store Deployment ID & Artifact name to NVS */
     strcpy( nvs_deployment_id, id );
-    ( void ) nvs_write( &fs, DEPLOYMENT_ID, &nvs_deployment_id,
-                        sizeof( nvs_deployment_id ) );
+    nvs_record_write( DEPLOYMENT_ID, &nvs_deployment_id, sizeof( nvs_deployment_id ) );
     LOG_INF( "Stored deployment ID '%s' in NVS at key %d", nvs_deployment_id, DEPLOYMENT_ID );
     strcpy( nvs_artifact_name, artifact_name );
-    ( void ) nvs_write( &fs, ARTIFACT_NAME_ID, &nvs_artifact_name,
-                        sizeof( nvs_artifact_name ) );
+    nvs_record_write( ARTIFACT_NAME_ID, &nvs_artifact_name, sizeof( nvs_artifact_name ) );
     LOG_INF( "Stored artifact name '%s' in NVS at key %d", nvs_artifact_name, ARTIFACT_NAME_ID );
 
     k_sleep( K_SECONDS( 10 ) );
@@ -986,6 +1206,10 @@ void fota_done( void )
     LOG_INF( "Reporting reboot status to Mender..." );
     response_code = nce_mender_report_status( mender_socket, request, &response, STATUS_REBOOTING, false );
     LOG_INF( "Rebooting device to apply update..." );
+    #if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    /* The deployment record must be in flash before the new image boots */
+    ( void ) write_back_flush();
+    #endif
     /* Reboot */
     sys_reboot( SYS_REBOOT_WARM );
 }
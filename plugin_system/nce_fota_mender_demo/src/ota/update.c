@@ -23,6 +23,9 @@
 #include "nce_mender_client.h"
 #include <modem/nrf_modem_lib.h>
 #include "update.h"
+#if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    #include <write_back.h>
+#endif
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER( MODEM_FOTA, CONFIG_LOG_DEFAULT_LEVEL );
@@ -208,6 +211,9 @@ static int shell_reboot( const struct shell * shell,
     ARG_UNUSED( argv );
 
     shell_print( shell, "Device will now reboot" );
+    #if defined( CONFIG_NCE_MENDER_WRITE_BACK )
+    ( void ) write_back_flush();
+    #endif
     sys_reboot( SYS_REBOOT_WARM );
 
     return 0;
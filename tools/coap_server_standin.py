@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+# Usage: ./coap_server_standin.py [--port 5683] [--loss 0.1] [--delay 200] [--code 2.04] ...
+# Example: ./coap_server_standin.py --bind 192.0.2.2 --loss 0.05 --delay 150 --jitter 100
+#
+# Host-side stand-in for the 1NCE CoAP endpoint, used to benchmark the CoAP demo
+# on native_sim (or any board that can reach the host). It answers confirmable
+# requests with a piggybacked ACK, acknowledges Block1 transfers block by block
+# and replays the stored response for retransmitted message IDs. Request and
+# response loss, response delay and response codes are configurable. With --psk
+# the endpoint is served over DTLS 1.2 with a pre-shared key, which needs the
+# python-mbedtls package.
+
+import argparse
+import random
+import signal
+import socket
+import sys
+import threading
+import time
+
+COAP_VERSION = 1
+TYPE_CON, TYPE_NON, TYPE_ACK, TYPE_RST = range(4)
+OPTION_BLOCK1 = 27
+CODE_CONTINUE = (2 << 5) | 31
+CODE_REQUEST_TOO_LARGE = (4 << 5) | 13
+EXCHANGE_LIFETIME = 247
+
+
+def parse_code(text):
+    cls, detail = text.split(".")
+    return (int(cls) << 5) | int(detail)
+
+
+def format_code(code):
+    return f"{code >> 5}.{code & 0x1f:02d}"
+
+
+def parse_message(data):
+    """Return (type, tkl, code, mid, token, options) or None for malformed datagrams."""
+    if len(data) < 4 or (data[0] >> 6) != COAP_VERSION:
+        return None
+
+    mtype = (data[0] >> 4) & 0x3
+    tkl = data[0] & 0x0f
+    code = data[1]
+    mid = int.from_bytes(data[2:4], "big")
+
+    if tkl > 8 or len(data) < 4 + tkl:
+        return None
+
+    token = data[4:4 + tkl]
+    options = {}
+    pos = 4 + tkl
+    number = 0
+
+    while pos < len(data) and data[pos] != 0xff:
+        delta = data[pos] >> 4
+        length = data[pos] & 0x0f
+        pos += 1
+
+        for field in ("delta", "length"):
+            value = delta if field == "delta" else length
+
+            if value == 13:
+                value = data[pos] + 13
+                pos += 1
+            elif value == 14:
+                value = int.from_bytes(data[pos:pos + 2], "big") + 269
+                pos += 2
+            elif value == 15:
+                return None
+
+            if field == "delta":
+                delta = value
+            else:
+                length = value
+
+        number += delta
+        options.setdefault(number, []).append(data[pos:pos + length])
+        pos += length
+
+    return mtype, tkl, code, mid, token, options
+
+
+def encode_uint(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, "big") if value else b""
+
+
+def build_response(mtype, code, mid, token, options=()):
+    out = bytearray([(COAP_VERSION << 6) | (mtype << 4) | len(token), code])
+    out += mid.to_bytes(2, "big") + token
+    last = 0
+
+    for number, value in sorted(options, key=lambda option: option[0]):
+        delta = number - last
+        last = number
+        ext = b""
+
+        if delta >= 13:
+            ext += bytes([delta - 13])
+            delta = 13
+
+        out.append((delta << 4) | len(value))
+        out += ext + value
+
+    return bytes(out)
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.started = time.monotonic()
+        self.requests = 0
+        self.duplicates = 0
+        self.blocks = 0
+        self.dropped_requests = 0
+        self.dropped_responses = 0
+        self.errors = 0
+
+    def report(self):
+        with self.lock:
+            elapsed = max(time.monotonic() - self.started, 1e-3)
+            print(f"[stats] {elapsed:.1f} s: {self.requests} requests ({self.requests / elapsed:.2f} msg/s), "
+                  f"{self.blocks} Block1 blocks, {self.duplicates} retransmissions, "
+                  f"{self.dropped_requests} requests and {self.dropped_responses} responses dropped, "
+                  f"{self.errors} error responses", flush=True)
+
+
+class Endpoint:
+    def __init__(self, args, stats):
+        self.args = args
+        self.stats = stats
+        self.code = parse_code(args.code)
+        self.error_code = parse_code(args.error_code)
+        self.cache = {}
+
+    def handle(self, data, peer, send):
+        """Handle one datagram, send(bytes) is called (possibly later) with the response."""
+        msg = parse_message(data)
+
+        if msg is None:
+            return
+
+        mtype, _, code, mid, token, options = msg
+
+        if mtype not in (TYPE_CON, TYPE_NON) or code == 0 or (code >> 5) != 0:
+            return
+
+        now = time.monotonic()
+        key = (peer, mid)
+        self.cache = {k: v for k, v in self.cache.items() if v[0] > now}
+
+        if random.random() < self.args.loss:
+            with self.stats.lock:
+                self.stats.dropped_requests += 1
+            return
+
+        if key in self.cache:
+            with self.stats.lock:
+                self.stats.duplicates += 1
+            self._send_later(self.cache[key][1], send)
+            return
+
+        response_type = TYPE_ACK if mtype == TYPE_CON else TYPE_NON
+        response_mid = mid if mtype == TYPE_CON else random.getrandbits(16)
+        response_options = []
+        response_code = self.code
+        block1 = options.get(OPTION_BLOCK1)
+
+        if block1:
+            value = int.from_bytes(block1[0], "big")
+            szx = min(value & 0x7, self.args.block_szx)
+            more = bool(value & 0x8)
+            response_options.append((OPTION_BLOCK1, encode_uint((value & ~0x7) | szx)))
+
+            if value & 0x7 > szx:
+                # 4.13 with the preferred size, the client continues with smaller blocks
+                response_code = CODE_REQUEST_TOO_LARGE
+            else:
+                with self.stats.lock:
+                    self.stats.blocks += 1
+
+                if more:
+                    response_code = CODE_CONTINUE
+
+        if response_code not in (CODE_CONTINUE, CODE_REQUEST_TOO_LARGE):
+            with self.stats.lock:
+                self.stats.requests += 1
+
+            if random.random() < self.args.error_rate:
+                response_code = self.error_code
+
+                with self.stats.lock:
+                    self.stats.errors += 1
+
+        response = build_response(response_type, response_code, response_mid, token, response_options)
+        self.cache[key] = (now + EXCHANGE_LIFETIME, response)
+
+        if self.args.verbose:
+            print(f"{peer[0]}:{peer[1]} mid {mid} -> {format_code(response_code)}", flush=True)
+
+        self._send_later(response, send)
+
+    def _send_later(self, response, send):
+        if random.random() < self.args.response_loss:
+            with self.stats.lock:
+                self.stats.dropped_responses += 1
+            return
+
+        delay = max(0.0, self.args.delay + random.uniform(-self.args.jitter, self.args.jitter)) / 1000
+
+        if delay > 0:
+            threading.Timer(delay, send, (response,)).start()
+        else:
+            send(response)
+
+
+def serve_udp(args, endpoint):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print(f"CoAP stand-in listening on udp://{args.bind}:{args.port}", flush=True)
+
+    while True:
+        data, peer = sock.recvfrom(2048)
+        endpoint.handle(data, peer, lambda response, peer=peer: sock.sendto(response, peer))
+
+
+def serve_dtls(args, endpoint):
+    try:
+        from mbedtls import tls
+    except ImportError:
+        sys.exit("DTLS needs the python-mbedtls package: pip install python-mbedtls")
+
+    conf = tls.DTLSConfiguration(
+        pre_shared_key_store={args.identity: bytes.fromhex(args.psk)},
+        validate_certificates=False,
+    )
+    ctx = tls.ServerContext(conf)
+    listener = ctx.wrap_socket(socket.socket(socket.AF_INET, socket.SOCK_DGRAM), None)
+    listener.bind((args.bind, args.port))
+    print(f"CoAP stand-in listening on coaps://{args.bind}:{args.port} (PSK identity '{args.identity}')",
+          flush=True)
+
+    while True:
+        conn, peer = listener.accept()
+        conn.setcookieparam(peer[0].encode())
+
+        try:
+            conn.do_handshake()
+        except tls.HelloVerifyRequest:
+            conn, peer = conn.accept()
+            conn.setcookieparam(peer[0].encode())
+            conn.do_handshake()
+
+        print(f"DTLS session with {peer[0]}:{peer[1]} established", flush=True)
+
+        while True:
+            try:
+                data = conn.recv(2048)
+            except Exception as exc:
+                print(f"DTLS session with {peer[0]}:{peer[1]} closed: {exc}", flush=True)
+                break
+
+            if not data:
+                break
+
+            endpoint.handle(data, peer, conn.send)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Host-side stand-in for the 1NCE CoAP endpoint")
+    parser.add_argument("--bind", default="0.0.0.0", help="address to listen on (192.0.2.2 for native_sim)")
+    parser.add_argument("--port", type=int, help="port, 5683 for CoAP and 5684 for CoAPs by default")
+    parser.add_argument("--loss", type=float, default=0.0, help="probability of dropping a request")
+    parser.add_argument("--response-loss", type=float, default=0.0, help="probability of dropping a response")
+    parser.add_argument("--delay", type=float, default=0.0, help="response delay in ms")
+    parser.add_argument("--jitter", type=float, default=0.0, help="uniform jitter added to the delay in ms")
+    parser.add_argument("--code", default="2.04", help="response code of successful requests")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="share of requests answered with --error-code")
+    parser.add_argument("--error-code", default="5.03", help="error response code")
+    parser.add_argument("--block-szx", type=int, default=6, choices=range(7),
+                        help="largest Block1 SZX accepted, larger blocks are answered with 4.13")
+    parser.add_argument("--psk", help="serve DTLS with this pre-shared key (hex)")
+    parser.add_argument("--identity", default="nce-standin", help="DTLS PSK identity")
+    parser.add_argument("--stats-interval", type=float, default=10.0, help="seconds between statistics reports")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    if args.port is None:
+        args.port = 5684 if args.psk else 5683
+
+    stats = Stats()
+    endpoint = Endpoint(args, stats)
+
+    def report_periodically():
+        while True:
+            time.sleep(args.stats_interval)
+            stats.report()
+
+    threading.Thread(target=report_periodically, daemon=True).start()
+    signal.signal(signal.SIGINT, lambda *_: (stats.report(), sys.exit(0)))
+
+    if args.psk:
+        serve_dtls(args, endpoint)
+    else:
+        serve_udp(args, endpoint)
+
+
+if __name__ == "__main__":
+    main()
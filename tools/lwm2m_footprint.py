@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+# Usage: ./lwm2m_footprint.py [--board native_sim] [--limits 4,8,15] [--formats plain,json,senml-cbor] [--run 90] ...
+# Example: ./lwm2m_footprint.py --board native_sim --limits 4,15 --run 90 --observe /4/0 --observe /6/0
+#
+# Memory footprint benchmark of the LwM2M demo. The demo is built once per
+# configuration of a matrix: the engine limits (CONFIG_LWM2M_ENGINE_MAX_OBSERVER,
+# _MAX_MESSAGES, _MAX_PENDING and _MAX_REPLIES, all set to the same value) times
+# the content formats. Static RAM and flash are read from the ELF sections, with
+# the sizes of the engine's message and observer pools and of the client
+# context. On native_sim with --run, every build is also run against
+# lwm2m_server_standin.py, and the peak heap and stack use logged by
+# CONFIG_APP_LWM2M_BENCHMARK after the registration and every update are
+# reported. Every requested option is checked in the generated .config, so a
+# configuration Kconfig silently changed is skipped instead of reported. Needs
+# west and the nRF Connect SDK; the ELF is read without binutils.
+
+import argparse
+import csv
+import itertools
+import os
+import re
+import struct
+import subprocess
+import sys
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEMO = os.path.join(ROOT, "nce_lwm2m_demo")
+STANDIN = os.path.join(ROOT, "tools", "lwm2m_server_standin.py")
+
+LIMITS = ["LWM2M_ENGINE_MAX_OBSERVER", "LWM2M_ENGINE_MAX_MESSAGES", "LWM2M_ENGINE_MAX_PENDING",
+          "LWM2M_ENGINE_MAX_REPLIES"]
+
+# TLV and plain text are always built in, SenML CBOR needs LwM2M 1.1 and zcbor
+FORMATS = {
+    "plain": {"LWM2M_RW_JSON_SUPPORT": "n", "LWM2M_RW_SENML_CBOR_SUPPORT": "n"},
+    "json": {"LWM2M_RW_JSON_SUPPORT": "y", "LWM2M_RW_SENML_CBOR_SUPPORT": "n"},
+    "senml-cbor": {"LWM2M_RW_JSON_SUPPORT": "n", "LWM2M_RW_SENML_CBOR_SUPPORT": "y",
+                   "LWM2M_VERSION_1_1": "y", "ZCBOR": "y"},
+    "json+senml-cbor": {"LWM2M_RW_JSON_SUPPORT": "y", "LWM2M_RW_SENML_CBOR_SUPPORT": "y",
+                        "LWM2M_VERSION_1_1": "y", "ZCBOR": "y"},
+}
+
+# Engine message pool, observer pool and the demo's client context (pending and reply tables)
+SYMBOLS = ["messages", "observe_node_data", "client"]
+
+SHF_WRITE = 0x1
+SHF_ALLOC = 0x2
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+STT_OBJECT = 1
+
+HEAP_RE = re.compile(r"LwM2M benchmark: heap peak (\d+) of (\d+) bytes")
+STACK_RE = re.compile(r"LwM2M benchmark: (\S+) stack peak (\d+) of (\d+) bytes")
+REGISTRATION_RE = re.compile(r"LwM2M benchmark: registration (\d+) ms")
+CONFIG_RE = re.compile(r"^CONFIG_(\w+)=(.*)$")
+UNSET_RE = re.compile(r"^# CONFIG_(\w+) is not set$")
+
+
+def read_elf(path, symbols):
+    """Return (flash, ram, {symbol: size}) of an ELF file.
+
+    Allocated sections without file contents (.bss, .noinit) count as RAM,
+    writable ones with contents (.data) as RAM and flash and all others as
+    flash. Objects with the same name are added up.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data[:4] != b"\x7fELF":
+        raise ValueError(f"{path} is not an ELF file")
+
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3a)
+        section_fmt = endian + "IIQQQQIIQQ"
+        symbol_fmt, symbol_size = endian + "IBBHQQ", 24
+    else:
+        shoff, = struct.unpack_from(endian + "I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2e)
+        section_fmt = endian + "IIIIIIIIII"
+        symbol_fmt, symbol_size = endian + "IIIBBH", 16
+
+    sections = [struct.unpack_from(section_fmt, data, shoff + i * shentsize) for i in range(shnum)]
+    flash = ram = 0
+    sizes = dict.fromkeys(symbols, 0)
+
+    for _, sh_type, flags, _, offset, size, link, _, _, _ in sections:
+        if sh_type == SHT_SYMTAB:
+            strtab = sections[link][4]
+
+            for pos in range(offset, offset + size, symbol_size):
+                fields = struct.unpack_from(symbol_fmt, data, pos)
+
+                if is64:
+                    name_offset, info, _, _, _, sym_size = fields
+                else:
+                    name_offset, _, sym_size, info, _, _ = fields
+
+                if info & 0xf != STT_OBJECT:
+                    continue
+
+                end = data.index(b"\0", strtab + name_offset)
+                name = data[strtab + name_offset:end].decode(errors="replace")
+
+                if name in sizes:
+                    sizes[name] += sym_size
+
+        if not flags & SHF_ALLOC:
+            continue
+
+        if sh_type == SHT_NOBITS:
+            ram += size
+        elif flags & SHF_WRITE:
+            ram += size
+            flash += size
+        else:
+            flash += size
+
+    return flash, ram, sizes
+
+
+def find_file(build_dir, name):
+    # Sysbuild puts the application in a subdirectory named after it
+    for candidate in (os.path.join(build_dir, "zephyr", name),
+                      os.path.join(build_dir, os.path.basename(DEMO), "zephyr", name)):
+        if os.path.exists(candidate):
+            return candidate
+
+    return None
+
+
+def check_config(build_dir, options):
+    """Return the requested options that did not take effect, as "option=value (wanted value)"."""
+    config = find_file(build_dir, ".config")
+
+    if config is None:
+        return [f"no .config in {build_dir}"]
+
+    values = {}
+
+    with open(config) as f:
+        for line in f:
+            match = CONFIG_RE.match(line.strip())
+
+            if match:
+                values[match.group(1)] = match.group(2).strip('"')
+                continue
+
+            match = UNSET_RE.match(line.strip())
+
+            if match:
+                values[match.group(1)] = "n"
+
+    # Options without a prompt whose dependencies are not met do not appear at all
+    return [f"{option}={values.get(option, 'n')} (wanted {value})" for option, value in options.items()
+            if values.get(option, "n") != value]
+
+
+def build(args, name, options):
+    build_dir = os.path.join(args.build_dir, name)
+    os.makedirs(build_dir, exist_ok=True)
+    fragment = os.path.join(build_dir, "footprint.conf")
+
+    with open(fragment, "w") as f:
+        f.write("# Generated by lwm2m_footprint.py\n")
+        f.writelines(f"CONFIG_{option}={value}\n" for option, value in options.items())
+
+    extra = [os.path.abspath(conf) for conf in args.extra_conf] + [fragment]
+    command = ["west", "build", "-b", args.board, "-d", build_dir, "-p", "auto", DEMO]
+
+    if args.board.startswith("native_sim"):
+        command.append("--no-sysbuild")
+
+    command += ["--", f"-DEXTRA_CONF_FILE={';'.join(extra)}"]
+    print(f"[{name}] {' '.join(command)}", flush=True)
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+    if result.returncode != 0:
+        print(result.stdout[-4000:], flush=True)
+        print(f"[{name}] build failed", flush=True)
+        return None
+
+    mismatched = check_config(build_dir, options)
+
+    if mismatched:
+        print(f"[{name}] options did not take effect: {', '.join(mismatched)}", flush=True)
+        return None
+
+    return build_dir
+
+
+def run(args, name, build_dir):
+    """Run a native_sim build and return the peak heap, stack and registration results it logged."""
+    executable = find_file(build_dir, "zephyr.exe")
+    measured = {"heap": None, "heap_size": None, "stacks": {}, "registration_ms": None}
+
+    if executable is None:
+        print(f"[{name}] no zephyr.exe to run", flush=True)
+        return measured
+
+    try:
+        result = subprocess.run([executable, f"-stop_at={args.run}"], stdout=subprocess.PIPE,
+                                stderr=subprocess.STDOUT, text=True, errors="replace", timeout=args.run + 60)
+        output = result.stdout
+    except subprocess.TimeoutExpired as e:
+        output = e.stdout.decode(errors="replace") if isinstance(e.stdout, bytes) else (e.stdout or "")
+
+    # The logs are cumulative peaks, the largest value is the last one
+    for match in HEAP_RE.finditer(output):
+        measured["heap"] = max(measured["heap"] or 0, int(match.group(1)))
+        measured["heap_size"] = int(match.group(2))
+
+    for match in STACK_RE.finditer(output):
+        thread, used, size = match.group(1), int(match.group(2)), int(match.group(3))
+        previous = measured["stacks"].get(thread, (0, size))[0]
+        measured["stacks"][thread] = (max(previous, used), size)
+
+    match = REGISTRATION_RE.search(output)
+
+    if match:
+        measured["registration_ms"] = int(match.group(1))
+    else:
+        print(f"[{name}] did not register within {args.run} s", flush=True)
+
+    return measured
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Memory footprint benchmark of the LwM2M demo")
+    parser.add_argument("--board", default="native_sim", help="board to build for")
+    parser.add_argument("--limits", default="4,8,15",
+                        help="comma separated values for the four engine limits, 15 is the demo's default")
+    parser.add_argument("--formats", default="plain,json,senml-cbor",
+                        help=f"comma separated content format sets: {', '.join(FORMATS)}")
+    parser.add_argument("--extra-conf", action="append", default=[],
+                        help="additional conf file for every build, e.g. overlay-lwm2m-1.1.conf (repeatable)")
+    parser.add_argument("--build-dir", default=os.path.join(ROOT, "build_footprint"),
+                        help="one build directory per configuration is created below it")
+    parser.add_argument("--run", type=int, default=0,
+                        help="seconds to run every native_sim build against the stand-in, 0 for static sizes only")
+    parser.add_argument("--observe", action="append", default=[],
+                        help="path the stand-in observes after the registration (repeatable)")
+    parser.add_argument("--no-standin", action="store_true", help="do not start the stand-in, one is already running")
+    parser.add_argument("--csv", help="also write the results to this CSV file")
+    args = parser.parse_args()
+
+    limits = [int(value) for value in args.limits.split(",")]
+    formats = args.formats.split(",")
+
+    for name in formats:
+        if name not in FORMATS:
+            parser.error(f"unknown format set {name}")
+
+    if args.run and not args.board.startswith("native_sim"):
+        parser.error("--run needs a native_sim board, use the CONFIG_APP_LWM2M_BENCHMARK logs on hardware")
+
+    standin = None
+
+    if args.run and not args.no_standin:
+        command = [sys.executable, STANDIN, "--bind", "192.0.2.2", "--stats-interval", "3600"]
+        command += [item for path in args.observe for item in ("--observe", path)]
+        standin = subprocess.Popen(command, stdout=subprocess.DEVNULL)
+        time.sleep(1)
+
+    results = []
+
+    try:
+        for limit, format_name in itertools.product(limits, formats):
+            name = f"limits{limit}-{format_name}"
+            options = dict.fromkeys(LIMITS, str(limit))
+            options.update(FORMATS[format_name])
+            build_dir = build(args, name, options)
+
+            if build_dir is None:
+                continue
+
+            elf = find_file(build_dir, "zephyr.elf")
+
+            if elf is None:
+                print(f"[{name}] no zephyr.elf in {build_dir}", flush=True)
+                continue
+
+            flash, ram, sizes = read_elf(elf, SYMBOLS)
+            result = {"config": name, "limits": limit, "formats": format_name, "flash": flash, "ram": ram}
+            result.update({f"sizeof {symbol}": size for symbol, size in sizes.items()})
+
+            if args.run:
+                measured = run(args, name, build_dir)
+                result["heap peak"] = measured["heap"]
+                result["heap size"] = measured["heap_size"]
+                result["registration ms"] = measured["registration_ms"]
+
+                for thread, (used, size) in sorted(measured["stacks"].items()):
+                    result[f"{thread} stack peak"] = used
+                    result[f"{thread} stack size"] = size
+
+            print(f"[{name}] flash {flash} bytes, RAM {ram} bytes, "
+                  + ", ".join(f"{key} {value}" for key, value in result.items() if key.startswith("sizeof")),
+                  flush=True)
+            results.append(result)
+    finally:
+        if standin:
+            standin.terminate()
+
+    if not results:
+        sys.exit(1)
+
+    columns = list(dict.fromkeys(key for result in results for key in result))
+    base = results[0]
+
+    # Differences against the first configuration, the sizes of interest for the deployment
+    for result in results:
+        result["flash delta"] = result["flash"] - base["flash"]
+        result["ram delta"] = result["ram"] - base["ram"]
+
+    columns[columns.index("ram") + 1:columns.index("ram") + 1] = ["flash delta", "ram delta"]
+    widths = [max(len(column), *(len(str(result.get(column, "-"))) for result in results)) for column in columns]
+    print("  ".join(column.rjust(width) for column, width in zip(columns, widths)))
+
+    for result in results:
+        print("  ".join(str(result.get(column, "-")).rjust(width) for column, width in zip(columns, widths)))
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=columns)
+            writer.writeheader()
+            writer.writerows(results)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,437 @@
+#!/usr/bin/env python3
+# Usage: ./lwm2m_server_standin.py [--port 5683] [--observe /4/0/2 ...] [--delay 100] [--firmware app_update.bin] ...
+# Example: ./lwm2m_server_standin.py --bind 192.0.2.2 --observe /4/0 --observe /6/0
+#
+# Host-side stand-in for an LwM2M server, used to benchmark the LwM2M demo on
+# native_sim (CONFIG_APP_LWM2M_SIM). It accepts Register, Update, De-register
+# and Send over plain CoAP, answers retransmitted requests with the stored
+# response and, after every registration, observes the paths given with
+# --observe and acknowledges the notifications. For every endpoint it reports
+# the registration, the time and bytes of every update cycle and the
+# notification and Send counts. With --firmware, the first registration of
+# every endpoint is followed by a pull-mode firmware update (object 5): the
+# image is served block-wise at /fw, Update is executed once the device reports
+# it downloaded, and the download time, the notification bytes during the
+# download and the time until the device registers again are reported. CoAP
+# helpers are shared with coap_server_standin.py.
+
+import argparse
+import random
+import signal
+import socket
+import sys
+import threading
+import time
+
+from coap_server_standin import (EXCHANGE_LIFETIME, TYPE_ACK, TYPE_CON, TYPE_NON, TYPE_RST, build_response,
+                                 encode_uint, format_code, parse_code, parse_message)
+
+OPTION_OBSERVE = 6
+OPTION_LOCATION_PATH = 8
+OPTION_URI_PATH = 11
+OPTION_CONTENT_FORMAT = 12
+OPTION_URI_QUERY = 15
+OPTION_ACCEPT = 17
+OPTION_BLOCK2 = 23
+
+FORMAT_TEXT = 0
+PAYLOAD_MARKER = b"\xff"
+
+CODE_GET = 1
+CODE_POST = 2
+CODE_PUT = 3
+CODE_DELETE = 4
+CODE_CREATED = parse_code("2.01")
+CODE_DELETED = parse_code("2.02")
+CODE_CHANGED = parse_code("2.04")
+CODE_CONTENT = parse_code("2.05")
+CODE_BAD_REQUEST = parse_code("4.00")
+CODE_NOT_FOUND = parse_code("4.04")
+
+
+class Registration:
+    def __init__(self, location, name, lifetime, peer):
+        self.location = location
+        self.name = name
+        self.lifetime = lifetime
+        self.peer = peer
+        self.registered = time.monotonic()
+        self.last_update = self.registered
+        self.updates = 0
+        self.notifications = 0
+        self.sends = 0
+        self.rx = 0
+        self.tx = 0
+        self.cycle_rx = 0
+        self.cycle_tx = 0
+        self.cycle_bytes = []
+        self.fota_notification_bytes = 0
+        self.fota_notifications = 0
+
+    def close_cycle(self):
+        """Account the bytes since the last registration or update as one cycle."""
+        now = time.monotonic()
+        cycle = (now - self.last_update, self.cycle_rx, self.cycle_tx)
+        self.cycle_bytes.append(self.cycle_rx + self.cycle_tx)
+        self.last_update = now
+        self.cycle_rx = 0
+        self.cycle_tx = 0
+        return cycle
+
+
+class Firmware:
+    """Pull-mode update of one endpoint, from the Package URI write to the next registration."""
+
+    def __init__(self):
+        self.started = time.monotonic()
+        self.downloaded = None
+        self.executed = None
+        self.blocks = 0
+
+
+class Server:
+    def __init__(self, args, sock):
+        self.args = args
+        self.sock = sock
+        self.lock = threading.Lock()
+        self.cache = {}
+        self.registrations = {}
+        self.by_peer = {}
+        self.observations = {}
+        self.reads = {}
+        self.next_location = 0
+        self.firmware = open(args.firmware, "rb").read() if args.firmware else None
+        self.updates = {}
+
+    def send(self, data, peer):
+        with self.lock:
+            reg = self.by_peer.get(peer)
+
+            if reg:
+                reg.tx += len(data)
+                reg.cycle_tx += len(data)
+
+        self.sock.sendto(data, peer)
+
+    def handle(self, data, peer):
+        msg = parse_message(data)
+
+        if msg is None:
+            return
+
+        mtype, _, code, mid, token, options = msg
+
+        with self.lock:
+            reg = self.by_peer.get(peer)
+
+            if reg:
+                reg.rx += len(data)
+                reg.cycle_rx += len(data)
+
+        if (code >> 5) != 0 or mtype in (TYPE_ACK, TYPE_RST):
+            self._handle_response(data, mtype, code, mid, token, peer)
+            return
+
+        if code == 0:
+            # CoAP ping
+            if mtype == TYPE_CON:
+                self.send(build_response(TYPE_RST, 0, mid, b""), peer)
+            return
+
+        now = time.monotonic()
+        key = (peer, mid)
+        self.cache = {k: v for k, v in self.cache.items() if v[0] > now}
+
+        if key in self.cache:
+            self._reply(self.cache[key][1], peer)
+            return
+
+        payload = b""
+
+        if self.firmware is not None and code == CODE_GET and options.get(OPTION_URI_PATH) == [b"fw"]:
+            response_code, response_options, payload = self._firmware_block(options)
+        else:
+            response_code, response_options = self._handle_request(code, options, peer)
+
+        response_type = TYPE_ACK if mtype == TYPE_CON else TYPE_NON
+        response_mid = mid if mtype == TYPE_CON else random.getrandbits(16)
+        response = build_response(response_type, response_code, response_mid, token, response_options)
+
+        if payload:
+            response += PAYLOAD_MARKER + payload
+
+        self.cache[key] = (now + EXCHANGE_LIFETIME, response)
+        self._reply(response, peer)
+
+        if response_code == CODE_CREATED:
+            self._start_observations(peer)
+
+            if self.firmware is not None:
+                self._start_firmware_update(peer)
+
+    def _reply(self, response, peer):
+        delay = self.args.delay / 1000
+
+        if delay > 0:
+            threading.Timer(delay, self.send, (response, peer)).start()
+        else:
+            self.send(response, peer)
+
+    def _handle_request(self, code, options, peer):
+        path = [segment.decode(errors="replace") for segment in options.get(OPTION_URI_PATH, [])]
+        query = dict(item.decode(errors="replace").partition("=")[::2] for item in options.get(OPTION_URI_QUERY, []))
+
+        if self.args.verbose:
+            print(f"{peer[0]}:{peer[1]} {format_code(code)} /{'/'.join(path)} {query}", flush=True)
+
+        if path == ["rd"] and code == CODE_POST:
+            return self._register(query, peer)
+
+        if path == ["dp"] and code == CODE_POST:
+            with self.lock:
+                reg = self.by_peer.get(peer)
+
+                if reg:
+                    reg.sends += 1
+
+            return CODE_CHANGED, []
+
+        if len(path) == 2 and path[0] == "rd":
+            with self.lock:
+                reg = self.registrations.get(path[1])
+
+            if reg is None:
+                return CODE_NOT_FOUND, []
+
+            if code == CODE_POST:
+                return self._update(reg, query, peer)
+
+            if code == CODE_DELETE:
+                with self.lock:
+                    del self.registrations[reg.location]
+                    self.by_peer.pop(reg.peer, None)
+
+                print(f"[{reg.name}] de-registered after {reg.updates} updates", flush=True)
+                return CODE_DELETED, []
+
+        return CODE_BAD_REQUEST, []
+
+    def _register(self, query, peer):
+        name = query.get("ep")
+
+        if not name:
+            return CODE_BAD_REQUEST, []
+
+        with self.lock:
+            for old in [r for r in self.registrations.values() if r.name == name]:
+                del self.registrations[old.location]
+                self.by_peer.pop(old.peer, None)
+
+            location = str(self.next_location)
+            self.next_location += 1
+            reg = Registration(location, name, int(query.get("lt", 86400)), peer)
+            self.registrations[location] = reg
+            self.by_peer[peer] = reg
+
+        print(f"[{name}] registered from {peer[0]}:{peer[1]} as /rd/{location}, lifetime {reg.lifetime} s",
+              flush=True)
+        return CODE_CREATED, [(OPTION_LOCATION_PATH, b"rd"), (OPTION_LOCATION_PATH, location.encode())]
+
+    def _update(self, reg, query, peer):
+        with self.lock:
+            if reg.peer != peer:
+                self.by_peer.pop(reg.peer, None)
+                reg.peer = peer
+                self.by_peer[peer] = reg
+
+            if "lt" in query:
+                reg.lifetime = int(query["lt"])
+
+            reg.updates += 1
+            seconds, rx, tx = reg.close_cycle()
+            average = sum(reg.cycle_bytes) / len(reg.cycle_bytes)
+
+        print(f"[{reg.name}] update {reg.updates} after {seconds:.1f} s: {rx + tx} bytes in the cycle "
+              f"({rx} rx, {tx} tx), avg {average:.0f} bytes/cycle, {reg.notifications} notifications, "
+              f"{reg.sends} sends", flush=True)
+        return CODE_CHANGED, []
+
+    def _request(self, code, path, peer, options=(), payload=b""):
+        token = random.getrandbits(32).to_bytes(4, "big")
+        options = list(options) + [(OPTION_URI_PATH, segment.encode()) for segment in path.strip("/").split("/")]
+        request = build_response(TYPE_CON, code, random.getrandbits(16), token, options)
+
+        if payload:
+            request += PAYLOAD_MARKER + payload
+
+        self.send(request, peer)
+        return token
+
+    def _observe(self, path, peer):
+        with self.lock:
+            token = random.getrandbits(32).to_bytes(4, "big")
+            self.observations[token] = path
+
+        options = [(OPTION_OBSERVE, encode_uint(0)), (OPTION_ACCEPT, encode_uint(FORMAT_TEXT))]
+        options += [(OPTION_URI_PATH, segment.encode()) for segment in path.strip("/").split("/")]
+        self.send(build_response(TYPE_CON, CODE_GET, random.getrandbits(16), token, options), peer)
+
+    def _start_observations(self, peer):
+        for path in self.args.observe:
+            self._observe(path, peer)
+
+    def _start_firmware_update(self, peer):
+        with self.lock:
+            reg = self.by_peer.get(peer)
+            update = self.updates.get(reg.name) if reg else None
+
+        if reg is None:
+            return
+
+        if update is not None:
+            if update.executed is not None:
+                # Back after the reboot into the new image
+                print(f"[{reg.name}] registered {time.monotonic() - update.executed:.1f} s after Update, "
+                      f"{time.monotonic() - update.started:.1f} s end to end", flush=True)
+                token = self._request(CODE_GET, "/5/0/5", peer, [(OPTION_ACCEPT, encode_uint(FORMAT_TEXT))])
+
+                with self.lock:
+                    self.reads[token] = "/5/0/5"
+                    del self.updates[reg.name]
+
+            return
+
+        with self.lock:
+            self.updates[reg.name] = Firmware()
+
+        self._observe("/5/0/3", peer)
+        uri = f"coap://{self.args.firmware_host or self.args.bind}:{self.args.port}/fw"
+        self._request(CODE_PUT, "/5/0/1", peer, [(OPTION_CONTENT_FORMAT, encode_uint(FORMAT_TEXT))], uri.encode())
+        print(f"[{reg.name}] Package URI {uri}, {len(self.firmware)} bytes", flush=True)
+
+    def _firmware_block(self, options):
+        block2 = options.get(OPTION_BLOCK2)
+        value = int.from_bytes(block2[0], "big") if block2 else 6
+        num, szx = value >> 4, min(value & 0x7, 6)
+        size = 16 << szx
+        block = self.firmware[num * size:(num + 1) * size]
+
+        if not block and num > 0:
+            return CODE_BAD_REQUEST, [], b""
+
+        more = (num + 1) * size < len(self.firmware)
+
+        with self.lock:
+            for update in self.updates.values():
+                if update.downloaded is None:
+                    update.blocks += 1
+
+        return CODE_CONTENT, [(OPTION_BLOCK2, encode_uint((num << 4) | (more << 3) | szx))], block
+
+    def _firmware_state(self, reg, state, peer):
+        with self.lock:
+            update = self.updates.get(reg.name)
+
+        if update is None or update.executed is not None:
+            return
+
+        if state == "2":
+            update.downloaded = time.monotonic()
+            print(f"[{reg.name}] firmware downloaded in {update.downloaded - update.started:.1f} s, "
+                  f"{update.blocks} blocks, {reg.fota_notifications} notifications with {reg.fota_notification_bytes} "
+                  f"bytes during the download", flush=True)
+            update.executed = time.monotonic()
+            self._request(CODE_POST, "/5/0/2", peer)
+        elif state == "0":
+            print(f"[{reg.name}] firmware download failed, reading the Update Result", flush=True)
+            token = self._request(CODE_GET, "/5/0/5", peer, [(OPTION_ACCEPT, encode_uint(FORMAT_TEXT))])
+
+            with self.lock:
+                self.reads[token] = "/5/0/5"
+                del self.updates[reg.name]
+
+    def _handle_response(self, data, mtype, code, mid, token, peer):
+        with self.lock:
+            path = self.observations.get(token)
+            read = self.reads.pop(token, None)
+            reg = self.by_peer.get(peer)
+            update = self.updates.get(reg.name) if reg else None
+
+        # Text payloads never contain the marker byte
+        payload = data[data.rfind(PAYLOAD_MARKER) + 1:].decode(errors="replace") if PAYLOAD_MARKER in data else ""
+
+        if read is not None:
+            print(f"{peer[0]}:{peer[1]} {read} {format_code(code)} {payload}", flush=True)
+            return
+
+        if path is None:
+            return
+
+        if code != CODE_CONTENT:
+            if code != 0:
+                print(f"observe {path} answered {format_code(code)}", flush=True)
+            return
+
+        # The piggybacked answer to the Observe request is not a notification
+        if mtype != TYPE_ACK and reg:
+            with self.lock:
+                reg.notifications += 1
+
+                if update is not None and update.downloaded is None:
+                    reg.fota_notifications += 1
+                    # The notification and its empty ACK
+                    reg.fota_notification_bytes += len(data) + (4 if mtype == TYPE_CON else 0)
+
+        if self.args.verbose:
+            print(f"{peer[0]}:{peer[1]} notification {path} {payload}", flush=True)
+
+        if mtype == TYPE_CON:
+            self.send(build_response(TYPE_ACK, 0, mid, b""), peer)
+
+        if path == "/5/0/3" and mtype != TYPE_ACK and reg:
+            self._firmware_state(reg, payload, peer)
+
+    def report(self):
+        with self.lock:
+            registrations = list(self.registrations.values())
+
+        for reg in registrations:
+            average = sum(reg.cycle_bytes) / len(reg.cycle_bytes) if reg.cycle_bytes else 0
+            print(f"[stats] {reg.name}: {time.monotonic() - reg.registered:.0f} s registered, {reg.updates} updates, "
+                  f"avg {average:.0f} bytes/cycle, {reg.notifications} notifications, {reg.sends} sends, "
+                  f"{reg.rx} bytes rx, {reg.tx} bytes tx", flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Host-side stand-in for an LwM2M server")
+    parser.add_argument("--bind", default="0.0.0.0", help="address to listen on (192.0.2.2 for native_sim)")
+    parser.add_argument("--port", type=int, default=5683, help="UDP port")
+    parser.add_argument("--observe", action="append", default=[],
+                        help="path to observe after every registration, e.g. /4/0/2 (repeatable)")
+    parser.add_argument("--delay", type=float, default=0.0, help="response delay in ms")
+    parser.add_argument("--firmware", help="image to push to every endpoint with a pull-mode firmware update")
+    parser.add_argument("--firmware-host", help="host in the Package URI, defaults to --bind")
+    parser.add_argument("--stats-interval", type=float, default=60.0, help="seconds between statistics reports")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    server = Server(args, sock)
+    print(f"LwM2M stand-in listening on coap://{args.bind}:{args.port}", flush=True)
+
+    def report_periodically():
+        while True:
+            time.sleep(args.stats_interval)
+            server.report()
+
+    threading.Thread(target=report_periodically, daemon=True).start()
+    signal.signal(signal.SIGINT, lambda *_: (server.report(), sys.exit(0)))
+
+    while True:
+        data, peer = sock.recvfrom(2048)
+        server.handle(data, peer)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Usage: ./nat_echo_server.py [--bind 0.0.0.0] [--port 5700] [--max-delay 7200]
+# Example: ./nat_echo_server.py --port 5700 --verbose
+#
+# Delayed UDP echo used by the NAT keepalive of the UDP and CoAP demos to measure
+# how long the operator's NAT binding of the downlink socket survives without
+# traffic. A request asks for its echo after a delay; if the echo still reaches
+# the device, the binding survived that idle time. Datagrams are 12 bytes:
+#
+#   0x00 'N' 'K' type | seq (u32, big endian) | delay in seconds (u32, big endian)
+#
+# Requests have type 0x01 and are echoed with type 0x81 to the source address
+# and port they came from.
+
+import argparse
+import socket
+import threading
+import time
+
+MSG_LEN = 12
+MAGIC = b"\x00NK"
+TYPE_REQUEST = 0x01
+TYPE_REPLY = 0x81
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Delayed UDP echo for NAT binding lifetime probes")
+    parser.add_argument("--bind", default="0.0.0.0", help="address to listen on")
+    parser.add_argument("--port", type=int, default=5700, help="UDP port")
+    parser.add_argument("--max-delay", type=int, default=7200, help="longest delay honoured, in seconds")
+    parser.add_argument("--verbose", action="store_true", help="log every request and echo")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print(f"NAT echo server listening on udp://{args.bind}:{args.port}", flush=True)
+
+    def echo(reply, peer, delay):
+        sock.sendto(reply, peer)
+
+        if args.verbose or delay > 0:
+            print(f"{time.strftime('%H:%M:%S')} {peer[0]}:{peer[1]} echo after {delay} s", flush=True)
+
+    while True:
+        data, peer = sock.recvfrom(64)
+
+        if len(data) != MSG_LEN or data[:3] != MAGIC or data[3] != TYPE_REQUEST:
+            continue
+
+        seq = int.from_bytes(data[4:8], "big")
+        delay = min(int.from_bytes(data[8:12], "big"), args.max_delay)
+        reply = MAGIC + bytes([TYPE_REPLY]) + data[4:]
+
+        if args.verbose:
+            print(f"{time.strftime('%H:%M:%S')} {peer[0]}:{peer[1]} seq {seq} delay {delay} s", flush=True)
+
+        if delay > 0:
+            threading.Timer(delay, echo, (reply, peer, delay)).start()
+        else:
+            echo(reply, peer, delay)
+
+
+if __name__ == "__main__":
+    main()